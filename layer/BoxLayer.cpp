@@ -40,6 +40,7 @@
 
 #include <iostream>
 #include <cmath>
+#include <algorithm>
 
 namespace sv {
 
@@ -53,7 +54,9 @@ BoxLayer::BoxLayer() :
     m_originalPoint(0, 0.0, 0, tr("New Box")),
     m_editingPoint(0, 0.0, 0, tr("New Box")),
     m_editingCommand(nullptr),
-    m_verticalScale(AutoAlignScale)
+    m_verticalScale(AutoAlignScale),
+    m_indexValid(false),
+    m_longestLabelLength(0)
 {
     
 }
@@ -79,8 +82,15 @@ BoxLayer::setModel(ModelId modelId)
     if (m_model == modelId) return;
     m_model = modelId;
 
+    invalidateIndex();
+
     if (newModel) {
         connectSignals(m_model);
+        connect(newModel.get(), SIGNAL(modelChanged(ModelId)),
+                this, SLOT(invalidateIndex()));
+        connect(newModel.get(),
+                SIGNAL(modelChangedWithin(ModelId, sv_frame_t, sv_frame_t)),
+                this, SLOT(updateIndexWithin(ModelId, sv_frame_t, sv_frame_t)));
     }
     
     emit modelReplaced();
@@ -241,6 +251,72 @@ BoxLayer::adoptExtents(double min, double max, QString unit)
     }
 }
 
+void
+BoxLayer::invalidateIndex()
+{
+    m_indexValid = false;
+}
+
+void
+BoxLayer::updateIndexWithin(ModelId, sv_frame_t startFrame,
+                            sv_frame_t endFrame)
+{
+    if (!m_indexValid) return;
+
+    auto model = ModelById::getAs<BoxModel>(m_model);
+    if (!model) {
+        m_indexValid = false;
+        return;
+    }
+
+    if (endFrame <= startFrame) endFrame = startFrame + 1;
+
+    // A frame wider either side than the range itself, so as to be
+    // sure of getting everything the index considers overlapping it
+    // (the index ignores any that don't)
+    EventVector events = model->getEventsSpanning
+        (startFrame - 1, endFrame - startFrame + 2);
+
+    m_index.replaceRange(startFrame, endFrame, events);
+
+    // The longest label can only be recalculated from scratch, but
+    // it is only a layout hint, so it is enough not to let it shrink
+    for (const auto &e: events) {
+        m_longestLabelLength = std::max(m_longestLabelLength,
+                                        int(e.getLabel().length()));
+    }
+}
+
+void
+BoxLayer::checkIndex() const
+{
+    auto model = ModelById::getAs<BoxModel>(m_model);
+    if (!model) {
+        m_index.clear();
+        m_longestLabelLength = 0;
+        return;
+    }
+
+    if (m_indexValid && m_index.getEventCount() == model->getEventCount()) {
+        return;
+    }
+
+    EventVector events = model->getAllEvents();
+    
+    m_index.build(events, [this](const Event &e) {
+        auto r = getRange(e);
+        return std::pair<double, double>(r.first, r.second);
+    });
+
+    m_longestLabelLength = 0;
+    for (const auto &e: events) {
+        m_longestLabelLength = std::max(m_longestLabelLength,
+                                        int(e.getLabel().length()));
+    }
+    
+    m_indexValid = true;
+}
+
 bool
 BoxLayer::getLocalPoint(LayerGeometryProvider *v, int x, int y,
                         Event &point) const
@@ -248,19 +324,36 @@ BoxLayer::getLocalPoint(LayerGeometryProvider *v, int x, int y,
     auto model = ModelById::getAs<BoxModel>(m_model);
     if (!model || !model->isReady()) return false;
 
-    sv_frame_t frame = v->getFrameForX(x);
+    // Take the candidates from the boxes drawn in a recent paint if
+    // we can, or from the index if not. From the index we ask first
+    // only for boxes containing the point itself, and for all those
+    // in the column only if there are none
 
-    EventVector onPoints = model->getEventsCovering(frame);
+    sv_frame_t frame = v->getFrameForX(x);
+    
+    EventVector onPoints;
+    bool haveColumn = false;
+    FeatureHitCache::HitVector hits;
+    if (getHitCache(v).getHitsInColumn(v, x, x, hits)) {
+        onPoints = FeatureHitCache::toEvents(hits);
+        haveColumn = true;
+    } else {
+        checkIndex();
+        onPoints = m_index.getEventsCovering(frame, getValueForY(v, y));
+        if (onPoints.empty()) {
+            onPoints = m_index.getEventsCovering(frame);
+            haveColumn = true;
+        }
+    }
     if (onPoints.empty()) return false;
 
     Event bestContaining;
     for (const auto &p: onPoints) {
         auto r = getRange(p);
-        if (y > getYForValue(v, r.first) || y < getYForValue(v, r.second)) {
-            SVCERR << "inPoints: rejecting " << p.toXmlString() << endl;
+        if (haveColumn &&
+            (y > getYForValue(v, r.first) || y < getYForValue(v, r.second))) {
             continue;
         }
-        SVCERR << "inPoints: looking at " << p.toXmlString() << endl;
         if (bestContaining == Event()) {
             bestContaining = p;
             continue;
@@ -545,12 +638,25 @@ BoxLayer::paint(LayerGeometryProvider *v, QPainter &paint,
     int x0 = rect.left() - 40;
     int x1 = x0 + rect.width() + 80;
 
-    sv_frame_t wholeFrame0 = v->getFrameForX(0);
-    sv_frame_t wholeFrame1 = v->getFrameForX(v->getPaintWidth());
+    checkIndex();
 
-    EventVector points(model->getEventsSpanning(wholeFrame0,
-                                                wholeFrame1 - wholeFrame0));
-    if (points.empty()) return;
+    QFontMetrics fm = paint.fontMetrics();
+
+    // Query only the boxes that could touch the rect being painted:
+    // labels are drawn to the left of their boxes and above or below
+    // their edges, so extend the query rect accordingly
+
+    int labelMargin = std::max(m_longestLabelLength, 30) * fm.maxWidth();
+    int yMargin = 2 * fm.height() + v->scalePixelSize(2);
+
+    sv_frame_t frame0 = v->getFrameForX(x0);
+    sv_frame_t frame1 = v->getFrameForX(x1 + labelMargin) + 1;
+
+    double value0 = getValueForY(v, rect.bottom() + yMargin);
+    double value1 = getValueForY(v, rect.top() - yMargin);
+
+    EventVector points(m_index.getEventsOverlapping(frame0, frame1,
+                                                    value0, value1));
 
     paint.setPen(getBaseQColor());
 
@@ -570,11 +676,23 @@ BoxLayer::paint(LayerGeometryProvider *v, QPainter &paint,
                                          illuminatePoint);
     }
 
+    if (shouldIlluminate &&
+        std::find(points.begin(), points.end(), illuminatePoint) ==
+        points.end()) {
+        // Its value and time labels may reach into the rect even if
+        // the box itself does not
+        points.insert(std::upper_bound(points.begin(), points.end(),
+                                       illuminatePoint),
+                      illuminatePoint);
+    }
+
+    if (points.empty()) return;
+
+    FeatureHitCache::Recorder recorder(getHitCache(v), v, rect);
+
     paint.save();
     paint.setRenderHint(QPainter::Antialiasing, false);
 
-    QFontMetrics fm = paint.fontMetrics();
-        
     for (EventVector::const_iterator i = points.begin();
          i != points.end(); ++i) {
 
@@ -588,6 +706,8 @@ BoxLayer::paint(LayerGeometryProvider *v, QPainter &paint,
         int ex = x + w;
         int gap = v->scalePixelSize(2);
 
+        recorder.add(p, QRect(x, y, w, h));
+
         EventVector::const_iterator j = i;
         ++j;
 
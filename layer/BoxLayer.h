@@ -17,6 +17,7 @@
 
 #include "SingleColourLayer.h"
 #include "VerticalScaleLayer.h"
+#include "EventRectIndex.h"
 
 #include "data/model/BoxModel.h"
 
@@ -118,9 +119,20 @@ public:
     double getValueForY(LayerGeometryProvider *v, int y) const override;
     QString getScaleUnits() const override;
 
+protected slots:
+    void invalidateIndex();
+    void updateIndexWithin(ModelId, sv_frame_t startFrame, sv_frame_t endFrame);
+
 protected:
     void getScaleExtents(LayerGeometryProvider *, double &min, double &max, bool &log) const;
 
+    // Rebuild m_index from the model if it has changed since last
+    // built. Changes within a frame range are applied to the index
+    // as they happen, by updateIndexWithin, so this rebuilds only
+    // after a whole-model change. The index is used for all rect-
+    // and point-bounded queries in paint and hit-testing.
+    void checkIndex() const;
+
     // Return the event that "most closely contains" the given
     // coordinates, if any; or the closest event that spans the given
     // x coordinate in the time axis; or false otherwise. This
@@ -139,6 +151,10 @@ protected:
     ChangeEventsCommand *m_editingCommand;
     VerticalScale m_verticalScale;
 
+    mutable EventRectIndex m_index;
+    mutable bool m_indexValid;
+    mutable int m_longestLabelLength;
+
     std::pair<float, float> getRange(const Event &e) const {
         return { e.getValue(), e.getValue() + fabsf(e.getLevel()) };
     }
@@ -24,7 +24,6 @@
 #include "PaintAssistant.h"
 #include "Colour3DPlotExporter.h"
 
-#include "data/model/Dense3DModelPeakCache.h"
 
 #include "view/ViewManager.h"
 
@@ -61,7 +60,8 @@ Colour3DPlotLayer::Colour3DPlotLayer() :
     m_miny(0),
     m_maxy(0),
     m_synchronous(false),
-    m_peakCacheDivisor(8)
+    m_peakCacheDivisor(8),
+    m_renderers(this, this)
 {
     QSettings settings;
     settings.beginGroup("Preferences");
@@ -72,6 +72,7 @@ Colour3DPlotLayer::Colour3DPlotLayer() :
 
 Colour3DPlotLayer::~Colour3DPlotLayer()
 {
+    LayerCacheBudget::getInstance()->removeAll(this);
     invalidateRenderers();
     
     for (auto exporterId: m_exporters) {
@@ -196,22 +197,50 @@ Colour3DPlotLayer::invalidatePeakCache()
     invalidateRenderers();
     invalidateMagnitudes();
 
-    if (!m_peakCache.isNone()) {
-        ModelById::release(m_peakCache);
-        m_peakCache = {};
-    }
+    m_peakCaches.release();
+    LayerCacheBudget::getInstance()->remove(this, peakCachesBudgetKey);
 }
 
 void
 Colour3DPlotLayer::invalidateRenderers()
 {
-    for (ViewRendererMap::iterator i = m_renderers.begin();
-         i != m_renderers.end(); ++i) {
-        delete i->second;
-    }
     m_renderers.clear();
 }
 
+void
+Colour3DPlotLayer::updateCacheBudget(const LayerGeometryProvider *v) const
+{
+    m_renderers.painted(v);
+    
+    LayerCacheBudget::getInstance()->setUsage
+        (const_cast<Colour3DPlotLayer *>(this), peakCachesBudgetKey,
+         m_peakCaches.getEstimatedMemoryUsage());
+}
+
+void
+Colour3DPlotLayer::evictCache(int key)
+{
+    if (key == peakCachesBudgetKey) {
+        // The renderers refer to the peak caches, so must go too;
+        // both are recreated when next needed
+        invalidateRenderers();
+        m_peakCaches.release();
+    } else {
+        m_renderers.evict(key);
+    }
+}
+
+void
+Colour3DPlotLayer::recolourRenderers()
+{
+    // Apply a colour-only change to the renderers' existing caches,
+    // discarding any renderer that can't take it
+    
+    m_renderers.recolour([this](int viewId) {
+                             return getRendererParameters(viewId);
+                         });
+}
+
 void
 Colour3DPlotLayer::invalidateMagnitudes()
 {
@@ -246,15 +275,13 @@ Colour3DPlotLayer::getExportModel(LayerGeometryProvider *v) const
     return exporter;
 }
 
-ModelId
-Colour3DPlotLayer::getPeakCache() const
+const std::vector<ModelId> &
+Colour3DPlotLayer::getPeakCaches() const
 {
-    if (m_peakCache.isNone()) {
-        auto peakCache = std::make_shared<Dense3DModelPeakCache>
-            (m_model, m_peakCacheDivisor);
-        m_peakCache = ModelById::add(peakCache);
+    if (m_peakCaches.isEmpty()) {
+        m_peakCaches.create(m_model, m_peakCacheDivisor);
     }
-    return m_peakCache;
+    return m_peakCaches.getLevels();
 }
 
 void
@@ -289,6 +316,12 @@ Colour3DPlotLayer::handleModelChangedWithin(ModelId modelId,
             }
         }
     }
+    // The upper peak cache levels are built on the lower ones and
+    // won't notice that the model has grown beneath them. Resetting
+    // them gives them new ids, which existing renderers don't know
+    // about, so the renderers must go too
+    m_peakCaches.resetUpperLevels();
+    invalidateRenderers();
     emit modelChangedWithin(modelId, startFrame, endFrame);
 }
 
@@ -540,7 +573,7 @@ Colour3DPlotLayer::setColourScale(ColourScaleType scale)
     m_colourScaleSet = true; // even if setting to the same thing
     if (m_colourScale == scale) return;
     m_colourScale = scale;
-    invalidateRenderers();
+    recolourRenderers();
     emit layerParametersChanged();
 }
 
@@ -549,7 +582,7 @@ Colour3DPlotLayer::setColourMap(int map)
 {
     if (m_colourMap == map) return;
     m_colourMap = map;
-    invalidateRenderers();
+    recolourRenderers();
     emit layerParametersChanged();
 }
 
@@ -558,7 +591,7 @@ Colour3DPlotLayer::setGain(float gain)
 {
     if (m_gain == gain) return;
     m_gain = gain;
-    invalidateRenderers();
+    recolourRenderers();
     emit layerParametersChanged();
 }
 
@@ -1086,6 +1119,69 @@ Colour3DPlotLayer::paintVerticalScale(LayerGeometryProvider *v, bool, QPainter &
     paint.restore();
 }
 
+Colour3DPlotRenderer::Parameters
+Colour3DPlotLayer::getRendererParameters(int viewId) const
+{
+    Colour3DPlotRenderer::Parameters params;
+
+    auto model = ModelById::getAs<DenseThreeDimensionalModel>(m_model);
+    if (!model) return params;
+
+    ColourScale::Parameters cparams;
+    cparams.colourMap = m_colourMap;
+    cparams.inverted = m_colourInverted;
+    cparams.scaleType = m_colourScale;
+    cparams.gain = m_gain;
+
+    double minValue = 0.0;
+    double maxValue = 1.0;
+        
+    if (m_normalizeVisibleArea && m_viewMags[viewId].isSet()) {
+        minValue = m_viewMags[viewId].getMin();
+        maxValue = m_viewMags[viewId].getMax();
+    } else if (m_normalization == ColumnNormalization::Hybrid) {
+        minValue = 0;
+        maxValue = log10(model->getMaximumLevel() + 1.0);
+    } else if (m_normalization == ColumnNormalization::None) {
+        minValue = model->getMinimumLevel();
+        maxValue = model->getMaximumLevel();
+    }
+
+    SVDEBUG << "Colour3DPlotLayer: renderer value range is "
+            << minValue << " -> " << maxValue
+            << " (model min = " << model->getMinimumLevel()
+            << ", max = " << model->getMaximumLevel() << ")"
+            << endl;
+
+    if (maxValue <= minValue) {
+        maxValue = minValue + 0.1f;
+
+        if (!(maxValue > minValue)) { // one of them must be NaN or Inf
+            SVCERR << "WARNING: Colour3DPlotLayer::getRendererParameters: "
+                   << "resetting minValue and maxValue to zero and one"
+                   << endl;
+            minValue = 0.f;
+            maxValue = 1.f;
+        }
+    }
+
+    cparams.threshold = minValue;
+    cparams.minValue = minValue;
+    cparams.maxValue = maxValue;
+        
+    m_lastRenderedMags[viewId] = MagnitudeRange(float(minValue),
+                                                float(maxValue));
+
+    params.colourScale = ColourScale(cparams);
+    params.normalization = m_normalization;
+    params.binScale = m_binScale;
+    params.alwaysOpaque = m_opaque;
+    params.invertVertical = m_invertVertical;
+    params.interpolate = m_smooth;
+
+    return params;
+}
+
 Colour3DPlotRenderer *
 Colour3DPlotLayer::getRenderer(const LayerGeometryProvider *v) const
 {
@@ -1093,70 +1189,22 @@ Colour3DPlotLayer::getRenderer(const LayerGeometryProvider *v) const
     if (!model) return nullptr;
     
     int viewId = v->getId();
+
+    // Views with identical geometry can share a renderer and its
+    // cache, unless the colour mapping depends on the view's own
+    // visible area
+    bool share = !m_normalizeVisibleArea;
     
-    if (m_renderers.find(viewId) == m_renderers.end()) {
+    return m_renderers.getRenderer(v, share, [this, viewId]() {
 
         Colour3DPlotRenderer::Sources sources;
         sources.verticalBinLayer = this;
         sources.source = m_model;
-        sources.peakCaches.push_back(getPeakCache());
-
-        ColourScale::Parameters cparams;
-        cparams.colourMap = m_colourMap;
-        cparams.inverted = m_colourInverted;
-        cparams.scaleType = m_colourScale;
-        cparams.gain = m_gain;
-
-        double minValue = 0.0;
-        double maxValue = 1.0;
-        
-        if (m_normalizeVisibleArea && m_viewMags[viewId].isSet()) {
-            minValue = m_viewMags[viewId].getMin();
-            maxValue = m_viewMags[viewId].getMax();
-        } else if (m_normalization == ColumnNormalization::Hybrid) {
-            minValue = 0;
-            maxValue = log10(model->getMaximumLevel() + 1.0);
-        } else if (m_normalization == ColumnNormalization::None) {
-            minValue = model->getMinimumLevel();
-            maxValue = model->getMaximumLevel();
-        }
-
-        SVDEBUG << "Colour3DPlotLayer: rebuilding renderer, value range is "
-                << minValue << " -> " << maxValue
-                << " (model min = " << model->getMinimumLevel()
-                << ", max = " << model->getMaximumLevel() << ")"
-                << endl;
-
-        if (maxValue <= minValue) {
-            maxValue = minValue + 0.1f;
-
-            if (!(maxValue > minValue)) { // one of them must be NaN or Inf
-                SVCERR << "WARNING: Colour3DPlotLayer::getRenderer: resetting "
-                       << "minValue and maxValue to zero and one" << endl;
-                minValue = 0.f;
-                maxValue = 1.f;
-            }
-        }
-
-        cparams.threshold = minValue;
-        cparams.minValue = minValue;
-        cparams.maxValue = maxValue;
-        
-        m_lastRenderedMags[viewId] = MagnitudeRange(float(minValue),
-                                                    float(maxValue));
-
-        Colour3DPlotRenderer::Parameters params;
-        params.colourScale = ColourScale(cparams);
-        params.normalization = m_normalization;
-        params.binScale = m_binScale;
-        params.alwaysOpaque = m_opaque;
-        params.invertVertical = m_invertVertical;
-        params.interpolate = m_smooth;
-
-        m_renderers[viewId] = new Colour3DPlotRenderer(sources, params);
-    }
+        sources.peakCaches = getPeakCaches();
 
-    return m_renderers[viewId];
+        return new Colour3DPlotRenderer
+            (sources, getRendererParameters(viewId));
+    });
 }
 
 void
@@ -1205,13 +1253,27 @@ Colour3DPlotLayer::paintWithRenderer(LayerGeometryProvider *v,
     if (!continuingPaint && m_normalizeVisibleArea &&
         m_viewMags[viewId] != m_lastRenderedMags[viewId]) {
 #ifdef DEBUG_COLOUR_3D_PLOT_LAYER_PAINT
-        SVDEBUG << "mag range has changed from last rendered range: re-rendering"
+        SVDEBUG << "mag range has changed from last rendered range: recolouring"
              << endl;
 #endif
-        delete m_renderers[viewId];
-        m_renderers.erase(viewId);
-        v->updatePaintRect(v->getPaintRect());
+        // Only the colour mapping depends on the range, so we can
+        // remap what has already been rendered instead of discarding
+        // it and rendering the whole view again. Anything we need to
+        // paint again is then served from the renderer's cache
+        if (renderer->recolour(getRendererParameters(viewId))) {
+            if (!result.rendered.isEmpty()) {
+                renderer->render(v, paint, result.rendered);
+            }
+            if (result.rendered != v->getPaintRect()) {
+                v->updatePaintRect(v->getPaintRect());
+            }
+        } else {
+            m_renderers.discard(viewId);
+            v->updatePaintRect(v->getPaintRect());
+        }
     }
+
+    updateCacheBudget(v);
 }
 
 void
@@ -21,6 +21,9 @@
 
 #include "ColourScale.h"
 #include "Colour3DPlotRenderer.h"
+#include "PeakCachePyramid.h"
+#include "LayerCacheBudget.h"
+#include "Colour3DPlotRendererPool.h"
 
 #include "data/model/DenseThreeDimensionalModel.h"
 
@@ -41,7 +44,8 @@ class View;
  * implementation that derived the spectrogram itself from a
  * DenseTimeValueModel instead of using a three-dimensional model.
  */
-class Colour3DPlotLayer : public VerticalBinLayer
+class Colour3DPlotLayer : public VerticalBinLayer,
+                          public LayerCacheBudget::Client
 {
     Q_OBJECT
 
@@ -63,6 +67,7 @@ public:
                               bool, QPainter &) const override;
     void paintVerticalScale(LayerGeometryProvider *v,
                             bool, QPainter &paint, QRect rect) const override;
+    bool isVerticalScaleRetainable() const override { return false; }
 
     QString getFeatureDescription(LayerGeometryProvider *v,
                                   QPoint &) const override;
@@ -157,6 +162,8 @@ public:
 
     ModelId getSliceableModel() const override { return m_model; }
 
+    void evictCache(int key) override;
+
     void toXml(QTextStream &stream, QString indent = "",
                QString extraAttributes = "") const override;
 
@@ -192,10 +199,10 @@ protected:
     static std::pair<ColumnNormalization, bool> convertToColumnNorm(int value);
     static int convertFromColumnNorm(ColumnNormalization norm, bool visible);
 
-    mutable ModelId m_peakCache;
+    mutable PeakCachePyramid m_peakCaches;
     const int m_peakCacheDivisor;
     void invalidatePeakCache();
-    ModelId getPeakCache() const;
+    const std::vector<ModelId> &getPeakCaches() const;
 
     mutable std::vector<ModelId> m_exporters; // used, waiting to be released
     
@@ -204,11 +211,17 @@ protected:
     mutable ViewMagMap m_lastRenderedMags; // when in normalizeVisibleArea mode
     void invalidateMagnitudes();
 
-    typedef std::map<int, Colour3DPlotRenderer *> ViewRendererMap; // key is view id
-    mutable ViewRendererMap m_renderers;
+    mutable Colour3DPlotRendererPool m_renderers;
     
     Colour3DPlotRenderer *getRenderer(const LayerGeometryProvider *) const;
+    Colour3DPlotRenderer::Parameters getRendererParameters(int viewId) const;
     void invalidateRenderers();
+    void recolourRenderers();
+
+    // Renderers are accounted with LayerCacheBudget by the pool, and
+    // the peak caches under this key
+    void updateCacheBudget(const LayerGeometryProvider *v) const;
+    static const int peakCachesBudgetKey = -1;
         
     /**
      * Return the y coordinate at which the given bin "starts"
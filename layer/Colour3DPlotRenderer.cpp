@@ -14,6 +14,7 @@
 */
 
 #include "Colour3DPlotRenderer.h"
+#include "PeakFrequencyCache.h"
 #include "RenderTimer.h"
 
 #include "base/Profiler.h"
@@ -31,6 +32,9 @@
 #include "view/ViewManager.h" // for main model sample rate. Pity
 
 #include <vector>
+#include <limits>
+#include <algorithm>
+#include <cmath>
 
 #include <utility>
 namespace sv {
@@ -42,6 +46,9 @@ using namespace std::rel_ops;
 
 using namespace std;
 
+// Value retained for pixels drawn in the background colour
+static const float noValue = std::numeric_limits<float>::quiet_NaN();
+
 static vector<QRgb>
 makeColourmap(const Colour3DPlotRenderer::Parameters &parameters)
 {
@@ -61,8 +68,99 @@ Colour3DPlotRenderer::Colour3DPlotRenderer(Sources sources,
     m_params(parameters),
     m_colourmap(makeColourmap(parameters)),
     m_secondsPerXPixel(0.0),
-    m_secondsPerXPixelValid(false)
+    m_secondsPerXPixelValid(false),
+    m_renderTimeScale(1.0)
+{
+}
+
+bool
+Colour3DPlotRenderer::isColourOnlyChange(const Parameters &p) const
+{
+    // Everything in the ColourScale is applied only when mapping a
+    // value to a colour, except that the phase scale causes us to
+    // read different data altogether
+    
+    bool wasPhase = (m_params.colourScale.getScale() == ColourScaleType::Phase);
+    bool isPhase = (p.colourScale.getScale() == ColourScaleType::Phase);
+
+    return (wasPhase == isPhase &&
+            p.normalization == m_params.normalization &&
+            p.binDisplay == m_params.binDisplay &&
+            p.binScale == m_params.binScale &&
+            p.alwaysOpaque == m_params.alwaysOpaque &&
+            p.interpolate == m_params.interpolate &&
+            p.invertVertical == m_params.invertVertical &&
+            p.showDerivative == m_params.showDerivative &&
+            p.scaleFactor == m_params.scaleFactor);
+}
+
+bool
+Colour3DPlotRenderer::recolour(const Parameters &parameters)
+{
+    Profiler profiler("Colour3DPlotRenderer::recolour");
+    
+    if (!isColourOnlyChange(parameters)) {
+        return false;
+    }
+
+    int left = m_cache.getValidLeft();
+    int width = m_cache.getValidWidth();
+    int h = m_cache.getSize().height();
+
+    if (m_cache.isValid() &&
+        (m_valueCache.getSize() != m_cache.getSize() ||
+         !m_valueCache.areColumnsSet(left, width))) {
+#ifdef DEBUG_COLOUR_PLOT_REPAINT
+        SVDEBUG << "recolour " << m_sources.source
+                << ": value cache does not cover valid image area" << endl;
+#endif
+        return false;
+    }
+
+    m_params = parameters;
+    m_colourmap = makeColourmap(parameters);
+
+    if (!m_cache.isValid()) {
+        return true;
+    }
+
+    // Map into the draw buffer and then copy over the valid area of
+    // the image cache, which leaves the cache valid area unchanged
+    
+    if (m_drawBuffer.width() != width || m_drawBuffer.height() != h) {
+        m_drawBuffer = QImage(width, h, QImage::Format_ARGB32_Premultiplied);
+    }
+
+    for (int y = 0; y < h; ++y) {
+        mapValuesToColours(m_valueCache.getRow(y) + left,
+                           reinterpret_cast<QRgb *>(m_drawBuffer.scanLine(y)),
+                           width);
+    }
+
+    m_cache.drawImage(left, width, m_drawBuffer, 0, width);
+
+#ifdef DEBUG_COLOUR_PLOT_REPAINT
+    SVDEBUG << "recolour " << m_sources.source
+            << ": recoloured " << width << "x" << h << " at " << left << endl;
+#endif
+    
+    return true;
+}
+
+void
+Colour3DPlotRenderer::mapValuesToColours(const float *values,
+                                         QRgb *target,
+                                         int n) const
 {
+    const QRgb *colourmap = m_colourmap.data();
+    for (int i = 0; i < n; ++i) {
+        float value = values[i];
+        if (std::isnan(value)) {
+            target[i] = colourmap[0];
+        } else {
+            target[i] = colourmap[m_params.colourScale.getPixel(value)];
+        }
+    }
 }
 
 Colour3DPlotRenderer::RenderResult
@@ -133,6 +231,8 @@ Colour3DPlotRenderer::render(const LayerGeometryProvider *v,
             timeConstrained = false;
         }
     }
+
+    m_renderTimeScale = v->getRenderTimeScale();
             
     int x0 = v->getXForViewX(rect.x());
     int x1 = v->getXForViewX(rect.x() + rect.width());
@@ -166,6 +266,9 @@ Colour3DPlotRenderer::render(const LayerGeometryProvider *v,
 
     m_magCache.resize(v->getPaintSize().width());
     m_magCache.setZoomLevel(v->getZoomLevel());
+
+    m_valueCache.resize(v->getPaintSize());
+    m_valueCache.setZoomLevel(v->getZoomLevel());
     
     if (renderType == DirectTranslucent) {
         MagnitudeRange range = renderDirectTranslucent(v, paint, rect);
@@ -219,6 +322,7 @@ Colour3DPlotRenderer::render(const LayerGeometryProvider *v,
             // partially usable
             m_cache.scrollTo(v, startFrame);
             m_magCache.scrollTo(v, startFrame);
+            m_valueCache.scrollTo(v, startFrame);
 
             // if we are not time-constrained, then we want to paint
             // the whole area in one go; we don't return a partial
@@ -230,6 +334,7 @@ Colour3DPlotRenderer::render(const LayerGeometryProvider *v,
                 if (m_cache.getValidLeft() > x0 &&
                     m_cache.getValidRight() < x1) {
                     m_cache.invalidate();
+                    m_valueCache.invalidate();
                 }
             }
         }
@@ -242,6 +347,7 @@ Colour3DPlotRenderer::render(const LayerGeometryProvider *v,
         count.miss();
         m_cache.setStartFrame(startFrame);
         m_magCache.setStartFrame(startFrame);
+        m_valueCache.setStartFrame(startFrame);
     }
 
     bool rightToLeft = false;
@@ -569,12 +675,57 @@ Colour3DPlotRenderer::renderDirectTranslucent(const LayerGeometryProvider *v,
     int nbins  = m_sources.verticalBinLayer->getIBinForY(v, 0) - minbin + 1;
     if (minbin + nbins > sh) nbins = sh - minbin;
 
+    // The bin boundaries are the same for every column, so we find
+    // them once. Bin sy lies between binY[sy - minbin] and
+    // binY[sy - minbin + 1]
+
+    if (nbins < 0) nbins = 0;
+    
+    vector<int> binY(nbins + 1);
+    for (int i = 0; i <= nbins; ++i) {
+        binY[i] = m_sources.verticalBinLayer->getIYForBin(v, minbin + i);
+        if (m_params.invertVertical) {
+            binY[i] = h - binY[i] - 1;
+        }
+    }
+
+    // Cells are filled into an ARGB buffer covering the paint rect,
+    // blending as the painter would, and the buffer is composited in
+    // one go at the end. Only the illumination outline and labels
+    // are painted individually
+
+    QRect bufferRect = rect.intersected(QRect(0, 0, v->getPaintWidth(), h));
+    if (bufferRect.isEmpty()) return magRange;
+    
+    if (m_translucentBuffer.size() != bufferRect.size()) {
+        m_translucentBuffer = QImage(bufferRect.size(),
+                                     QImage::Format_ARGB32_Premultiplied);
+    }
+    m_translucentBuffer.fill(0);
+
+    QRect illuminatedRect;
+    bool haveIlluminatedRect = false;
+
+    struct Label {
+        int x;
+        int y;
+        QString text;
+    };
+    vector<Label> labels;
+
+    bool labelFits =
+        (paint.fontMetrics().height() < (h / sh));
+    int labelWidth =
+        paint.fontMetrics().horizontalAdvance("0.000000");
+    
     int psx = -1;
 
     ColumnOp::Column preparedColumn;
 
     int modelWidth = model->getWidth();
 
+    auto table = v->getPixelFrameTable();
+
     for (int sx = sx0; sx <= sx1; ++sx) {
 
         if (sx < 0 || sx >= modelWidth) {
@@ -606,79 +757,148 @@ Colour3DPlotRenderer::renderDirectTranslucent(const LayerGeometryProvider *v,
 
         if (fx + modelResolution <= modelStart || fx > modelEnd) continue;
 
-        int rx0 = v->getXForFrame(int(double(fx) * rateRatio));
-        int rx1 = v->getXForFrame(int(double(fx + modelResolution + 1) * rateRatio));
+        int rx0 = table->getXForFrame(int(double(fx) * rateRatio));
+        int rx1 = table->getXForFrame(int(double(fx + modelResolution + 1) * rateRatio));
 
         int rw = rx1 - rx0;
         if (rw < 1) rw = 1;
 
-        bool showLabel = (rw > 10 &&
-                          paint.fontMetrics().horizontalAdvance("0.000000") < rw - 3 &&
-                          paint.fontMetrics().height() < (h / sh));
+        bool showLabel = (rw > 10 && labelWidth < rw - 3 && labelFits);
+
+        // Horizontal extent of this column's cells within the buffer
+        int bx0 = std::max(rx0, bufferRect.left()) - bufferRect.left();
+        int bx1 = std::min(rx0 + rw, bufferRect.right() + 1) - bufferRect.left();
         
         for (int sy = minbin; sy < minbin + nbins; ++sy) {
 
-            int ry0 = m_sources.verticalBinLayer->getIYForBin(v, sy);
-            int ry1 = m_sources.verticalBinLayer->getIYForBin(v, sy + 1);
-
-            if (m_params.invertVertical) {
-                ry0 = h - ry0 - 1;
-                ry1 = h - ry1 - 1;
-            }
-                    
+            int ry0 = binY[sy - minbin];
+            int ry1 = binY[sy - minbin + 1];
+            
             QRect r(rx0, ry1, rw, ry0 - ry1);
 
             float value = preparedColumn[sy - minbin];
-            QColor colour = m_params.colourScale.getColour(value,
-                                                           m_params.colourRotation);
+            QRgb colour = m_colourmap[m_params.colourScale.getPixel(value)];
 
-            if (rw == 1) {
-                paint.setPen(colour);
-                paint.setBrush(Qt::NoBrush);
-                paint.drawLine(r.x(), r.y(), r.x(), r.y() + r.height() - 1);
-                continue;
+            // One-pixel-wide columns and small cells are opaque
+            if (rw > 3 && r.height() > 3) {
+                colour = qPremultiply(qRgba(qRed(colour), qGreen(colour),
+                                            qBlue(colour), 160));
             }
 
-            QColor brush(colour);
-
-            if (rw > 3 && r.height() > 3) {
-                brush.setAlpha(160);
+            QRect nr = r.normalized();
+            
+            if (rw > 1 && illuminate && nr.contains(illuminatePos)) {
+                illuminatedRect = r;
+                haveIlluminatedRect = true;
             }
 
-            paint.setPen(Qt::NoPen);
-            paint.setBrush(brush);
+            int by0 = std::max(nr.top(), bufferRect.top()) - bufferRect.top();
+            int by1 = std::min(nr.bottom() + 1, bufferRect.bottom() + 1)
+                - bufferRect.top();
 
-            if (illuminate) {
-                if (r.contains(illuminatePos)) {
-                    paint.setPen(v->getForeground());
-                }
+            if (bx0 < bx1) {
+                fillTranslucentCell(bx0, bx1, by0, by1, colour);
             }
-            
-#ifdef DEBUG_COLOUR_PLOT_REPAINT
-//            SVDEBUG << "rect " << r.x() << "," << r.y() << " "
-//                      << r.width() << "x" << r.height() << endl;
-#endif
-
-            paint.drawRect(r);
 
             if (showLabel) {
                 double value = model->getValueAt(sx, sy);
                 snprintf(labelbuf, buflen, "%06f", value);
-                QString text(labelbuf);
-                PaintAssistant::drawVisibleText
-                    (v,
-                     paint,
-                     rx0 + 2,
-                     ry0 - h / sh - 1 + 2 + paint.fontMetrics().ascent(),
-                     text,
-                     PaintAssistant::OutlinedText);
+                labels.push_back
+                    ({ rx0 + 2,
+                       ry0 - h / sh - 1 + 2 + paint.fontMetrics().ascent(),
+                       QString(labelbuf) });
             }
         }
     }
 
+    paint.drawImage(bufferRect.topLeft(), m_translucentBuffer);
+
+    if (haveIlluminatedRect) {
+        paint.setPen(v->getForeground());
+        paint.setBrush(Qt::NoBrush);
+        paint.drawRect(illuminatedRect);
+    }
+
+    for (const auto &label: labels) {
+        PaintAssistant::drawVisibleText
+            (v, paint, label.x, label.y, label.text,
+             PaintAssistant::OutlinedText);
+    }
+
     return magRange;
 }
 
+void
+Colour3DPlotRenderer::fillTranslucentCell(int x0, int x1, int y0, int y1,
+                                          QRgb colour)
+{
+    // Source-over blend of a premultiplied colour onto the buffer,
+    // matching what QPainter does when filling a rect
+
+    int alpha = qAlpha(colour);
+
+    for (int y = y0; y < y1; ++y) {
+        QRgb *line = reinterpret_cast<QRgb *>
+            (m_translucentBuffer.scanLine(y));
+        if (alpha == 255) {
+            std::fill(line + x0, line + x1, colour);
+            continue;
+        }
+        int inv = 255 - alpha;
+        for (int x = x0; x < x1; ++x) {
+            QRgb d = line[x];
+            line[x] = qRgba(qRed(colour) + (qRed(d) * inv + 127) / 255,
+                            qGreen(colour) + (qGreen(d) * inv + 127) / 255,
+                            qBlue(colour) + (qBlue(d) * inv + 127) / 255,
+                            alpha + (qAlpha(d) * inv + 127) / 255);
+        }
+    }
+}
+
+qint64
+Colour3DPlotRenderer::getMemoryUsage() const
+{
+    QSize valueCacheSize = m_valueCache.getSize();
+    
+    return
+        qint64(m_cache.getImage().sizeInBytes()) +
+        qint64(m_drawBuffer.sizeInBytes()) +
+        qint64(m_translucentBuffer.sizeInBytes()) +
+        qint64(valueCacheSize.width()) * valueCacheSize.height() *
+        qint64(sizeof(float)) +
+        qint64(m_drawValues.capacity() * sizeof(float)) +
+        qint64(m_magRanges.capacity() * sizeof(MagnitudeRange)) +
+        qint64(m_magCache.getWidth()) * qint64(sizeof(MagnitudeRange));
+}
+
+int
+Colour3DPlotRenderer::getSourceColumnsPerPeak(int peakCacheIndex) const
+{
+    // A peak cache may be built on another peak cache rather than on
+    // our source directly, in which case its own columns-per-peak is
+    // relative to that and we need to go by the ratio of resolutions
+    // instead
+    
+    if (!in_range_for(m_sources.peakCaches, peakCacheIndex)) return -1;
+    
+    auto peakCache = ModelById::getAs<Dense3DModelPeakCache>
+        (m_sources.peakCaches[peakCacheIndex]);
+    if (!peakCache) return -1;
+
+    auto source = ModelById::getAs<DenseThreeDimensionalModel>
+        (m_sources.source);
+    if (source) {
+        int sourceResolution = source->getResolution();
+        int cacheResolution = peakCache->getResolution();
+        if (sourceResolution > 0 && cacheResolution >= sourceResolution &&
+            cacheResolution % sourceResolution == 0) {
+            return cacheResolution / sourceResolution;
+        }
+    }
+
+    return peakCache->getColumnsPerPeak();
+}
+
 void
 Colour3DPlotRenderer::getPreferredPeakCache(const LayerGeometryProvider *v,
                                             int &peakCacheIndex,
@@ -698,10 +918,8 @@ Colour3DPlotRenderer::getPreferredPeakCache(const LayerGeometryProvider *v,
     if (!getBinResolutions(v, binResolution, renderBinResolution)) return;
 
     for (int ix = 0; in_range_for(m_sources.peakCaches, ix); ++ix) {
-        auto peakCache = ModelById::getAs<Dense3DModelPeakCache>
-            (m_sources.peakCaches[ix]);
-        if (!peakCache) continue;
-        int bpp = peakCache->getColumnsPerPeak();
+        int bpp = getSourceColumnsPerPeak(ix);
+        if (bpp < 1) continue;
         ZoomLevel equivZoom(ZoomLevel::FramesPerPixel,
                             round(renderBinResolution * bpp));
 #ifdef DEBUG_COLOUR_PLOT_CACHE_SELECTION
@@ -767,8 +985,10 @@ Colour3DPlotRenderer::renderToCachePixelResolution(const LayerGeometryProvider *
             << renderBinResolution << endl;
 #endif
     
+    auto table = v->getPixelFrameTable();
+    
     for (int x = 0; x < repaintWidth; ++x) {
-        sv_frame_t f0 = v->getFrameForX(x0 + x);
+        sv_frame_t f0 = table->getFrameForX(x0 + x);
         double s0 = double(f0 - model->getStartFrame()) / renderBinResolution;
         binforx[x] = int(s0 + 0.0001);
 #ifdef DEBUG_COLOUR_PLOT_REPAINT
@@ -828,19 +1048,24 @@ Colour3DPlotRenderer::renderToCachePixelResolution(const LayerGeometryProvider *
                       m_drawBuffer,
                       paintedLeft - x0, attainedWidth);
 
+    m_valueCache.drawValues(paintedLeft, attainedWidth,
+                            m_drawValues.data(), m_drawBuffer.width(),
+                            paintedLeft - x0);
+
     for (int i = 0; in_range_for(m_magRanges, i); ++i) {
         m_magCache.sampleColumn(i, m_magRanges.at(i));
     }
 }
 
-QImage
-Colour3DPlotRenderer::scaleDrawBufferImage(QImage image,
-                                           int targetWidth,
-                                           int targetHeight) const
+void
+Colour3DPlotRenderer::scaleDrawBufferValues(int sourceWidth,
+                                            int sourceHeight,
+                                            int targetWidth,
+                                            int targetHeight,
+                                            int targetLeft,
+                                            int targetCount,
+                                            float *const *targetRows) const
 {
-    int sourceWidth = image.width();
-    int sourceHeight = image.height();
-
     // We can only do this if we're making the image larger --
     // otherwise peaks may be lost. So this should be called only when
     // rendering in DrawBufferBinResolution mode. Whenever the bin
@@ -848,67 +1073,176 @@ Colour3DPlotRenderer::scaleDrawBufferImage(QImage image,
     // should be using DrawBufferPixelResolution mode instead
     
     if (targetWidth < sourceWidth || targetHeight < sourceHeight) {
-        SVCERR << "ERROR: Colour3DPlotRenderer::scaleDrawBufferImage: "
+        SVCERR << "ERROR: Colour3DPlotRenderer::scaleDrawBufferValues: "
                << "targetWidth " << targetWidth
                << " < sourceWidth " << sourceWidth
                << " or targetHeight " << targetHeight
                << " < sourceHeight " << sourceHeight << endl;
-        throw std::logic_error("Colour3DPlotRenderer::scaleDrawBufferImage: Can only use this function when making the image larger; should be rendering DrawBufferPixelResolution instead");
+        throw std::logic_error("Colour3DPlotRenderer::scaleDrawBufferValues: Can only use this function when making the image larger; should be rendering DrawBufferPixelResolution instead");
     }
 
     if (sourceWidth <= 0 || sourceHeight <= 0) {
-        throw std::logic_error("Colour3DPlotRenderer::scaleDrawBufferImage: Source image is empty");
+        throw std::logic_error("Colour3DPlotRenderer::scaleDrawBufferValues: Source image is empty");
     }
 
     if (targetWidth <= 0 || targetHeight <= 0) {
-        throw std::logic_error("Colour3DPlotRenderer::scaleDrawBufferImage: Target image is empty");
+        throw std::logic_error("Colour3DPlotRenderer::scaleDrawBufferValues: Target image is empty");
     }        
 
-    // This function exists because of some unpredictable behaviour
-    // from Qt when scaling images with FastTransformation mode. We
-    // continue to use Qt's scaler for SmoothTransformation but let's
-    // bring the non-interpolated version "in-house" so we know what
-    // it's really doing.
-    
-    if (m_params.interpolate) {
-        return image.scaled(targetWidth, targetHeight,
-                            Qt::IgnoreAspectRatio,
-                            Qt::SmoothTransformation);
+    if (targetLeft < 0 || targetCount < 0 ||
+        targetLeft + targetCount > targetWidth) {
+        throw std::logic_error("Colour3DPlotRenderer::scaleDrawBufferValues: Target columns out of range");
     }
+
+    if (targetCount == 0) return;
     
-    // Same format as the target cache
-    QImage target(targetWidth, targetHeight,
-                  QImage::Format_ARGB32_Premultiplied);
+    // We scale the values rather than the coloured image, so that
+    // the scaled values can be retained in the value cache and the
+    // image regenerated from them with a different colour map. When
+    // interpolating, that means we interpolate between values and
+    // then colour-map the result, rather than blending colours.
 
-    for (int y = 0; y < targetHeight; ++y) {
+    const float *source = m_drawValues.data();
+    int sourceStride = m_drawBuffer.width();
 
-        QRgb *targetLine = reinterpret_cast<QRgb *>
-            (target.scanLine(y));
-        
-        int sy = int((uint64_t(y) * sourceHeight) / targetHeight);
-        if (sy == sourceHeight) --sy;
+    if (!m_params.interpolate) {
 
-        const QRgb *sourceLine = reinterpret_cast<const QRgb *>
-            (image.constScanLine(sy));
+        // Nearest neighbour. The source column for each target column
+        // depends only on x, so we work out once which runs of target
+        // columns come from which source column, and then fill each
+        // run in every row. Consecutive target rows that come from
+        // the same source row are simply copied from the first.
 
-        int psx = -1;
-        QRgb colour = {};
+        std::vector<std::pair<int, int>> runs; // source column, run length
+
+        int64_t num = int64_t(targetLeft) * sourceWidth;
+        int sx = int(num / targetWidth);
+        int64_t rem = num % targetWidth;
         
-        for (int x = 0; x < targetWidth; ++x) {
+        for (int x = 0; x < targetCount; ++x) {
+            int csx = std::min(sx, sourceWidth - 1);
+            if (!runs.empty() && runs.rbegin()->first == csx) {
+                ++runs.rbegin()->second;
+            } else {
+                runs.push_back({ csx, 1 });
+            }
+            rem += sourceWidth;
+            while (rem >= targetWidth) {
+                rem -= targetWidth;
+                ++sx;
+            }
+        }
 
-            int sx = int((uint64_t(x) * sourceWidth) / targetWidth);
-            if (sx == sourceWidth) --sx;
+        int prevSy = -1;
+        
+        for (int y = 0; y < targetHeight; ++y) {
 
-            if (sx > psx) {
-                colour = sourceLine[sx];
+            float *targetLine = targetRows[y];
+        
+            int sy = int((int64_t(y) * sourceHeight) / targetHeight);
+            if (sy == sourceHeight) --sy;
+
+            if (sy == prevSy) {
+                std::copy(targetRows[y-1], targetRows[y-1] + targetCount,
+                          targetLine);
+                continue;
             }
+            prevSy = sy;
             
-            targetLine[x] = colour;
-            psx = sx;
+            const float *sourceLine = source + size_t(sy) * sourceStride;
+
+            for (const auto &r: runs) {
+                std::fill_n(targetLine, r.second, sourceLine[r.first]);
+                targetLine += r.second;
+            }
+        }
+
+        return;
+    }
+
+    // Bilinear, sampling at pixel centres. A NaN (background) value
+    // at any of the four neighbours is taken from the nearest of them
+    // instead, so that no-data areas keep sharp edges.
+    //
+    // This is done separably: each source row that is needed is
+    // interpolated horizontally just once, into one row of linearly
+    // interpolated values (NaN if either neighbour is NaN) and one of
+    // nearest values, and each target row is then a blend of two of
+    // those. The inner loops are simple enough for the compiler to
+    // vectorise.
+
+    auto sourcePos = [](int t, int sn, int tn, int &s0, int &s1, float &frac) {
+        double s = (t + 0.5) * double(sn) / double(tn) - 0.5;
+        if (s < 0.0) s = 0.0;
+        s0 = int(s);
+        if (s0 >= sn - 1) {
+            s0 = sn - 1;
+            s1 = s0;
+            frac = 0.f;
+        } else {
+            s1 = s0 + 1;
+            frac = float(s - s0);
         }
+    };
+
+    std::vector<int> sx0(targetCount), sx1(targetCount);
+    std::vector<float> fx(targetCount);
+    for (int x = 0; x < targetCount; ++x) {
+        sourcePos(targetLeft + x, sourceWidth, targetWidth,
+                  sx0[x], sx1[x], fx[x]);
     }
 
-    return target;
+    struct HorizontalRow {
+        int sourceRow;
+        std::vector<float> lerped;
+        std::vector<float> nearest;
+    };
+
+    HorizontalRow rows[2] = {
+        { -1, std::vector<float>(targetCount), std::vector<float>(targetCount) },
+        { -1, std::vector<float>(targetCount), std::vector<float>(targetCount) }
+    };
+
+    auto getHorizontalRow = [&](int sy) -> const HorizontalRow & {
+        for (auto &r: rows) {
+            if (r.sourceRow == sy) return r;
+        }
+        // Rows are requested in non-decreasing order, so the one
+        // with the lower source row is no longer needed
+        HorizontalRow &r = (rows[0].sourceRow < rows[1].sourceRow ?
+                            rows[0] : rows[1]);
+        r.sourceRow = sy;
+        const float *line = source + size_t(sy) * sourceStride;
+        for (int x = 0; x < targetCount; ++x) {
+            float a = line[sx0[x]], b = line[sx1[x]];
+            float f = fx[x];
+            r.lerped[x] = a + (b - a) * f;
+            r.nearest[x] = (f < 0.5f ? a : b);
+        }
+        return r;
+    };
+
+    for (int y = 0; y < targetHeight; ++y) {
+
+        int sy0, sy1;
+        float fy;
+        sourcePos(y, sourceHeight, targetHeight, sy0, sy1, fy);
+
+        const HorizontalRow &r0 = getHorizontalRow(sy0);
+        const HorizontalRow &r1 = getHorizontalRow(sy1);
+
+        const float *top = r0.lerped.data();
+        const float *bottom = r1.lerped.data();
+        const float *nearest = (fy < 0.5f ? r0 : r1).nearest.data();
+        
+        float *targetLine = targetRows[y];
+
+        for (int x = 0; x < targetCount; ++x) {
+            // NaN in either row propagates through the blend
+            float value = top[x] + (bottom[x] - top[x]) * fy;
+            targetLine[x] = (std::isnan(value) ? nearest[x] : value);
+        }
+    }
 }
 
 void
@@ -923,7 +1257,7 @@ Colour3DPlotRenderer::renderToCacheBinResolution(const LayerGeometryProvider *v,
     
     // Draw to the draw buffer, and then scale-copy from there. Draw
     // buffer is at bin resolution, i.e. buffer x == source column
-    // number. We use toolkit smooth scaling for interpolation.
+    // number. See scaleDrawBufferValues for interpolation.
 
     auto model = ModelById::getAs<DenseThreeDimensionalModel>(m_sources.source);
     if (!model) return;
@@ -954,9 +1288,11 @@ Colour3DPlotRenderer::renderToCacheBinResolution(const LayerGeometryProvider *v,
     // subsequent return values are equally spaced
 
     int edgeBinResolution = int(round(renderBinResolution));
+
+    auto table = v->getPixelFrameTable();
     
     for (int x = x0; ; --x) {
-        sv_frame_t f = v->getFrameForX(x);
+        sv_frame_t f = table->getFrameForX(x);
         if (sv_frame_t (f / edgeBinResolution) * edgeBinResolution == f) {
             if (leftCropFrame == -1) leftCropFrame = f;
             else if (x < x0 - 2) {
@@ -967,9 +1303,9 @@ Colour3DPlotRenderer::renderToCacheBinResolution(const LayerGeometryProvider *v,
     }
     
     for (int x = x0 + repaintWidth; ; ++x) {
-        sv_frame_t f = v->getFrameForX(x);
+        sv_frame_t f = table->getFrameForX(x);
         if (sv_frame_t (f / edgeBinResolution) * edgeBinResolution == f) {
-            if (v->getXForFrame(f) < x0 + repaintWidth) {
+            if (table->getXForFrame(f) < x0 + repaintWidth) {
                 continue;
             }
             if (rightCropFrame == -1) rightCropFrame = f;
@@ -1014,10 +1350,7 @@ Colour3DPlotRenderer::renderToCacheBinResolution(const LayerGeometryProvider *v,
     // fullResolutionCacheIndex will remain at -1 which indicates to
     // use the original source direct
     for (int ix = 0; in_range_for(m_sources.peakCaches, ix); ++ix) {
-        auto peakCache = ModelById::getAs<Dense3DModelPeakCache>
-            (m_sources.peakCaches[ix]);
-        if (!peakCache) continue;
-        int bpp = peakCache->getColumnsPerPeak();
+        int bpp = getSourceColumnsPerPeak(ix);
         if (bpp == 1) {
             fullResolutionCacheIndex = ix;
             break;
@@ -1039,8 +1372,8 @@ Colour3DPlotRenderer::renderToCacheBinResolution(const LayerGeometryProvider *v,
 
     if (attainedWidth == 0) return;
 
-    int scaledLeft = v->getXForFrame(leftBoundaryFrame);
-    int scaledRight = v->getXForFrame(rightBoundaryFrame);
+    int scaledLeft = table->getXForFrame(leftBoundaryFrame);
+    int scaledRight = table->getXForFrame(rightBoundaryFrame);
 
 #ifdef DEBUG_COLOUR_PLOT_REPAINT
     SVDEBUG << "render " << m_sources.source
@@ -1051,11 +1384,10 @@ Colour3DPlotRenderer::renderToCacheBinResolution(const LayerGeometryProvider *v,
             << attainedWidth << ")" << endl;
 #endif
 
-    QImage scaled = scaleDrawBufferImage
-        (m_drawBuffer, scaledRight - scaledLeft, h);
-            
-    int scaledLeftCrop = v->getXForFrame(leftCropFrame);
-    int scaledRightCrop = v->getXForFrame(rightCropFrame);
+    int scaledWidth = scaledRight - scaledLeft;
+    
+    int scaledLeftCrop = table->getXForFrame(leftCropFrame);
+    int scaledRightCrop = table->getXForFrame(rightCropFrame);
     
     int targetLeft = scaledLeftCrop;
     if (targetLeft < 0) {
@@ -1095,20 +1427,35 @@ Colour3DPlotRenderer::renderToCacheBinResolution(const LayerGeometryProvider *v,
             << ", targetWidth = " << targetWidth << endl;
 #endif
     
+    if (sourceLeft + targetWidth > scaledWidth) {
+        targetWidth = scaledWidth - sourceLeft;
+    }
+    
     if (targetWidth > 0) {
-        // we are copying from an image that has already been scaled,
-        // hence using the same width in both geometries
-        m_cache.drawImage(targetLeft, targetWidth,
-                          scaled,
-                          sourceLeft, targetWidth);
+        // Scale only the columns that are going to be used, straight
+        // into the value cache, and then colour-map them straight
+        // into the image cache, with no intermediate image
+        vector<float *> valueRows(h);
+        for (int y = 0; y < h; ++y) {
+            valueRows[y] = m_valueCache.getRowForWriting(y) + targetLeft;
+        }
+        scaleDrawBufferValues(drawBufferWidth, h, scaledWidth, h,
+                              sourceLeft, targetWidth, valueRows.data());
+        for (int y = 0; y < h; ++y) {
+            mapValuesToColours(valueRows[y],
+                               m_cache.getScanLineForWriting(y) + targetLeft,
+                               targetWidth);
+        }
+        m_cache.markDrawn(targetLeft, targetWidth);
+        m_valueCache.markColumnsSet(targetLeft, targetWidth);
     }
     
     for (int i = 0; i < targetWidth; ++i) {
         // but the mag range vector has not been scaled
-        int sourceIx = int((double(i + sourceLeft) / scaled.width())
+        int sourceIx = int((double(i + sourceLeft) / scaledWidth)
                            * int(m_magRanges.size()));
         if (in_range_for(m_magRanges, sourceIx)) {
-            m_magCache.sampleColumn(i, m_magRanges.at(sourceIx));
+            m_magCache.sampleColumn(targetLeft + i, m_magRanges.at(sourceIx));
         }
     }
 }
@@ -1135,7 +1482,7 @@ Colour3DPlotRenderer::renderDrawBuffer(int w, int h,
         auto peakCache = ModelById::getAs<Dense3DModelPeakCache>
             (m_sources.peakCaches[peakCacheIndex]);
         if (peakCache) {
-            divisor = peakCache->getColumnsPerPeak();
+            divisor = getSourceColumnsPerPeak(peakCacheIndex);
             sourceModel = peakCache;
         }
     }
@@ -1198,6 +1545,7 @@ Colour3DPlotRenderer::renderDrawBuffer(int w, int h,
     int modelWidth = sourceModel->getWidth();
 
     QRgb *target = reinterpret_cast<QRgb *>(m_drawBuffer.bits());
+    float *values = m_drawValues.data();
     int targetWidth = m_drawBuffer.width();
     
 #ifdef DEBUG_COLOUR_PLOT_REPAINT
@@ -1213,7 +1561,8 @@ Colour3DPlotRenderer::renderDrawBuffer(int w, int h,
     
     RenderTimer timer(timeConstrained ?
                       RenderTimer::FastRender :
-                      RenderTimer::NoTimeout);
+                      RenderTimer::NoTimeout,
+                      m_renderTimeScale);
 
     for (int x = start; x != finish; x += step) {
 
@@ -1294,6 +1643,7 @@ Colour3DPlotRenderer::renderDrawBuffer(int w, int h,
         if (!haveAnything) {
             for (int y = 0; y < h; ++y) {
                 target[y * targetWidth + x] = m_colourmap.at(0);
+                values[y * targetWidth + x] = noValue;
             }
         } else {
 
@@ -1309,6 +1659,7 @@ Colour3DPlotRenderer::renderDrawBuffer(int w, int h,
                     auto value = distributedColumn[y];
                     auto pixel = m_params.colourScale.getPixel(value);
                     target[y * targetWidth + x] = m_colourmap.at(pixel);
+                    values[y * targetWidth + x] = value;
                 }
             } else {
                 for (int y = h-1; y >= 0; --y) {
@@ -1316,6 +1667,7 @@ Colour3DPlotRenderer::renderDrawBuffer(int w, int h,
                     auto pixel = m_params.colourScale.getPixel(value);
                     int py = h - y - 1;
                     target[py * targetWidth + x] = m_colourmap.at(pixel);
+                    values[py * targetWidth + x] = value;
                 }
             }
         }            
@@ -1361,7 +1713,8 @@ Colour3DPlotRenderer::renderDrawBufferPeakFrequencies(const LayerGeometryProvide
     
     RenderTimer timer(timeConstrained ?
                       RenderTimer::SlowRender :
-                      RenderTimer::NoTimeout);
+                      RenderTimer::NoTimeout,
+                      m_renderTimeScale);
 
     Profiler profiler("Colour3DPlotRenderer::renderDrawBufferPeakFrequencies");
     
@@ -1377,7 +1730,13 @@ Colour3DPlotRenderer::renderDrawBufferPeakFrequencies(const LayerGeometryProvide
     int nbins  = int(binfory[h-1]) - minbin + 1;
     if (minbin + nbins > sh) nbins = sh - minbin;
 
-    FFTModel::PeakSet peakfreqs;
+    // Peaks for the current column, either from the shared cache or
+    // (lacking one) calculated here into the local buffers
+    std::vector<int> peakBuffer;
+    std::vector<float> peakFreqBuffer;
+    const int *peakBins = nullptr;
+    const float *peakFreqs = nullptr;
+    int peakCount = 0;
 
     int psx = -1;
     
@@ -1407,6 +1766,7 @@ Colour3DPlotRenderer::renderDrawBufferPeakFrequencies(const LayerGeometryProvide
         (double(minbin + nbins - 1) * fft->getSampleRate()) / fft->getFFTSize();
 
     QRgb *target = reinterpret_cast<QRgb *>(m_drawBuffer.bits());
+    float *values = m_drawValues.data();
     int targetWidth = m_drawBuffer.width();
     
     bool logarithmic = (m_params.binScale == BinScale::Log);
@@ -1450,8 +1810,23 @@ Colour3DPlotRenderer::renderDrawBufferPeakFrequencies(const LayerGeometryProvide
 
             if (sx == sx0) {
                 pixelPeakColumn = preparedColumn;
-                peakfreqs = fft->getPeakFrequencies(FFTModel::AllPeaks, sx,
-                                                    minbin, minbin + nbins - 1);
+                if (m_sources.peakFrequencies) {
+                    m_sources.peakFrequencies->getPeaks
+                        (sx, minbin, minbin + nbins - 1,
+                         peakBins, peakFreqs, peakCount);
+                } else {
+                    FFTModel::PeakSet peakfreqs = fft->getPeakFrequencies
+                        (FFTModel::AllPeaks, sx, minbin, minbin + nbins - 1);
+                    peakBuffer.clear();
+                    peakFreqBuffer.clear();
+                    for (const auto &p: peakfreqs) {
+                        peakBuffer.push_back(p.first);
+                        peakFreqBuffer.push_back(float(p.second));
+                    }
+                    peakBins = peakBuffer.data();
+                    peakFreqs = peakFreqBuffer.data();
+                    peakCount = int(peakBuffer.size());
+                }
             } else {
                 for (int i = 0; in_range_for(pixelPeakColumn, i); ++i) {
                     pixelPeakColumn[i] = std::max(pixelPeakColumn[i],
@@ -1463,15 +1838,14 @@ Colour3DPlotRenderer::renderDrawBufferPeakFrequencies(const LayerGeometryProvide
         if (!pixelPeakColumn.empty()) {
 
 #ifdef DEBUG_COLOUR_PLOT_REPAINT
-//            SVDEBUG << "found " << peakfreqs.size() << " peak freqs at column "
+//            SVDEBUG << "found " << peakCount << " peak freqs at column "
 //                    << sx0 << endl;
 #endif
 
-            for (FFTModel::PeakSet::const_iterator pi = peakfreqs.begin();
-                 pi != peakfreqs.end(); ++pi) {
+            for (int pi = 0; pi < peakCount; ++pi) {
 
-                int bin = pi->first;
-                double freq = pi->second;
+                int bin = peakBins[pi];
+                double freq = peakFreqs[pi];
 
                 if (bin < minbin) continue;
                 if (bin >= minbin + nbins) break;
@@ -1493,6 +1867,7 @@ Colour3DPlotRenderer::renderDrawBufferPeakFrequencies(const LayerGeometryProvide
 #endif
 
                 target[iy * targetWidth + x] = m_colourmap.at(pixel);
+                values[iy * targetWidth + x] = float(value);
             }
 
         } else {
@@ -1551,6 +1926,7 @@ Colour3DPlotRenderer::recreateDrawBuffer(int w, int h)
     }
     m_drawBuffer.fill(m_params.colourScale.getColourForPixel
                       (0, m_params.colourRotation));
+    m_drawValues.assign(size_t(w) * h, noValue);
     m_magRanges = vector<MagnitudeRange>(w);
 }
 
@@ -1562,6 +1938,7 @@ Colour3DPlotRenderer::clearDrawBuffer(int w, int h)
     } else {
         m_drawBuffer.fill(m_params.colourScale.getColourForPixel
                           (0, m_params.colourRotation));
+        m_drawValues.assign(size_t(m_drawBuffer.width()) * h, noValue);
         m_magRanges = vector<MagnitudeRange>(w);
     }
 }
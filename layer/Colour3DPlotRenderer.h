@@ -19,6 +19,7 @@
 #include "ColourScale.h"
 #include "ScrollableImageCache.h"
 #include "ScrollableMagRangeCache.h"
+#include "ScrollableValueCache.h"
 
 #include "base/ColumnOp.h"
 #include "base/MagnitudeRange.h"
@@ -36,6 +37,7 @@ class VerticalBinLayer;
 class RenderTimer;
 class Dense3DModelPeakCache;
 class DenseThreeDimensionalModel;
+class PeakFrequencyCache;
 
 enum class BinDisplay {
     AllBins,
@@ -52,13 +54,20 @@ class Colour3DPlotRenderer
 {
 public:
     struct Sources {
-        Sources() : verticalBinLayer(0) { }
+        Sources() : verticalBinLayer(0), peakFrequencies(0) { }
         
         // These must all outlive this class
         const VerticalBinLayer *verticalBinLayer; // always
         ModelId source; // always; a DenseThreeDimensionalModel
         ModelId fft; // optionally; an FFTModel; used for phase/peak-freq modes
-        std::vector<ModelId> peakCaches; // zero or more
+        std::vector<ModelId> peakCaches; // zero or more; each a
+                                         // Dense3DModelPeakCache on
+                                         // source or on another
+                                         // peak cache
+        PeakFrequencyCache *peakFrequencies; // optionally; on fft, for
+                                             // peak-freq mode; may be
+                                             // shared with other
+                                             // renderers
     };        
 
     struct Parameters {
@@ -120,6 +129,32 @@ public:
     
     Colour3DPlotRenderer(Sources sources, Parameters parameters);
 
+    /**
+     * Return the parameters this renderer is currently using.
+     */
+    const Parameters &getParameters() const { return m_params; }
+
+    /**
+     * Return true if the given parameters differ from the current
+     * ones only in ways that affect the mapping from value to colour
+     * (colour map, rotation, gain, threshold, display range and so
+     * on), so that recolour() could apply them.
+     */
+    bool isColourOnlyChange(const Parameters &parameters) const;
+
+    /**
+     * Switch to the given parameters, which must differ from the
+     * current ones only in their colour mapping, and regenerate the
+     * cached image from the retained values without going back to
+     * the source model. This is much cheaper than rendering afresh.
+     *
+     * Return false, leaving this renderer unchanged, if the change is
+     * not colour-only or if the cache holds pixels for which no value
+     * was retained. The caller should then replace the renderer with
+     * a new one.
+     */
+    bool recolour(const Parameters &parameters);
+
     struct RenderResult {
         /**
          * The rect that was actually rendered. May be equal to the
@@ -241,11 +276,18 @@ public:
      * this is not possible. \see ImageRegionFinder
      */
     QRect findSimilarRegionExtents(QPoint point) const;
+
+    /**
+     * Return the approximate amount of memory in bytes used by the
+     * caches and buffers held by this renderer, for accounting with
+     * LayerCacheBudget.
+     */
+    qint64 getMemoryUsage() const;
     
 private:
     const Sources m_sources;
-    const Parameters m_params;
-    const std::vector<QRgb> m_colourmap;
+    Parameters m_params;
+    std::vector<QRgb> m_colourmap;
 
     // Draw buffer is the target of each partial repaint. It is always
     // at view height (not model height) and is cleared and repainted
@@ -253,6 +295,15 @@ private:
     // member is to avoid reallocation.
     QImage m_drawBuffer;
 
+    // The values that were mapped to colours in the draw buffer, one
+    // per pixel with the same layout (width of m_drawBuffer, row
+    // zero at top), NaN where the background colour was used.
+    std::vector<float> m_drawValues;
+
+    // Target of renderDirectTranslucent, which fills cells into it
+    // and then paints it in one go. Stored only to avoid reallocation.
+    QImage m_translucentBuffer;
+
     // A temporary store of magnitude ranges per-column, used when
     // rendering to the draw buffer. This always has the same length
     // as the width of the draw buffer, and the x coordinates of the
@@ -277,9 +328,20 @@ private:
     // versa (as the image cache is limited to contiguous ranges).
     ScrollableMagRangeCache m_magCache;
 
+    // The value cache holds, for each pixel of the image cache, the
+    // value that was colour-mapped to produce it, so that the image
+    // can be recoloured in place. It is sized, zoomed and scrolled in
+    // step with the image cache, and written whenever the image cache
+    // is written.
+    ScrollableValueCache m_valueCache;
+
     double m_secondsPerXPixel;
     bool m_secondsPerXPixelValid;
 
+    // From the view for the render in progress, to scale the limits
+    // of its RenderTimer
+    double m_renderTimeScale;
+
     bool getBinResolutions(const LayerGeometryProvider *v,
                            int &binResolution,
                            double &renderBinResolution) const;
@@ -289,6 +351,7 @@ private:
 
     MagnitudeRange renderDirectTranslucent(const LayerGeometryProvider *v,
                                            QPainter &paint, QRect rect);
+    void fillTranslucentCell(int x0, int x1, int y0, int y1, QRgb colour);
     
     void renderToCachePixelResolution(const LayerGeometryProvider *v, int x0,
                                       int repaintWidth, bool rightToLeft,
@@ -322,14 +385,23 @@ private:
 
     RenderType decideRenderType(const LayerGeometryProvider *) const;
 
-    QImage scaleDrawBufferImage(QImage source, int targetWidth, int targetHeight)
-        const;
+    // Scale the values in the draw buffer up to targetWidth x
+    // targetHeight, writing only the targetCount columns starting at
+    // targetLeft, with row y going to targetRows[y]
+    void scaleDrawBufferValues(int sourceWidth, int sourceHeight,
+                               int targetWidth, int targetHeight,
+                               int targetLeft, int targetCount,
+                               float *const *targetRows) const;
+
+    void mapValuesToColours(const float *values, QRgb *target, int n) const;
     
     ColumnOp::Column getColumn(int sx, int minbin, int nbins,
                                std::shared_ptr<DenseThreeDimensionalModel> source) const;
     ColumnOp::Column getColumnRaw(int sx, int minbin, int nbins,
                                   std::shared_ptr<DenseThreeDimensionalModel> source) const;
 
+    int getSourceColumnsPerPeak(int peakCacheIndex) const;
+    
     void getPreferredPeakCache(const LayerGeometryProvider *,
                                int &peakCacheIndex, int &binsPerPeak) const;
 
@@ -0,0 +1,193 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+    Sonic Visualiser
+    An audio file viewer and annotation editor.
+    Centre for Digital Music, Queen Mary, University of London.
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation; either version 2 of the
+    License, or (at your option) any later version.  See the file
+    COPYING included with this distribution for more information.
+*/
+
+#include "Colour3DPlotRendererPool.h"
+
+#include "LayerGeometryProvider.h"
+#include "Layer.h"
+
+#include "base/Debug.h"
+
+#include <vector>
+
+//#define DEBUG_COLOUR_3D_PLOT_RENDERER_POOL 1
+
+namespace sv {
+
+Colour3DPlotRendererPool::Colour3DPlotRendererPool(const Layer *layer,
+                                                   LayerCacheBudget::Client *c) :
+    m_layer(layer),
+    m_budgetClient(c),
+    m_nextKey(0)
+{
+}
+
+Colour3DPlotRendererPool::~Colour3DPlotRendererPool()
+{
+    clear();
+}
+
+Colour3DPlotRendererPool::Geometry
+Colour3DPlotRendererPool::getGeometry(const LayerGeometryProvider *v) const
+{
+    Geometry g;
+    g.startFrame = v->getStartFrame();
+    g.zoomLevel = v->getZoomLevel();
+    g.size = v->getPaintSize();
+    g.scaleFactor = v->getScaleFactor();
+    if (m_layer) {
+        g.haveExtents = m_layer->getDisplayExtents(g.minY, g.maxY);
+    }
+    g.alignment = v->getAlignmentModel();
+    return g;
+}
+
+bool
+Colour3DPlotRendererPool::isInStep(int viewId, const Entry &entry,
+                                   const Geometry &g) const
+{
+    if (!entry.painted || entry.geometry == g) {
+        return true;
+    }
+    if (!entry.geometry.matchesExceptStart(g)) {
+        return false;
+    }
+
+    // The view has scrolled. If it was in step when the renderer was
+    // last painted, assume it has scrolled along with the others and
+    // just happens to be painted first
+    auto itr = m_viewGeometry.find(viewId);
+    return (itr != m_viewGeometry.end() && itr->second == entry.geometry);
+}
+
+Colour3DPlotRenderer *
+Colour3DPlotRendererPool::getRenderer(const LayerGeometryProvider *v,
+                                      bool share, Factory factory)
+{
+    int viewId = v->getId();
+    Geometry g = getGeometry(v);
+
+    auto vi = m_viewEntries.find(viewId);
+    if (vi != m_viewEntries.end()) {
+        Entry &entry = m_entries.at(vi->second);
+        if (entry.viewIds.size() < 2 ||
+            (share && isInStep(viewId, entry, g))) {
+            return entry.renderer;
+        }
+
+#ifdef DEBUG_COLOUR_3D_PLOT_RENDERER_POOL
+        SVDEBUG << "Colour3DPlotRendererPool::getRenderer: view " << viewId
+                << " is no longer in step with renderer " << vi->second
+                << ", detaching" << endl;
+#endif
+
+        entry.viewIds.erase(viewId);
+        m_viewEntries.erase(vi);
+    }
+
+    if (share) {
+        for (auto &e: m_entries) {
+            if (e.second.painted && e.second.geometry == g) {
+
+#ifdef DEBUG_COLOUR_3D_PLOT_RENDERER_POOL
+                SVDEBUG << "Colour3DPlotRendererPool::getRenderer: view "
+                        << viewId << " sharing renderer " << e.first << endl;
+#endif
+
+                e.second.viewIds.insert(viewId);
+                m_viewEntries[viewId] = e.first;
+                return e.second.renderer;
+            }
+        }
+    }
+
+    int key = m_nextKey++;
+    Entry &entry = m_entries[key];
+    entry.renderer = factory();
+    entry.viewIds.insert(viewId);
+    m_viewEntries[viewId] = key;
+    return entry.renderer;
+}
+
+void
+Colour3DPlotRendererPool::painted(const LayerGeometryProvider *v)
+{
+    int viewId = v->getId();
+    Geometry g = getGeometry(v);
+
+    m_viewGeometry[viewId] = g;
+
+    auto vi = m_viewEntries.find(viewId);
+    if (vi == m_viewEntries.end()) return;
+
+    Entry &entry = m_entries.at(vi->second);
+    entry.geometry = g;
+    entry.painted = true;
+
+    LayerCacheBudget::getInstance()->setUsage
+        (m_budgetClient, vi->second, entry.renderer->getMemoryUsage());
+}
+
+void
+Colour3DPlotRendererPool::discard(int viewId)
+{
+    auto vi = m_viewEntries.find(viewId);
+    if (vi == m_viewEntries.end()) return;
+    deleteEntry(vi->second);
+}
+
+void
+Colour3DPlotRendererPool::evict(int key)
+{
+    if (m_entries.find(key) == m_entries.end()) return;
+    deleteEntry(key);
+}
+
+void
+Colour3DPlotRendererPool::recolour(ParameterProvider provider)
+{
+    std::vector<int> failed;
+    for (auto &e: m_entries) {
+        int viewId = *e.second.viewIds.begin();
+        if (!e.second.renderer->recolour(provider(viewId))) {
+            failed.push_back(e.first);
+        }
+    }
+    for (int key: failed) {
+        deleteEntry(key);
+    }
+}
+
+void
+Colour3DPlotRendererPool::clear()
+{
+    while (!m_entries.empty()) {
+        deleteEntry(m_entries.begin()->first);
+    }
+    m_viewGeometry.clear();
+}
+
+void
+Colour3DPlotRendererPool::deleteEntry(int key)
+{
+    Entry &entry = m_entries.at(key);
+    for (int viewId: entry.viewIds) {
+        m_viewEntries.erase(viewId);
+    }
+    LayerCacheBudget::getInstance()->remove(m_budgetClient, key);
+    delete entry.renderer;
+    m_entries.erase(key);
+}
+
+} // end namespace sv
@@ -0,0 +1,160 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+    Sonic Visualiser
+    An audio file viewer and annotation editor.
+    Centre for Digital Music, Queen Mary, University of London.
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation; either version 2 of the
+    License, or (at your option) any later version.  See the file
+    COPYING included with this distribution for more information.
+*/
+
+#ifndef SV_COLOUR_3D_PLOT_RENDERER_POOL_H
+#define SV_COLOUR_3D_PLOT_RENDERER_POOL_H
+
+#include "Colour3DPlotRenderer.h"
+#include "LayerCacheBudget.h"
+
+#include "base/BaseTypes.h"
+#include "base/ZoomLevel.h"
+
+#include <QSize>
+
+#include <functional>
+#include <map>
+#include <set>
+
+namespace sv {
+
+class LayerGeometryProvider;
+class Layer;
+
+/**
+ * The Colour3DPlotRenderers belonging to a single layer, one for each
+ * view the layer appears in - except that views with identical
+ * geometry (start frame, zoom level, paint size, scale factor,
+ * vertical display extents and alignment) may share a renderer, and
+ * so share its cache. A layer shown in several
+ * panes with locked zoom and scroll position then renders each area
+ * only once, and the other panes paint it from the cache.
+ *
+ * A view sharing a renderer stays with it as long as it remains in
+ * step with the renderer's other views. Because locked views are not
+ * all painted at once, a view whose start frame has changed is taken
+ * to still be in step if it was painted at the renderer's previous
+ * geometry; otherwise, or if its zoom or size differ, it is given a
+ * renderer of its own.
+ *
+ * The renderers' memory is accounted with LayerCacheBudget under
+ * non-negative keys on behalf of the owning layer, which should pass
+ * evictions for those keys on to evict().
+ */
+class Colour3DPlotRendererPool
+{
+public:
+    typedef std::function<Colour3DPlotRenderer *()> Factory;
+    typedef std::function<Colour3DPlotRenderer::Parameters(int viewId)>
+        ParameterProvider;
+
+    /**
+     * Create a pool for the given layer, whose vertical display
+     * extents form part of the geometry that views must share to
+     * share a renderer.
+     */
+    Colour3DPlotRendererPool(const Layer *layer,
+                             LayerCacheBudget::Client *budgetClient);
+    ~Colour3DPlotRendererPool();
+
+    /**
+     * Return the renderer to use for the given view, calling the
+     * factory to make a new one if the view has none and cannot
+     * share one. If share is false, always return a renderer used
+     * only by this view, for example because the layer's rendering
+     * parameters depend on the view.
+     */
+    Colour3DPlotRenderer *getRenderer(const LayerGeometryProvider *v,
+                                      bool share, Factory factory);
+
+    /**
+     * Record that the view's renderer has just been used to paint
+     * the view at its current geometry.
+     */
+    void painted(const LayerGeometryProvider *v);
+
+    /**
+     * Delete the renderer used by the given view, and so that used by
+     * any views sharing it.
+     */
+    void discard(int viewId);
+
+    /**
+     * Delete the renderer accounted with LayerCacheBudget under the
+     * given key.
+     */
+    void evict(int key);
+
+    /**
+     * Apply a colour-only change to all renderers, with the
+     * parameters obtained for one of the views using each. Any
+     * renderer that cannot be recoloured is deleted.
+     */
+    void recolour(ParameterProvider provider);
+
+    /**
+     * Delete all renderers.
+     */
+    void clear();
+
+private:
+    struct Geometry {
+        Geometry() : startFrame(0), scaleFactor(1),
+                     haveExtents(false), minY(0.0), maxY(0.0) { }
+        sv_frame_t startFrame;
+        ZoomLevel zoomLevel;
+        QSize size;
+        int scaleFactor;
+        bool haveExtents;
+        double minY;
+        double maxY;
+        ModelId alignment;
+        bool matchesExceptStart(const Geometry &g) const {
+            return zoomLevel == g.zoomLevel &&
+                size == g.size && scaleFactor == g.scaleFactor &&
+                haveExtents == g.haveExtents &&
+                minY == g.minY && maxY == g.maxY &&
+                alignment == g.alignment;
+        }
+        bool operator==(const Geometry &g) const {
+            return startFrame == g.startFrame && matchesExceptStart(g);
+        }
+    };
+
+    struct Entry {
+        Entry() : renderer(nullptr), painted(false) { }
+        Colour3DPlotRenderer *renderer;
+        Geometry geometry; // as last painted
+        bool painted;
+        std::set<int> viewIds;
+    };
+
+    const Layer *m_layer;
+    LayerCacheBudget::Client *m_budgetClient;
+    std::map<int, Entry> m_entries; // key is budget key
+    std::map<int, int> m_viewEntries; // view id -> entry key
+    std::map<int, Geometry> m_viewGeometry; // view id -> as last painted
+    int m_nextKey;
+
+    Geometry getGeometry(const LayerGeometryProvider *v) const;
+    bool isInStep(int viewId, const Entry &entry, const Geometry &g) const;
+    void deleteEntry(int key);
+
+    Colour3DPlotRendererPool(const Colour3DPlotRendererPool &) =delete;
+    Colour3DPlotRendererPool &operator=(const Colour3DPlotRendererPool &) =delete;
+};
+
+} // end namespace sv
+
+#endif
@@ -0,0 +1,273 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+    Sonic Visualiser
+    An audio file viewer and annotation editor.
+    Centre for Digital Music, Queen Mary, University of London.
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation; either version 2 of the
+    License, or (at your option) any later version.  See the file
+    COPYING included with this distribution for more information.
+*/
+
+#include "EventRectIndex.h"
+
+#include "base/Profiler.h"
+
+#include <algorithm>
+#include <limits>
+#include <cmath>
+
+namespace sv {
+
+static const int nodeCapacity = 16;
+
+void
+EventRectIndex::Rect::extend(const Rect &r)
+{
+    frame0 = std::min(frame0, r.frame0);
+    frame1 = std::max(frame1, r.frame1);
+    value0 = std::min(value0, r.value0);
+    value1 = std::max(value1, r.value1);
+}
+
+EventRectIndex::EventRectIndex() :
+    m_treeCount(0),
+    m_removedCount(0)
+{
+}
+
+void
+EventRectIndex::clear()
+{
+    m_events.clear();
+    m_items.clear();
+    m_order.clear();
+    m_nodes.clear();
+    m_removed.clear();
+    m_treeCount = 0;
+    m_removedCount = 0;
+    m_range = {};
+}
+
+EventRectIndex::Rect
+EventRectIndex::makeRect(const Event &e) const
+{
+    Rect r;
+    r.frame0 = e.getFrame();
+    r.frame1 = e.getFrame() + std::max(e.getDuration(), sv_frame_t(1));
+    auto vr = m_range(e);
+    r.value0 = std::min(vr.first, vr.second);
+    r.value1 = std::max(vr.first, vr.second);
+    return r;
+}
+
+void
+EventRectIndex::build(const EventVector &events, RangeFn range)
+{
+    Profiler profiler("EventRectIndex::build");
+
+    clear();
+
+    m_range = range;
+
+    int n = int(events.size());
+    m_treeCount = n;
+    if (n == 0) return;
+
+    m_events = events;
+    m_items.reserve(n);
+    m_removed.assign(n, false);
+
+    for (const auto &e: events) {
+        m_items.push_back(makeRect(e));
+    }
+
+    // Sort-tile-recursive packing: sort by time, cut into vertical
+    // slabs of roughly sqrt(leaf count) leaves each, sort each slab
+    // by value, and pack consecutive runs into leaves
+
+    m_order.resize(n);
+    for (int i = 0; i < n; ++i) m_order[i] = i;
+
+    auto frameCentre = [this](int i) {
+        return m_items[i].frame0 + (m_items[i].frame1 - m_items[i].frame0) / 2;
+    };
+    auto valueCentre = [this](int i) {
+        return (m_items[i].value0 + m_items[i].value1) / 2.0;
+    };
+
+    std::sort(m_order.begin(), m_order.end(),
+              [&](int a, int b) { return frameCentre(a) < frameCentre(b); });
+
+    int leafCount = (n + nodeCapacity - 1) / nodeCapacity;
+    int slabLeaves = int(ceil(sqrt(double(leafCount))));
+    int slabSize = slabLeaves * nodeCapacity;
+
+    for (int s = 0; s < n; s += slabSize) {
+        int e = std::min(n, s + slabSize);
+        std::sort(m_order.begin() + s, m_order.begin() + e,
+                  [&](int a, int b) { return valueCentre(a) < valueCentre(b); });
+        for (int i = s; i < e; i += nodeCapacity) {
+            Node node;
+            node.first = i;
+            node.count = std::min(nodeCapacity, e - i);
+            node.leaf = true;
+            node.bounds = m_items[m_order[i]];
+            for (int j = 1; j < node.count; ++j) {
+                node.bounds.extend(m_items[m_order[i + j]]);
+            }
+            m_nodes.push_back(node);
+        }
+    }
+
+    // Then pack consecutive nodes into parents until only the root
+    // remains. Children of each branch are contiguous in m_nodes
+
+    int levelStart = 0;
+    int levelEnd = int(m_nodes.size());
+
+    while (levelEnd - levelStart > 1) {
+        for (int i = levelStart; i < levelEnd; i += nodeCapacity) {
+            Node node;
+            node.first = i;
+            node.count = std::min(nodeCapacity, levelEnd - i);
+            node.leaf = false;
+            node.bounds = m_nodes[i].bounds;
+            for (int j = 1; j < node.count; ++j) {
+                node.bounds.extend(m_nodes[i + j].bounds);
+            }
+            m_nodes.push_back(node);
+        }
+        levelStart = levelEnd;
+        levelEnd = int(m_nodes.size());
+    }
+}
+
+void
+EventRectIndex::query(const Rect &r, std::vector<int> &results) const
+{
+    std::vector<int> stack;
+    if (!m_nodes.empty()) {
+        stack.push_back(int(m_nodes.size()) - 1);
+    }
+
+    while (!stack.empty()) {
+        const Node &node = m_nodes[stack.back()];
+        stack.pop_back();
+        if (!node.bounds.overlaps(r)) continue;
+        if (node.leaf) {
+            for (int i = 0; i < node.count; ++i) {
+                int item = m_order[node.first + i];
+                if (!m_removed[item] && m_items[item].overlaps(r)) {
+                    results.push_back(item);
+                }
+            }
+        } else {
+            for (int i = 0; i < node.count; ++i) {
+                stack.push_back(node.first + i);
+            }
+        }
+    }
+
+    for (int item = m_treeCount; item < int(m_items.size()); ++item) {
+        if (!m_removed[item] && m_items[item].overlaps(r)) {
+            results.push_back(item);
+        }
+    }
+
+    std::sort(results.begin(), results.end());
+}
+
+void
+EventRectIndex::replaceRange(sv_frame_t frame0, sv_frame_t frame1,
+                             const EventVector &events)
+{
+    if (!m_range) return;
+
+    Rect r;
+    r.frame0 = frame0;
+    r.frame1 = frame1;
+    r.value0 = -std::numeric_limits<double>::max();
+    r.value1 = std::numeric_limits<double>::max();
+
+    std::vector<int> old;
+    query(r, old);
+    for (int i: old) {
+        m_removed[i] = true;
+        ++m_removedCount;
+    }
+
+    for (const auto &e: events) {
+        Rect er = makeRect(e);
+        if (!er.overlaps(r)) continue;
+        m_events.push_back(e);
+        m_items.push_back(er);
+        m_removed.push_back(false);
+    }
+
+    // Repack once the overflow list is long enough to slow queries
+    // down, or much of the tree is dead
+
+    int overflow = int(m_items.size()) - m_treeCount;
+    
+    if (overflow > std::max(64, m_treeCount / 8) ||
+        m_removedCount > m_treeCount / 2) {
+
+        EventVector live;
+        live.reserve(getEventCount());
+        for (int i = 0; i < int(m_events.size()); ++i) {
+            if (!m_removed[i]) live.push_back(m_events[i]);
+        }
+        std::sort(live.begin(), live.end());
+
+        RangeFn range = m_range;
+        build(live, range);
+    }
+}
+
+EventVector
+EventRectIndex::getEventsOverlapping(sv_frame_t frame0, sv_frame_t frame1,
+                                     double value0, double value1) const
+{
+    Rect r;
+    r.frame0 = frame0;
+    r.frame1 = frame1;
+    r.value0 = std::min(value0, value1);
+    r.value1 = std::max(value0, value1);
+
+    std::vector<int> results;
+    query(r, results);
+
+    EventVector ee;
+    ee.reserve(results.size());
+    for (int i: results) {
+        ee.push_back(m_events[i]);
+    }
+
+    if (int(m_events.size()) > m_treeCount) {
+        // Overflow items come after the tree ones by index, not
+        // necessarily in event order
+        std::sort(ee.begin(), ee.end());
+    }
+    
+    return ee;
+}
+
+EventVector
+EventRectIndex::getEventsCovering(sv_frame_t frame) const
+{
+    return getEventsOverlapping(frame, frame + 1,
+                                -std::numeric_limits<double>::max(),
+                                std::numeric_limits<double>::max());
+}
+
+EventVector
+EventRectIndex::getEventsCovering(sv_frame_t frame, double value) const
+{
+    return getEventsOverlapping(frame, frame + 1, value, value);
+}
+
+} // end namespace sv
@@ -0,0 +1,134 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+    Sonic Visualiser
+    An audio file viewer and annotation editor.
+    Centre for Digital Music, Queen Mary, University of London.
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation; either version 2 of the
+    License, or (at your option) any later version.  See the file
+    COPYING included with this distribution for more information.
+*/
+
+#ifndef SV_EVENT_RECT_INDEX_H
+#define SV_EVENT_RECT_INDEX_H
+
+#include "base/BaseTypes.h"
+#include "base/Event.h"
+
+#include <functional>
+#include <vector>
+
+namespace sv {
+
+/**
+ * A static two-dimensional index of events that occupy a rectangle
+ * in time and value, such as the events in a BoxModel. The index is
+ * a packed R-tree (sort-tile-recursive bulk load) over (frame range,
+ * value range), supporting queries for the events overlapping a given
+ * rectangle, or covering a given point, in roughly logarithmic time
+ * plus the number of results.
+ *
+ * The index is built from a complete set of events. Changes within a
+ * limited frame range can then be applied with replaceRange(), which
+ * marks the old events in the range as removed and keeps the new
+ * ones in a small unindexed overflow list, repacking the whole index
+ * only once enough has changed. Query results are returned in event
+ * order, i.e. normally the model's own event order.
+ */
+class EventRectIndex
+{
+public:
+    /**
+     * Function returning the (lower, upper) value extents of an
+     * event.
+     */
+    typedef std::function<std::pair<double, double>(const Event &)> RangeFn;
+
+    EventRectIndex();
+
+    /**
+     * Build the index from the given events. An event occupies the
+     * frames from its start frame up to, but not including, its end
+     * frame, or just its start frame if it has no duration, as for
+     * EventSeries::getEventsCovering. Its value extents are obtained
+     * from the given function.
+     */
+    void build(const EventVector &events, RangeFn range);
+
+    void clear();
+
+    bool isEmpty() const { return getEventCount() == 0; }
+    int getEventCount() const {
+        return int(m_events.size()) - m_removedCount;
+    }
+
+    /**
+     * Replace every indexed event that overlaps the half-open frame
+     * range [frame0, frame1), at any value, with those of the given
+     * events that overlap it. The events passed may extend beyond the
+     * range: those that do not overlap it are ignored. The index must
+     * have been built first; if it has not, this does nothing.
+     */
+    void replaceRange(sv_frame_t frame0, sv_frame_t frame1,
+                      const EventVector &events);
+
+    /**
+     * Return all events that overlap the half-open frame range
+     * [frame0, frame1) and the closed value range [value0, value1].
+     */
+    EventVector getEventsOverlapping(sv_frame_t frame0, sv_frame_t frame1,
+                                     double value0, double value1) const;
+
+    /**
+     * Return all events that cover the given frame, at any value.
+     */
+    EventVector getEventsCovering(sv_frame_t frame) const;
+
+    /**
+     * Return all events that cover the given frame and value.
+     */
+    EventVector getEventsCovering(sv_frame_t frame, double value) const;
+
+private:
+    struct Rect {
+        sv_frame_t frame0; // inclusive
+        sv_frame_t frame1; // exclusive
+        double value0;
+        double value1;
+
+        bool overlaps(const Rect &r) const {
+            return frame0 < r.frame1 && r.frame0 < frame1 &&
+                value0 <= r.value1 && r.value0 <= value1;
+        }
+        void extend(const Rect &r);
+    };
+
+    struct Node {
+        Rect bounds;
+        int first;  // index into m_items (leaf) or m_nodes (branch)
+        int count;
+        bool leaf;
+    };
+
+    std::vector<Event> m_events;
+    std::vector<Rect> m_items;  // parallel to m_events
+    std::vector<int> m_order;   // item indices in tree (leaf) order
+    std::vector<Node> m_nodes;  // root is last
+
+    // Items from m_treeCount onwards were added by replaceRange and
+    // are not in the tree. Removed items stay in place, flagged
+    std::vector<bool> m_removed; // parallel to m_events
+    int m_treeCount;
+    int m_removedCount;
+    RangeFn m_range;
+
+    Rect makeRect(const Event &e) const;
+    void query(const Rect &r, std::vector<int> &results) const;
+};
+
+} // end namespace sv
+
+#endif
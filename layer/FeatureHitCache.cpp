@@ -0,0 +1,428 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+    Sonic Visualiser
+    An audio file viewer and annotation editor.
+    Centre for Digital Music, Queen Mary, University of London.
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation; either version 2 of the
+    License, or (at your option) any later version.  See the file
+    COPYING included with this distribution for more information.
+*/
+
+#include "FeatureHitCache.h"
+
+#include "LayerGeometryProvider.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+namespace sv {
+
+// Records are kept or discarded according to their horizontal extent
+// only: a feature may be drawn (and hit-tested in a column) while
+// lying partly or wholly outside the vertical extent of the view
+
+static bool
+overlapsHorizontally(const QRect &a, const QRect &b)
+{
+    return a.left() <= b.right() && a.right() >= b.left();
+}
+
+FeatureHitCache::FeatureHitCache() :
+    m_valid(false),
+    m_overflowed(false),
+    m_painting(false),
+    m_columns(0),
+    m_rows(0)
+{
+}
+
+void
+FeatureHitCache::invalidate()
+{
+    m_valid = false;
+    m_overflowed = false;
+    m_covered = QRegion();
+    m_records.clear();
+    m_pendingRemoved.clear();
+    m_cells.clear();
+    m_columns = 0;
+    m_rows = 0;
+}
+
+void
+FeatureHitCache::setVerticalExtents(const std::vector<double> &extents)
+{
+    m_extents = extents;
+}
+
+FeatureHitCache::Geometry
+FeatureHitCache::getGeometry(const LayerGeometryProvider *v) const
+{
+    Geometry g;
+    g.id = v->getId();
+    g.startFrame = v->getStartFrame();
+    g.endFrame = v->getEndFrame();
+    g.size = v->getPaintSize();
+    g.scale = v->getScaleFactor();
+    if (g.scale < 1) g.scale = 1;
+    g.extents = m_extents;
+    return g;
+}
+
+void
+FeatureHitCache::beginPaint(const LayerGeometryProvider *v, QRect rect)
+{
+    Geometry g = getGeometry(v);
+    QRect bounds(QPoint(0, 0), g.size);
+
+    if (!m_valid ||
+        g.id != m_geometry.id ||
+        g.size != m_geometry.size ||
+        g.scale != m_geometry.scale ||
+        g.extents != m_geometry.extents ||
+        g.endFrame - g.startFrame !=
+        m_geometry.endFrame - m_geometry.startFrame) {
+
+        invalidate();
+        m_valid = true;
+        m_geometry = g;
+
+        m_columns = (g.size.width() + cellSize - 1) / cellSize;
+        m_rows = (g.size.height() + cellSize - 1) / cellSize;
+        m_cells = std::vector<std::vector<int>>(m_columns * m_rows);
+
+    } else if (g.startFrame != m_geometry.startFrame) {
+
+        // A horizontal scroll: keep what we can
+
+        int dx = v->getXForFrame(m_geometry.startFrame);
+        m_geometry = g;
+
+        std::vector<Record> kept;
+        for (auto r: m_records) {
+            r.rect.translate(dx, 0);
+            if (overlapsHorizontally(r.rect, bounds)) {
+                kept.push_back(r);
+            }
+        }
+        m_records = kept;
+        m_covered.translate(dx, 0);
+        m_covered &= bounds;
+        rebuildGrid();
+    }
+
+    rect &= bounds;
+
+    // Anything that overlaps the area being painted is going to be
+    // redrawn, so drop it for now and restore it if it reappears
+
+    std::vector<Record> kept;
+    for (const auto &r: m_records) {
+        if (overlapsHorizontally(r.rect, rect)) {
+            m_pendingRemoved.insert({ r.event.getFrame(), r });
+        } else {
+            kept.push_back(r);
+        }
+    }
+    if (kept.size() != m_records.size()) {
+        m_records = kept;
+        rebuildGrid();
+    }
+
+    m_covered -= rect;
+    m_paintRect = rect;
+    m_painting = true;
+}
+
+void
+FeatureHitCache::add(const Event &e, QRect rect)
+{
+    if (!m_painting || m_overflowed) return;
+
+    rect = rect.normalized();
+    if (rect.width() < 1) rect.setWidth(1);
+    if (rect.height() < 1) rect.setHeight(1);
+
+    auto range = m_pendingRemoved.equal_range(e.getFrame());
+    for (auto i = range.first; i != range.second; ++i) {
+        if (i->second.rect == rect && i->second.event == e) {
+            m_pendingRemoved.erase(i);
+            break;
+        }
+    }
+
+    if (int(m_records.size()) >= maxRecords) {
+        // Too dense to be worth it: give up until the next full
+        // repaint at new geometry
+        m_overflowed = true;
+        m_records.clear();
+        m_cells.clear();
+        return;
+    }
+
+    m_records.push_back({ e, rect });
+    addToGrid(int(m_records.size()) - 1);
+}
+
+void
+FeatureHitCache::endPaint()
+{
+    if (!m_painting) return;
+
+    // Records that were removed because they overlapped the painted
+    // area, but were not drawn again, may have extended beyond that
+    // area - so we can no longer vouch for the part of the view they
+    // covered
+
+    for (const auto &p: m_pendingRemoved) {
+        m_covered -= p.second.rect;
+    }
+    m_pendingRemoved.clear();
+
+    m_covered += m_paintRect;
+    m_painting = false;
+}
+
+void
+FeatureHitCache::rebuildGrid()
+{
+    for (auto &c: m_cells) {
+        c.clear();
+    }
+    for (int i = 0; i < int(m_records.size()); ++i) {
+        addToGrid(i);
+    }
+}
+
+void
+FeatureHitCache::addToGrid(int index)
+{
+    if (m_cells.empty()) return;
+
+    const QRect &r = m_records[index].rect;
+
+    int c0 = std::max(0, r.left() / cellSize);
+    int c1 = std::min(m_columns - 1, r.right() / cellSize);
+    int r0 = std::max(0, r.top() / cellSize);
+    int r1 = std::min(m_rows - 1, r.bottom() / cellSize);
+
+    for (int row = r0; row <= r1; ++row) {
+        for (int col = c0; col <= c1; ++col) {
+            m_cells[row * m_columns + col].push_back(index);
+        }
+    }
+}
+
+bool
+FeatureHitCache::mapQuery(const LayerGeometryProvider *v, QRect &r) const
+{
+    if (!m_valid || m_overflowed || m_painting) {
+        return false;
+    }
+
+    Geometry g = getGeometry(v);
+
+    if (g.id != m_geometry.id ||
+        g.startFrame != m_geometry.startFrame ||
+        g.endFrame != m_geometry.endFrame ||
+        g.extents != m_geometry.extents ||
+        g.size * m_geometry.scale != m_geometry.size * g.scale) {
+        return false;
+    }
+
+    if (g.scale != m_geometry.scale) {
+        r = QRect((r.x() * m_geometry.scale) / g.scale,
+                  (r.y() * m_geometry.scale) / g.scale,
+                  (r.width() * m_geometry.scale) / g.scale,
+                  (r.height() * m_geometry.scale) / g.scale);
+    }
+
+    // We can only answer if we have painted the whole of the query
+    // area at this geometry
+    return (QRegion(r) - m_covered).isEmpty();
+}
+
+void
+FeatureHitCache::collect(QRect r, bool wholeColumns, HitVector &hits) const
+{
+    hits.clear();
+    if (m_cells.empty()) return;
+
+    int c0 = std::max(0, r.left() / cellSize);
+    int c1 = std::min(m_columns - 1, r.right() / cellSize);
+    int r0 = std::max(0, r.top() / cellSize);
+    int r1 = std::min(m_rows - 1, r.bottom() / cellSize);
+
+    std::vector<int> indices;
+    for (int row = r0; row <= r1; ++row) {
+        for (int col = c0; col <= c1; ++col) {
+            const auto &cell = m_cells[row * m_columns + col];
+            indices.insert(indices.end(), cell.begin(), cell.end());
+        }
+    }
+
+    std::sort(indices.begin(), indices.end());
+    indices.erase(std::unique(indices.begin(), indices.end()), indices.end());
+
+    for (int i: indices) {
+        const Record &rec = m_records[i];
+        bool match = wholeColumns ?
+            overlapsHorizontally(rec.rect, r) :
+            rec.rect.intersects(r);
+        if (match) {
+            hits.push_back({ rec.event, rec.rect });
+        }
+    }
+
+    // Return in event order, with one hit per event (an event may
+    // have been recorded more than once, e.g. for a mark and a label)
+
+    std::sort(hits.begin(), hits.end(),
+              [](const Hit &a, const Hit &b) { return a.event < b.event; });
+
+    HitVector merged;
+    for (const auto &h: hits) {
+        if (!merged.empty() && merged.rbegin()->event == h.event) {
+            merged.rbegin()->rect |= h.rect;
+        } else {
+            merged.push_back(h);
+        }
+    }
+    hits = merged;
+}
+
+bool
+FeatureHitCache::getHitsAt(const LayerGeometryProvider *v, QPoint p, int fuzz,
+                           HitVector &hits) const
+{
+    QRect r(p.x() - fuzz, p.y() - fuzz, fuzz * 2 + 1, fuzz * 2 + 1);
+    if (!mapQuery(v, r)) return false;
+    collect(r, false, hits);
+    return true;
+}
+
+bool
+FeatureHitCache::getHitsInColumn(const LayerGeometryProvider *v,
+                                 int x0, int x1, HitVector &hits) const
+{
+    QRect r(x0, 0, x1 - x0 + 1, v->getPaintHeight());
+    if (!mapQuery(v, r)) return false;
+    r.setTop(0);
+    r.setBottom(m_geometry.size.height() - 1);
+    collect(r, true, hits);
+    return true;
+}
+
+bool
+FeatureHitCache::getInstantsNear(const LayerGeometryProvider *v, int x,
+                                 double fuzz, EventVector &events) const
+{
+    HitVector hits;
+    if (!getHitsInColumn(v, int(floor(x - fuzz - 3)), int(ceil(x + fuzz)),
+                         hits)) {
+        return false;
+    }
+
+    events.clear();
+
+    sv_frame_t frame = v->getFrameForX(x);
+    sv_frame_t suitable = 0;
+    bool have = false;
+
+    for (const auto &h: hits) {
+        if (h.event.getFrame() == frame) {
+            suitable = frame;
+            have = true;
+            break;
+        }
+        int px = h.rect.left();
+        if ((px > x && px - x > fuzz) || (px < x && x - px > fuzz + 3)) {
+            continue;
+        }
+        sv_frame_t f = h.event.getFrame();
+        if (!have || llabs(frame - f) < llabs(suitable - f)) {
+            suitable = f;
+            have = true;
+        }
+    }
+
+    if (have) {
+        for (const auto &h: hits) {
+            if (h.event.getFrame() == suitable) {
+                events.push_back(h.event);
+            }
+        }
+    }
+
+    return true;
+}
+
+bool
+FeatureHitCache::getDurationsNear(const LayerGeometryProvider *v, int x,
+                                  int fuzz, EventVector &events) const
+{
+    HitVector hits;
+    if (!getHitsInColumn(v, x, x, hits)) {
+        return false;
+    }
+    if (!hits.empty()) {
+        events = toEvents(hits);
+        return true;
+    }
+    if (!getHitsInColumn(v, x - fuzz, x + fuzz, hits)) {
+        return false;
+    }
+
+    EventVector starting, spanning;
+    for (const auto &h: hits) {
+        if (h.rect.left() > x) starting.push_back(h.event);
+        else spanning.push_back(h.event);
+    }
+    events = (starting.empty() ? spanning : starting);
+    return true;
+}
+
+bool
+FeatureHitCache::getNearestInColumn(const LayerGeometryProvider *v,
+                                    int x, int y, Anchor anchor,
+                                    bool &found, Event &event) const
+{
+    HitVector hits;
+    if (!getHitsInColumn(v, x, x, hits)) {
+        return false;
+    }
+
+    found = false;
+    int nearestDistance = -1;
+
+    for (const auto &h: hits) {
+        int ay = h.rect.top();
+        if (anchor == Anchor::Centre) ay += h.rect.height()/2;
+        int distance = abs(ay - y);
+        if (nearestDistance == -1 || distance < nearestDistance) {
+            nearestDistance = distance;
+            event = h.event;
+            found = true;
+        }
+    }
+
+    return true;
+}
+
+EventVector
+FeatureHitCache::toEvents(const HitVector &hits)
+{
+    EventVector ee;
+    ee.reserve(hits.size());
+    for (const auto &h: hits) {
+        ee.push_back(h.event);
+    }
+    return ee;
+}
+
+} // end namespace sv
@@ -0,0 +1,198 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+    Sonic Visualiser
+    An audio file viewer and annotation editor.
+    Centre for Digital Music, Queen Mary, University of London.
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation; either version 2 of the
+    License, or (at your option) any later version.  See the file
+    COPYING included with this distribution for more information.
+*/
+
+#ifndef SV_FEATURE_HIT_CACHE_H
+#define SV_FEATURE_HIT_CACHE_H
+
+#include "base/BaseTypes.h"
+#include "base/Event.h"
+
+#include <QRect>
+#include <QRegion>
+
+#include <map>
+#include <vector>
+
+namespace sv {
+
+class LayerGeometryProvider;
+
+/**
+ * A record of the screen rectangles occupied by the events a sparse
+ * layer drew in its most recent paints to a view, held in a uniform
+ * spatial grid, so that hover, illumination and click hit-tests can
+ * be answered without going back to the model or redoing any
+ * frame/value to pixel conversions.
+ *
+ * The cache knows which parts of the view have been painted at the
+ * current geometry. Within those parts it can give a definitive
+ * answer (including "nothing here"); elsewhere, or if the geometry
+ * has changed other than by a horizontal scroll, or while a paint is
+ * in progress, its query functions return false and the caller
+ * should fall back to querying the model. The geometry includes the
+ * vertical extents last given to setVerticalExtents, so a vertical
+ * zoom counts as a change even if the layer is not told about it.
+ *
+ * A layer keeps one of these per view id, and records into it using
+ * a Recorder in its paint function.
+ */
+class FeatureHitCache
+{
+public:
+    FeatureHitCache();
+
+    struct Hit {
+        Event event;
+        QRect rect;
+    };
+    typedef std::vector<Hit> HitVector;
+
+    /**
+     * Records the events drawn during a single paint call. Create
+     * one at the start of Layer::paint and call add() for each event
+     * drawn; the paint is complete when the recorder is destroyed.
+     */
+    class Recorder
+    {
+    public:
+        Recorder(FeatureHitCache &cache,
+                 const LayerGeometryProvider *v, QRect rect) :
+            m_cache(cache) {
+            m_cache.beginPaint(v, rect);
+        }
+        ~Recorder() {
+            m_cache.endPaint();
+        }
+        void add(const Event &e, QRect rect) {
+            m_cache.add(e, rect);
+        }
+    private:
+        FeatureHitCache &m_cache;
+        Recorder(const Recorder &) =delete;
+        Recorder &operator=(const Recorder &) =delete;
+    };
+
+    /**
+     * Discard everything, e.g. because the model or a property
+     * affecting layout has changed.
+     */
+    void invalidate();
+
+    /**
+     * Set the values that determine the vertical placement of
+     * features in the view as it is now, for example the display
+     * extents of the layer and of the scale it is aligned to. The
+     * layer sets these before every paint or query; if they differ
+     * from those the records were made with, the records are not
+     * used.
+     */
+    void setVerticalExtents(const std::vector<double> &extents);
+
+    /**
+     * Find the events whose rects, expanded by fuzz pixels on all
+     * sides, contain the given point. Return false if the cache
+     * can't say.
+     */
+    bool getHitsAt(const LayerGeometryProvider *v, QPoint p, int fuzz,
+                   HitVector &hits) const;
+
+    /**
+     * Find the events whose rects overlap the given horizontal range
+     * at any y coordinate. Return false if the cache can't say.
+     */
+    bool getHitsInColumn(const LayerGeometryProvider *v, int x0, int x1,
+                         HitVector &hits) const;
+
+    /**
+     * For layers of events without duration: find the events at the
+     * frame nearest to x that were drawn within fuzz pixels of it (a
+     * little further to the left, as instants are drawn rightward
+     * from their frame). The result is empty if there are none.
+     * Return false if the cache can't say.
+     */
+    bool getInstantsNear(const LayerGeometryProvider *v, int x, double fuzz,
+                         EventVector &events) const;
+
+    /**
+     * For layers of events with duration: find the events covering
+     * x, or failing that those starting within fuzz pixels to the
+     * right of it, or failing that those ending within fuzz pixels to
+     * the left. The result is empty if there are none. Return false
+     * if the cache can't say.
+     */
+    bool getDurationsNear(const LayerGeometryProvider *v, int x, int fuzz,
+                          EventVector &events) const;
+
+    enum class Anchor {
+        Top,    // The event's value is at the top of its rect
+        Centre  // The event's value is at the vertical centre
+    };
+
+    /**
+     * Find the event, among those whose rects overlap x, whose value
+     * was drawn nearest to y, as indicated by the anchor. Set found
+     * according to whether there is one. Return false if the cache
+     * can't say.
+     */
+    bool getNearestInColumn(const LayerGeometryProvider *v, int x, int y,
+                            Anchor anchor, bool &found, Event &event) const;
+
+    static EventVector toEvents(const HitVector &hits);
+
+private:
+    struct Geometry {
+        Geometry() : id(0), startFrame(0), endFrame(0), scale(1) { }
+        int id;
+        sv_frame_t startFrame;
+        sv_frame_t endFrame;
+        QSize size;
+        int scale;
+        std::vector<double> extents;
+    };
+
+    struct Record {
+        Event event;
+        QRect rect;
+    };
+
+    static const int cellSize = 32;
+    static const int maxRecords = 20000;
+
+    Geometry m_geometry;
+    std::vector<double> m_extents;
+    bool m_valid;
+    bool m_overflowed;
+    bool m_painting;
+    QRect m_paintRect;
+    QRegion m_covered;
+    std::vector<Record> m_records;
+    std::multimap<sv_frame_t, Record> m_pendingRemoved;
+    int m_columns;
+    int m_rows;
+    std::vector<std::vector<int>> m_cells;
+
+    Geometry getGeometry(const LayerGeometryProvider *v) const;
+    bool mapQuery(const LayerGeometryProvider *v, QRect &r) const;
+    void rebuildGrid();
+    void addToGrid(int index);
+    void collect(QRect r, bool wholeColumns, HitVector &hits) const;
+
+    void beginPaint(const LayerGeometryProvider *v, QRect rect);
+    void add(const Event &e, QRect rect);
+    void endPaint();
+};
+
+} // end namespace sv
+
+#endif
@@ -40,9 +40,6 @@
 
 namespace sv {
 
-ImageLayer::ImageMap
-ImageLayer::m_images;
-
 ImageLayer::FileSourceMap
 ImageLayer::m_fileSources;
 
@@ -50,9 +47,12 @@ QMutex
 ImageLayer::m_staticMutex;
 
 ImageLayer::ImageLayer() :
+    m_awaitingImages(false),
     m_editing(false),
     m_editingCommand(nullptr)
 {
+    connect(ImageThumbnailCache::getInstance(), SIGNAL(imagesReady()),
+            this, SLOT(imagesReady()));
 }
 
 ImageLayer::~ImageLayer()
@@ -147,13 +147,28 @@ ImageLayer::getLocalPoints(LayerGeometryProvider *v, int x, int ) const
     if (!model) return {};
 
 //    SVDEBUG << "ImageLayer::getLocalPoints(" << x << "," << y << "):";
-    EventVector points(model->getAllEvents());
+
+    const ImageExtents *extents = nullptr;
+    auto eitr = m_extents.find(v->getId());
+    if (eitr != m_extents.end()) {
+        extents = &eitr->second;
+    }
+
+    // Only images starting no further left than the widest image we
+    // have drawn can reach x. Ask for one overspill point beyond the
+    // range, as we need to know where the next image begins
+
+    int maxWidth = (extents ? extents->maxWidth : defaultImageWidth);
+    sv_frame_t frame0 = v->getFrameForX(x - maxWidth);
+    sv_frame_t frame1 = v->getFrameForX(x) + 1;
+    
+    EventVector points(model->getEventsWithin(frame0, frame1 - frame0, 1));
 
     EventVector rv;
 
     for (EventVector::const_iterator i = points.begin(); i != points.end(); ) {
 
-        Event p(*i);
+        const Event &p(*i);
         int px = v->getXForFrame(p.getFrame());
         if (px > x) break;
 
@@ -170,10 +185,12 @@ ImageLayer::getLocalPoints(LayerGeometryProvider *v, int x, int ) const
 
         // this image is a candidate, test it properly
 
-        int width = 32;
-        if (m_scaled[v].find(p.getURI()) != m_scaled[v].end()) {
-            width = m_scaled[v][p.getURI()].width();
-//            SVDEBUG << "scaled width = " << width << endl;
+        int width = defaultImageWidth;
+        if (extents) {
+            auto witr = extents->widths.find(p.getURI());
+            if (witr != extents->widths.end()) {
+                width = witr->second;
+            }
         }
 
         if (x >= px && x < px + width) {
@@ -328,10 +345,18 @@ ImageLayer::drawImage(LayerGeometryProvider *v, QPainter &paint, const Event &p,
     QString additionalText;
 
     QSize imageSize;
-    if (!getImageOriginalSize(imageName, imageSize)) {
+    switch (getImageOriginalSize(imageName, imageSize)) {
+    case ImageThumbnailCache::Ready:
+        break;
+    case ImageThumbnailCache::Pending:
+        image = QImage(":icons/emptypage.png");
+        imageSize = image.size();
+        break;
+    case ImageThumbnailCache::Failed:
         image = QImage(":icons/emptypage.png");
         imageSize = image.size();
         additionalText = imageName;
+        break;
     }
 
     int topMargin = 10;
@@ -379,9 +404,12 @@ ImageLayer::drawImage(LayerGeometryProvider *v, QPainter &paint, const Event &p,
     }
 
     if (image.isNull()) {
-        image = getImage(v, imageName,
-                         QSize(availableWidth,
-                               maxBoxHeight - labelRect.height()));
+        if (getImage(v, imageName,
+                     QSize(availableWidth,
+                           maxBoxHeight - labelRect.height()),
+                     image) == ImageThumbnailCache::Failed) {
+            additionalText = imageName;
+        }
     }
 
     int boxWidth = image.width();
@@ -463,74 +491,72 @@ void
 ImageLayer::setLayerDormant(const LayerGeometryProvider *v, bool dormant)
 {
     if (dormant) {
-        // Delete the images named in the view's scaled map from the
-        // general image map as well.  They can always be re-loaded
-        // if it turns out another view still needs them.
-        QMutexLocker locker(&m_staticMutex);
-        for (ImageMap::iterator i = m_scaled[v].begin();
-             i != m_scaled[v].end(); ++i) {
-            m_images.erase(i->first);
-        }
-        m_scaled.erase(v);
+        // The images themselves are retained (or not) by the shared
+        // thumbnail cache, which will reap them if unused
+        m_extents.erase(v->getId());
     }
 }
 
-//!!! how to reap no-longer-used images?
-
-bool
+ImageThumbnailCache::Status
 ImageLayer::getImageOriginalSize(QString name, QSize &size) const
 {
-//    cerr << "getImageOriginalSize: \"" << name << "\"" << endl;
-
-    QMutexLocker locker(&m_staticMutex);
-    if (m_images.find(name) == m_images.end()) {
-//        cerr << "don't have, trying to open local" << endl;
-        m_images[name] = QImage(getLocalFilename(name));
+    QString filename;
+    {
+        QMutexLocker locker(&m_staticMutex);
+        filename = getLocalFilename(name);
     }
-    if (m_images[name].isNull()) {
-//        cerr << "null image" << endl;
-        return false;
-    } else {
-        size = m_images[name].size();
-        return true;
+
+    auto status = ImageThumbnailCache::getInstance()->getOriginalSize
+        (filename, size);
+    if (status == ImageThumbnailCache::Pending) {
+        m_awaitingImages = true;
     }
+    return status;
 }
 
-QImage 
-ImageLayer::getImage(LayerGeometryProvider *v, QString name, QSize maxSize) const
+ImageThumbnailCache::Status
+ImageLayer::getImage(LayerGeometryProvider *v, QString name, QSize maxSize,
+                     QImage &image) const
 {
 //    SVDEBUG << "ImageLayer::getImage(" << v << ", " << name << ", ("
 //              << maxSize.width() << "x" << maxSize.height() << "))" << endl;
 
-    if (!m_scaled[v][name].isNull()  &&
-        ((m_scaled[v][name].width()  == maxSize.width() &&
-          m_scaled[v][name].height() <= maxSize.height()) ||
-         (m_scaled[v][name].width()  <= maxSize.width() &&
-          m_scaled[v][name].height() == maxSize.height()))) {
-//        cerr << "cache hit" << endl;
-        return m_scaled[v][name];
+    QString filename;
+    {
+        QMutexLocker locker(&m_staticMutex);
+        filename = getLocalFilename(name);
     }
 
-    QMutexLocker locker(&m_staticMutex);
+    ImageThumbnailCache *cache = ImageThumbnailCache::getInstance();
 
-    if (m_images.find(name) == m_images.end()) {
-        m_images[name] = QImage(getLocalFilename(name));
-    }
+    auto status = cache->getImage(filename, maxSize, image);
 
-    if (m_images[name].isNull()) {
-//        cerr << "null image" << endl;
-        m_scaled[v][name] = QImage();
-    } else if (m_images[name].width() <= maxSize.width() &&
-               m_images[name].height() <= maxSize.height()) {
-        m_scaled[v][name] = m_images[name];
-    } else {
-        m_scaled[v][name] =
-            m_images[name].scaled(maxSize,
-                                  Qt::KeepAspectRatio,
-                                  Qt::SmoothTransformation);
+    if (status == ImageThumbnailCache::Failed) {
+        // The header was readable but the image itself was not
+        image = QImage(":icons/emptypage.png");
+    } else if (status == ImageThumbnailCache::Pending) {
+        m_awaitingImages = true;
+        if (image.isNull()) {
+            // Nothing decoded yet: stand in with a blank image of the
+            // eventual size, so the layout doesn't jump when it arrives
+            QSize originalSize;
+            if (cache->getOriginalSize(filename, originalSize) ==
+                ImageThumbnailCache::Ready) {
+                image = QImage(ImageThumbnailCache::getTargetSize
+                               (originalSize, maxSize),
+                               QImage::Format_ARGB32_Premultiplied);
+                image.fill(Qt::lightGray);
+            }
+        }
     }
 
-    return m_scaled[v][name];
+    ImageExtents &extents = m_extents[v->getId()];
+    extents.widths[name] = image.width();
+    if (image.width() > extents.maxWidth) {
+        extents.maxWidth = image.width();
+    }
+    
+    return status;
 }
 
 void
@@ -969,9 +995,10 @@ ImageLayer::fileSourceReady()
         }
         if (img == "") return;
 
-        m_images.erase(img);
-        for (ViewImageMap::iterator i = m_scaled.begin(); i != m_scaled.end(); ++i) {
-            i->second.erase(img);
+        ImageThumbnailCache::getInstance()->invalidate(rf->getLocalFilename());
+        for (ViewExtentsMap::iterator i = m_extents.begin();
+             i != m_extents.end(); ++i) {
+            i->second.widths.erase(img);
             shouldEmit = true;
         }
     }
@@ -981,6 +1008,15 @@ ImageLayer::fileSourceReady()
     }
 }
 
+void
+ImageLayer::imagesReady()
+{
+    if (m_awaitingImages) {
+        m_awaitingImages = false;
+        emit modelChanged(getModel());
+    }
+}
+
 void
 ImageLayer::toXml(QTextStream &stream,
                   QString indent, QString extraAttributes) const
@@ -17,6 +17,7 @@
 #define SV_IMAGE_LAYER_H
 
 #include "Layer.h"
+#include "ImageThumbnailCache.h"
 #include "data/model/ImageModel.h"
 
 #include <QObject>
@@ -108,27 +109,41 @@ public:
 protected slots:
     void checkAddSources();
     void fileSourceReady();
+    void imagesReady();
 
 protected:
     EventVector getLocalPoints(LayerGeometryProvider *v, int x, int y) const;
 
-    bool getImageOriginalSize(QString name, QSize &size) const;
-    QImage getImage(LayerGeometryProvider *v, QString name, QSize maxSize) const;
+    ImageThumbnailCache::Status getImageOriginalSize(QString name,
+                                                     QSize &size) const;
+    ImageThumbnailCache::Status getImage(LayerGeometryProvider *v,
+                                         QString name, QSize maxSize,
+                                         QImage &image) const;
 
     void drawImage(LayerGeometryProvider *v, QPainter &paint, const Event &p,
                    int x, int nx) const;
 
-    //!!! how to reap no-longer-used images?
-
-    typedef std::map<QString, QImage> ImageMap;
-    typedef std::map<const LayerGeometryProvider *, ImageMap> ViewImageMap;
+    // Decoded and scaled images themselves live in the shared
+    // ImageThumbnailCache. Here we record, for each view (by id), the
+    // on-screen width of each image as last drawn, and the widest of
+    // them, so that hit-testing can be done without looking at any
+    // images other than those near the point in question
+
+    struct ImageExtents {
+        ImageExtents() : maxWidth(defaultImageWidth) { }
+        std::map<QString, int> widths;
+        int maxWidth;
+    };
+    typedef std::map<int, ImageExtents> ViewExtentsMap;
     typedef std::map<QString, FileSource *> FileSourceMap;
 
-    static ImageMap m_images;
+    static const int defaultImageWidth = 32;
+
     static FileSourceMap m_fileSources;
     static QMutex m_staticMutex;
 
-    mutable ViewImageMap m_scaled;
+    mutable ViewExtentsMap m_extents;
+    mutable bool m_awaitingImages;
 
     static QString getLocalFilename(QString img);
     static void checkAddSource(QString img, bool synchronise);
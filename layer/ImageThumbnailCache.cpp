@@ -0,0 +1,501 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+    Sonic Visualiser
+    An audio file viewer and annotation editor.
+    Centre for Digital Music, Queen Mary, University of London.
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation; either version 2 of the
+    License, or (at your option) any later version.  See the file
+    COPYING included with this distribution for more information.
+*/
+
+#include "ImageThumbnailCache.h"
+
+#include "base/Debug.h"
+#include "base/Profiler.h"
+
+#include <QImageReader>
+#include <QMutexLocker>
+#include <QRunnable>
+#include <QThread>
+#include <QTimer>
+
+#include <mutex>
+#include <algorithm>
+
+//#define DEBUG_IMAGE_THUMBNAIL_CACHE 1
+
+namespace sv {
+
+// Largest dimension of the biggest image we retain in a pyramid. A
+// display size larger than this is decoded directly from the file.
+static const int maxRetainedDimension = 2048;
+
+// Smallest dimension we bother to go on halving beyond
+static const int minPyramidDimension = 32;
+
+// Number of distinct display sizes retained per image
+static const int maxScaledPerEntry = 6;
+
+ImageThumbnailCache *
+ImageThumbnailCache::m_instance = nullptr;
+
+class ImageThumbnailCache::Job : public QRunnable
+{
+public:
+    Job(ImageThumbnailCache *cache, QString filename, QSize target) :
+        m_cache(cache), m_filename(filename), m_target(target) { }
+
+    void run() override {
+        m_cache->run(m_filename, m_target);
+    }
+
+private:
+    ImageThumbnailCache *m_cache;
+    QString m_filename;
+    QSize m_target;
+};
+
+ImageThumbnailCache *
+ImageThumbnailCache::getInstance()
+{
+    static std::once_flag f;
+    std::call_once(f, [&]() { m_instance = new ImageThumbnailCache(); });
+    return m_instance;
+}
+
+ImageThumbnailCache::ImageThumbnailCache() :
+    m_useCounter(0),
+    m_generationCounter(0),
+    m_bytes(0),
+    m_limit(256ll * 1024 * 1024)
+{
+    int threads = QThread::idealThreadCount() - 1;
+    if (threads < 1) threads = 1;
+    if (threads > 4) threads = 4;
+    m_pool.setMaxThreadCount(threads);
+
+    m_notifyTimer = new QTimer(this);
+    m_notifyTimer->setSingleShot(true);
+    m_notifyTimer->setInterval(50);
+    connect(m_notifyTimer, SIGNAL(timeout()),
+            this, SLOT(notifyTimerElapsed()));
+}
+
+ImageThumbnailCache::~ImageThumbnailCache()
+{
+    m_pool.clear();
+    m_pool.waitForDone();
+}
+
+void
+ImageThumbnailCache::setMemoryLimit(qint64 bytes)
+{
+    QMutexLocker locker(&m_mutex);
+    m_limit = bytes;
+    evict("");
+}
+
+qint64
+ImageThumbnailCache::getMemoryLimit() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_limit;
+}
+
+qint64
+ImageThumbnailCache::getMemoryUsage() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_bytes;
+}
+
+ImageThumbnailCache::Entry &
+ImageThumbnailCache::getEntry(QString filename)
+{
+    auto itr = m_entries.find(filename);
+    if (itr == m_entries.end()) {
+        Entry entry;
+        entry.generation = ++m_generationCounter;
+        itr = m_entries.insert({ filename, entry }).first;
+    }
+    itr->second.lastUsed = ++m_useCounter;
+    return itr->second;
+}
+
+ImageThumbnailCache::Status
+ImageThumbnailCache::getOriginalSize(QString filename, QSize &size)
+{
+    QMutexLocker locker(&m_mutex);
+
+    Entry &entry = getEntry(filename);
+
+    if (entry.failed) {
+        return Failed;
+    }
+    if (entry.originalSize.isValid()) {
+        size = entry.originalSize;
+        return Ready;
+    }
+
+    if (!entry.decoding) {
+        startJob(filename, QSize());
+    }
+    return Pending;
+}
+
+ImageThumbnailCache::Status
+ImageThumbnailCache::getImage(QString filename, QSize maxSize, QImage &image)
+{
+    QMutexLocker locker(&m_mutex);
+
+    image = QImage();
+
+    Entry &entry = getEntry(filename);
+
+    if (entry.failed) {
+        return Failed;
+    }
+
+    if (!entry.originalSize.isValid()) {
+        if (!entry.decoding) {
+            startJob(filename, QSize());
+        }
+        return Pending;
+    }
+
+    QSize target = getTargetSize(entry.originalSize, maxSize);
+    SizeKey key(target.width(), target.height());
+
+    auto itr = entry.scaled.find(key);
+    if (itr != entry.scaled.end()) {
+        itr->second.lastUsed = m_useCounter;
+        image = itr->second.image;
+        return Ready;
+    }
+
+    if (!entry.pyramid.empty()) {
+        // Placeholder: a fast scale from the nearest level is cheap
+        // enough to do here, as every level is of bounded size
+        image = scaleFromPyramid(entry.pyramid, target, false);
+    }
+
+    if (entry.pendingScales.find(key) == entry.pendingScales.end()) {
+        if (!entry.pyramid.empty() || !entry.decoding) {
+            // (If another job is already decoding, wait for it to
+            // finish: we'll be asked again when it has)
+            entry.pendingScales.insert(key);
+            startJob(filename, target);
+        }
+    }
+
+    return Pending;
+}
+
+void
+ImageThumbnailCache::invalidate(QString filename)
+{
+    QMutexLocker locker(&m_mutex);
+
+    auto itr = m_entries.find(filename);
+    if (itr != m_entries.end()) {
+        m_bytes -= itr->second.bytes;
+        m_entries.erase(itr);
+    }
+}
+
+QSize
+ImageThumbnailCache::getTargetSize(QSize originalSize, QSize maxSize)
+{
+    if (maxSize.width() < 1) maxSize.setWidth(1);
+    if (maxSize.height() < 1) maxSize.setHeight(1);
+
+    if (originalSize.width() <= maxSize.width() &&
+        originalSize.height() <= maxSize.height()) {
+        return originalSize;
+    }
+
+    QSize target = originalSize.scaled(maxSize, Qt::KeepAspectRatio);
+    if (target.width() < 1) target.setWidth(1);
+    if (target.height() < 1) target.setHeight(1);
+    return target;
+}
+
+QImage
+ImageThumbnailCache::scaleFromPyramid(const std::vector<QImage> &pyramid,
+                                      QSize target, bool smooth)
+{
+    // Use the smallest level that is at least as large as the target
+    // in both dimensions, or the largest level if none is
+
+    int level = 0;
+    for (int i = 1; i < int(pyramid.size()); ++i) {
+        if (pyramid[i].width() < target.width() ||
+            pyramid[i].height() < target.height()) {
+            break;
+        }
+        level = i;
+    }
+
+    const QImage &source = pyramid[level];
+    if (source.size() == target) {
+        return source;
+    }
+
+    return source.scaled(target, Qt::IgnoreAspectRatio,
+                         smooth ?
+                         Qt::SmoothTransformation :
+                         Qt::FastTransformation);
+}
+
+void
+ImageThumbnailCache::startJob(QString filename, QSize target)
+{
+    Entry &entry = getEntry(filename);
+    if (entry.pyramid.empty()) {
+        entry.decoding = true;
+    }
+
+#ifdef DEBUG_IMAGE_THUMBNAIL_CACHE
+    SVDEBUG << "ImageThumbnailCache::startJob(" << filename << ", "
+            << target.width() << "x" << target.height() << ")" << endl;
+#endif
+
+    m_pool.start(new Job(this, filename, target));
+}
+
+std::vector<QImage>
+ImageThumbnailCache::decode(QString filename, qint64 generation,
+                            QSize &originalSize, bool &failed)
+{
+    Profiler profiler("ImageThumbnailCache::decode");
+
+    std::vector<QImage> pyramid;
+
+    QImageReader reader(filename);
+    QSize size = reader.size();
+
+    if (size.isValid()) {
+        // Publish the size now, as callers laying out images need it
+        // and decoding the rest may take a while
+        QMutexLocker locker(&m_mutex);
+        auto itr = m_entries.find(filename);
+        if (itr != m_entries.end() && itr->second.generation == generation &&
+            !itr->second.originalSize.isValid()) {
+            itr->second.originalSize = size;
+            QMetaObject::invokeMethod(this, "jobFinished",
+                                      Qt::QueuedConnection);
+        }
+    }
+
+    if (size.isValid() &&
+        (size.width() > maxRetainedDimension ||
+         size.height() > maxRetainedDimension)) {
+        // Many formats (notably JPEG) can decode directly to a
+        // reduced size, which is much quicker than decoding in full
+        reader.setScaledSize(size.scaled(maxRetainedDimension,
+                                         maxRetainedDimension,
+                                         Qt::KeepAspectRatio));
+    }
+
+    QImage image = reader.read();
+    if (image.isNull()) {
+        failed = true;
+        return pyramid;
+    }
+
+    if (!size.isValid()) {
+        size = image.size();
+        if (size.width() > maxRetainedDimension ||
+            size.height() > maxRetainedDimension) {
+            image = image.scaled(maxRetainedDimension,
+                                 maxRetainedDimension,
+                                 Qt::KeepAspectRatio,
+                                 Qt::SmoothTransformation);
+        }
+    }
+
+    originalSize = size;
+    failed = false;
+
+    pyramid.push_back
+        (image.convertToFormat(QImage::Format_ARGB32_Premultiplied));
+
+    while (pyramid.rbegin()->width() >= minPyramidDimension * 2 &&
+           pyramid.rbegin()->height() >= minPyramidDimension * 2) {
+        const QImage &last = *pyramid.rbegin();
+        QImage half = last.scaled(last.width() / 2, last.height() / 2,
+                                  Qt::IgnoreAspectRatio,
+                                  Qt::SmoothTransformation);
+        pyramid.push_back(half);
+    }
+
+    return pyramid;
+}
+
+void
+ImageThumbnailCache::run(QString filename, QSize target)
+{
+    std::vector<QImage> pyramid;
+    QSize originalSize;
+    qint64 generation = 0;
+    bool needDecode = false;
+
+    {
+        QMutexLocker locker(&m_mutex);
+        auto itr = m_entries.find(filename);
+        if (itr == m_entries.end()) {
+            // invalidated in the mean time
+            QMetaObject::invokeMethod(this, "jobFinished",
+                                      Qt::QueuedConnection);
+            return;
+        }
+        generation = itr->second.generation;
+        pyramid = itr->second.pyramid;
+        originalSize = itr->second.originalSize;
+        needDecode = pyramid.empty();
+    }
+
+    if (needDecode) {
+
+        bool failed = false;
+        QSize decodedSize;
+        pyramid = decode(filename, generation, decodedSize, failed);
+
+        QMutexLocker locker(&m_mutex);
+        auto itr = m_entries.find(filename);
+        if (itr != m_entries.end() && itr->second.generation == generation) {
+            Entry &entry = itr->second;
+            entry.decoding = false;
+            if (failed) {
+                entry.failed = true;
+                entry.pendingScales.clear();
+            } else {
+                entry.originalSize = decodedSize;
+                entry.pyramid = pyramid;
+                originalSize = decodedSize;
+                recalculateBytes(entry);
+                evict(filename);
+            }
+        }
+        if (failed) {
+            QMetaObject::invokeMethod(this, "jobFinished",
+                                      Qt::QueuedConnection);
+            return;
+        }
+    }
+
+    if (target.isValid()) {
+
+        QImage scaled;
+
+        if (target.width() > pyramid[0].width() ||
+            target.height() > pyramid[0].height()) {
+            // Larger than anything we retain: decode at the target
+            // size directly
+            QImageReader reader(filename);
+            reader.setScaledSize(target);
+            scaled = reader.read();
+            if (!scaled.isNull()) {
+                scaled = scaled.convertToFormat
+                    (QImage::Format_ARGB32_Premultiplied);
+            }
+        }
+        if (scaled.isNull()) {
+            scaled = scaleFromPyramid(pyramid, target, true);
+        }
+
+        QMutexLocker locker(&m_mutex);
+        auto itr = m_entries.find(filename);
+        if (itr != m_entries.end() && itr->second.generation == generation) {
+            Entry &entry = itr->second;
+            SizeKey key(target.width(), target.height());
+            entry.pendingScales.erase(key);
+            while (int(entry.scaled.size()) >= maxScaledPerEntry) {
+                auto oldest = entry.scaled.begin();
+                for (auto j = entry.scaled.begin();
+                     j != entry.scaled.end(); ++j) {
+                    if (j->second.lastUsed < oldest->second.lastUsed) {
+                        oldest = j;
+                    }
+                }
+                entry.scaled.erase(oldest);
+            }
+            entry.scaled[key] = { scaled, ++m_useCounter };
+            recalculateBytes(entry);
+            evict(filename);
+        }
+    }
+
+    QMetaObject::invokeMethod(this, "jobFinished", Qt::QueuedConnection);
+}
+
+void
+ImageThumbnailCache::recalculateBytes(Entry &entry)
+{
+    qint64 bytes = 0;
+    for (const auto &level: entry.pyramid) {
+        bytes += level.sizeInBytes();
+    }
+    for (const auto &s: entry.scaled) {
+        bytes += s.second.image.sizeInBytes();
+    }
+    m_bytes += bytes - entry.bytes;
+    entry.bytes = bytes;
+}
+
+void
+ImageThumbnailCache::evict(QString keep)
+{
+    while (m_bytes > m_limit) {
+
+        auto oldest = m_entries.end();
+
+        for (auto itr = m_entries.begin(); itr != m_entries.end(); ++itr) {
+            if (itr->first == keep || itr->second.bytes == 0) {
+                continue;
+            }
+            if (oldest == m_entries.end() ||
+                itr->second.lastUsed < oldest->second.lastUsed) {
+                oldest = itr;
+            }
+        }
+
+        if (oldest == m_entries.end()) {
+            break;
+        }
+
+#ifdef DEBUG_IMAGE_THUMBNAIL_CACHE
+        SVDEBUG << "ImageThumbnailCache::evict: discarding images for "
+                << oldest->first << " (" << oldest->second.bytes
+                << " bytes)" << endl;
+#endif
+
+        // Retain the original size and status, which cost us nothing
+        // to keep and save re-reading the header
+        Entry &entry = oldest->second;
+        m_bytes -= entry.bytes;
+        entry.bytes = 0;
+        entry.pyramid.clear();
+        entry.scaled.clear();
+    }
+}
+
+void
+ImageThumbnailCache::jobFinished()
+{
+    if (!m_notifyTimer->isActive()) {
+        m_notifyTimer->start();
+    }
+}
+
+void
+ImageThumbnailCache::notifyTimerElapsed()
+{
+    emit imagesReady();
+}
+
+} // end namespace sv
@@ -0,0 +1,169 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+    Sonic Visualiser
+    An audio file viewer and annotation editor.
+    Centre for Digital Music, Queen Mary, University of London.
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation; either version 2 of the
+    License, or (at your option) any later version.  See the file
+    COPYING included with this distribution for more information.
+*/
+
+#ifndef SV_IMAGE_THUMBNAIL_CACHE_H
+#define SV_IMAGE_THUMBNAIL_CACHE_H
+
+#include <QObject>
+#include <QImage>
+#include <QMutex>
+#include <QSize>
+#include <QString>
+#include <QThreadPool>
+
+#include <map>
+#include <set>
+#include <vector>
+
+class QTimer;
+
+namespace sv {
+
+/**
+ * Process-wide cache of decoded and downscaled images, shared by all
+ * ImageLayers and all views. Images are decoded on a worker thread
+ * pool and retained as a pyramid of successively halved thumbnails,
+ * from which the exact sizes requested for display are scaled, again
+ * on a worker thread. Until a requested size is ready, callers are
+ * given the nearest available level (quickly scaled) as a
+ * placeholder, or a null image if nothing has been decoded yet, and
+ * the imagesReady signal is emitted once the work completes.
+ *
+ * Total memory use is bounded: when the limit is exceeded, the least
+ * recently used images are discarded, to be decoded again if needed.
+ *
+ * Files are identified by local filename. All functions are
+ * thread-safe.
+ */
+class ImageThumbnailCache : public QObject
+{
+    Q_OBJECT
+
+public:
+    static ImageThumbnailCache *getInstance();
+
+    virtual ~ImageThumbnailCache();
+
+    enum Status {
+        Ready,
+        Pending,
+        Failed
+    };
+
+    /**
+     * Obtain the full size of the image in the given file. The file
+     * is never opened on the calling thread: if the size is not yet
+     * known, start decoding the image in the background and return
+     * Pending. The size is recorded as soon as the decoder has read
+     * the image header, and imagesReady is emitted then, so it is
+     * usually available well before the image itself.
+     */
+    Status getOriginalSize(QString filename, QSize &size);
+
+    /**
+     * Obtain the image in the given file, scaled to fit within
+     * maxSize while preserving its aspect ratio (images smaller than
+     * maxSize are not scaled up). Return Ready if the returned image
+     * is the properly scaled one; otherwise schedule the scaling in
+     * the background and return Pending, with the returned image
+     * either a roughly scaled placeholder or null. Return Failed if
+     * the file cannot be read.
+     */
+    Status getImage(QString filename, QSize maxSize, QImage &image);
+
+    /**
+     * Discard everything known about the given file, for example
+     * because it has just been (re-)downloaded.
+     */
+    void invalidate(QString filename);
+
+    /**
+     * Set the approximate upper limit on memory used for decoded
+     * images, in bytes.
+     */
+    void setMemoryLimit(qint64 bytes);
+    qint64 getMemoryLimit() const;
+
+    qint64 getMemoryUsage() const;
+
+    /**
+     * Return the size that an image of the given original size will
+     * be given by getImage when asked to fit it within maxSize.
+     */
+    static QSize getTargetSize(QSize originalSize, QSize maxSize);
+
+signals:
+    /**
+     * Emitted on the GUI thread when images have become available
+     * following earlier Pending results. Notifications are batched,
+     * so one emission may cover several files.
+     */
+    void imagesReady();
+
+protected slots:
+    void jobFinished();
+    void notifyTimerElapsed();
+
+protected:
+    ImageThumbnailCache();
+
+    typedef std::pair<int, int> SizeKey;
+
+    struct ScaledImage {
+        QImage image;
+        qint64 lastUsed;
+    };
+    
+    struct Entry {
+        Entry() : generation(0), failed(false), decoding(false),
+                  lastUsed(0), bytes(0) { }
+        qint64 generation;
+        QSize originalSize;
+        bool failed;
+        bool decoding;
+        std::vector<QImage> pyramid; // largest first, each half the last
+        std::map<SizeKey, ScaledImage> scaled;
+        std::set<SizeKey> pendingScales;
+        qint64 lastUsed;
+        qint64 bytes;
+    };
+
+    class Job;
+    friend class Job;
+
+    void run(QString filename, QSize target);
+    std::vector<QImage> decode(QString filename, qint64 generation,
+                               QSize &originalSize, bool &failed);
+    static QImage scaleFromPyramid(const std::vector<QImage> &pyramid,
+                                   QSize target, bool smooth);
+    Entry &getEntry(QString filename); // call with mutex held
+    void startJob(QString filename, QSize target); // call with mutex held
+    void recalculateBytes(Entry &entry); // call with mutex held
+    void evict(QString keep); // call with mutex held
+
+    static ImageThumbnailCache *m_instance;
+
+    mutable QMutex m_mutex;
+    std::map<QString, Entry> m_entries;
+    qint64 m_useCounter;
+    qint64 m_generationCounter;
+    qint64 m_bytes;
+    qint64 m_limit;
+    QThreadPool m_pool;
+    QTimer *m_notifyTimer;
+};
+
+} // end namespace sv
+
+#endif
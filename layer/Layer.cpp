@@ -40,6 +40,10 @@ Layer::Layer() :
     m_haveDraggingRect(false),
     m_haveCurrentMeasureRect(false)
 {
+    connect(this, SIGNAL(layerParametersChanged()),
+            this, SLOT(invalidateHitCaches()));
+    connect(this, SIGNAL(verticalZoomChanged()),
+            this, SLOT(invalidateHitCaches()));
 }
 
 Layer::~Layer()
@@ -56,6 +60,12 @@ Layer::connectSignals(ModelId modelId)
     connect(model.get(), SIGNAL(modelChanged(ModelId)),
             this, SIGNAL(modelChanged(ModelId)));
 
+    connect(model.get(), SIGNAL(modelChanged(ModelId)),
+            this, SLOT(invalidateHitCaches()));
+
+    connect(model.get(), SIGNAL(modelChangedWithin(ModelId, sv_frame_t, sv_frame_t)),
+            this, SLOT(invalidateHitCaches()));
+
     connect(model.get(), SIGNAL(modelChangedWithin(ModelId, sv_frame_t, sv_frame_t)),
             this, SIGNAL(modelChangedWithin(ModelId, sv_frame_t, sv_frame_t)));
 
@@ -66,6 +76,39 @@ Layer::connectSignals(ModelId modelId)
             this, SIGNAL(modelAlignmentCompletionChanged(ModelId)));
 }
 
+void
+Layer::invalidateHitCaches()
+{
+    m_hitCaches.clear();
+}
+
+FeatureHitCache &
+Layer::getHitCache(const LayerGeometryProvider *v) const
+{
+    FeatureHitCache &cache = m_hitCaches[v->getId()];
+
+    // Our own display extents, and those of whatever scale the view
+    // is showing for our unit, which we may be aligned to and which
+    // may be zoomed without our hearing about it
+    std::vector<double> extents;
+    double min = 0.0, max = 0.0;
+    bool log = false;
+    QString unit;
+    if (getDisplayExtents(min, max)) {
+        extents.push_back(min);
+        extents.push_back(max);
+    }
+    if (getValueExtents(min, max, log, unit) && unit != "" &&
+        v->getVisibleExtentsForUnit(unit, min, max, log)) {
+        extents.push_back(min);
+        extents.push_back(max);
+        extents.push_back(log ? 1.0 : 0.0);
+    }
+    cache.setVerticalExtents(extents);
+    
+    return cache;
+}
+
 ModelId
 Layer::getSourceModel() const
 {
@@ -140,6 +183,9 @@ Layer::setLayerDormant(const LayerGeometryProvider *v, bool dormant)
     const void *vv = (const void *)v;
     QMutexLocker locker(&m_dormancyMutex);
     m_dormancy[vv] = dormant;
+    if (dormant) {
+        m_hitCaches.erase(v->getId());
+    }
 }
 
 bool
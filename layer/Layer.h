@@ -24,6 +24,8 @@
 
 #include "widgets/CommandHistory.h"
 
+#include "FeatureHitCache.h"
+
 #include "system/System.h"
 
 #include <QObject>
@@ -181,6 +183,18 @@ public:
     virtual void paintVerticalScale(LayerGeometryProvider *, bool /* detailed */,
                                     QPainter &, QRect) const { }
 
+    /**
+     * This should return true if the (non-detailed) vertical scale
+     * drawn by paintVerticalScale depends only on the height of the
+     * view, the font, and the parameters and display extents of this
+     * and the view's other layers, so that a view may keep the scale
+     * it has painted and reuse it until one of those changes. It
+     * should return false if the scale follows the part of the model
+     * that is visible, or if painting it updates state that the layer
+     * uses elsewhere.
+     */
+    virtual bool isVerticalScaleRetainable() const { return true; }
+
     virtual int getHorizontalScaleHeight(LayerGeometryProvider *, QPainter &) const { return 0; }
     
     virtual bool getCrosshairExtents(LayerGeometryProvider *, QPainter &, QPoint /* cursorPos */,
@@ -346,6 +360,18 @@ public:
      */
     virtual bool isLayerScrollable(const LayerGeometryProvider *) const { return true; }
 
+    /**
+     * This should return true if a change to the layer's model within
+     * a range of frames can alter only what the layer draws over that
+     * range (give or take a pixel at either end), so that a view
+     * caching the layer may repaint just that part of its cache. It
+     * should return false if, for example, the layer joins successive
+     * points with lines, draws labels beyond the points they belong
+     * to, scales its display to fit the data, or keeps a cache of its
+     * own that it does not update for partial changes.
+     */
+    virtual bool isModelChangeLocalised() const { return false; }
+
     /**
      * This should return true if the layer completely obscures any
      * underlying layers.  It's used to determine whether the view can
@@ -638,8 +664,19 @@ signals:
     void layerMeasurementRectsChanged();
     void layerNameChanged();
 
+    /**
+     * Emitted when the text returned by getFeatureDescription for
+     * the current position may have changed without any change to
+     * the layer's model or parameters, for example because it
+     * depends on values calculated in the background.
+     */
+    void layerFeatureDescriptionChanged();
+
     void verticalZoomChanged();
 
+protected slots:
+    void invalidateHitCaches();
+
 protected:
     void connectSignals(ModelId);
 
@@ -723,12 +760,22 @@ protected:
                               const MeasureRect &r, bool focus) const;
 
     bool valueExtentsMatchMine(LayerGeometryProvider *v) const;
+
+    /**
+     * Return the record of features drawn in the given view, for
+     * screen-space hit-testing. Layers that use this must record into
+     * it (with a FeatureHitCache::Recorder) in paint. The caches are
+     * discarded whenever the model or the layer's parameters change.
+     */
+    FeatureHitCache &getHitCache(const LayerGeometryProvider *v) const;
     
     QString m_presentationName;
 
 private:
     mutable QMutex m_dormancyMutex;
     mutable std::map<const void *, bool> m_dormancy;
+
+    mutable std::map<int, FeatureHitCache> m_hitCaches; // by view id
 };
 
 } // end namespace sv
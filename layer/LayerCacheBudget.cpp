@@ -0,0 +1,223 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+    Sonic Visualiser
+    An audio file viewer and annotation editor.
+    Centre for Digital Music, Queen Mary, University of London.
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation; either version 2 of the
+    License, or (at your option) any later version.  See the file
+    COPYING included with this distribution for more information.
+*/
+
+#include "LayerCacheBudget.h"
+
+#include "base/Debug.h"
+
+#include <QSettings>
+#include <QTimer>
+
+#include <climits>
+
+//#define DEBUG_LAYER_CACHE_BUDGET 1
+
+namespace sv {
+
+// A cache used within this many milliseconds is not evicted, so that
+// two views that cannot both fit within the limit do not keep
+// evicting one another's caches on every repaint
+static const qint64 minimumAgeForEviction = 1000;
+
+LayerCacheBudget *
+LayerCacheBudget::m_instance = nullptr;
+
+LayerCacheBudget *
+LayerCacheBudget::getInstance()
+{
+    if (!m_instance) m_instance = new LayerCacheBudget();
+    return m_instance;
+}
+
+LayerCacheBudget::LayerCacheBudget() :
+    m_bytes(0)
+{
+    QSettings settings;
+    settings.beginGroup("Preferences");
+    qint64 mb = settings.value("layer-cache-memory-limit-mb", 1024).toLongLong();
+    settings.endGroup();
+    if (mb < 1) mb = 1;
+    m_limit = mb * 1024 * 1024;
+
+    m_clock.start();
+
+    m_evictTimer = new QTimer(this);
+    m_evictTimer->setSingleShot(true);
+    connect(m_evictTimer, SIGNAL(timeout()), this, SLOT(evict()));
+}
+
+LayerCacheBudget::~LayerCacheBudget()
+{
+}
+
+void
+LayerCacheBudget::setUsage(Client *client, int key, qint64 bytes)
+{
+    if (bytes < 0) bytes = 0;
+
+    Entry &entry = m_entries[Key(client, key)];
+    qint64 previous = entry.bytes;
+    entry.lastUsed = m_clock.elapsed() + 1;
+
+    if (bytes == previous) return;
+
+    entry.bytes = bytes;
+    m_bytes += bytes - previous;
+
+#ifdef DEBUG_LAYER_CACHE_BUDGET
+    SVDEBUG << "LayerCacheBudget::setUsage(" << client << ", " << key
+            << ", " << bytes << "): total now " << m_bytes << " of limit "
+            << m_limit << endl;
+#endif
+
+    if (m_bytes > m_limit) {
+        scheduleEviction();
+    }
+
+    emit usageChanged();
+}
+
+void
+LayerCacheBudget::touch(Client *client, int key)
+{
+    auto itr = m_entries.find(Key(client, key));
+    if (itr != m_entries.end()) {
+        itr->second.lastUsed = m_clock.elapsed() + 1;
+    }
+}
+
+void
+LayerCacheBudget::remove(Client *client, int key)
+{
+    auto itr = m_entries.find(Key(client, key));
+    if (itr == m_entries.end()) return;
+    m_bytes -= itr->second.bytes;
+    m_entries.erase(itr);
+    emit usageChanged();
+}
+
+void
+LayerCacheBudget::removeAll(Client *client)
+{
+    bool changed = false;
+    auto itr = m_entries.lower_bound(Key(client, INT_MIN));
+    while (itr != m_entries.end() && itr->first.first == client) {
+        m_bytes -= itr->second.bytes;
+        itr = m_entries.erase(itr);
+        changed = true;
+    }
+    if (changed) {
+        emit usageChanged();
+    }
+}
+
+qint64
+LayerCacheBudget::getUsage(const Client *client) const
+{
+    qint64 bytes = 0;
+    for (const auto &e: m_entries) {
+        if (e.first.first == client) {
+            bytes += e.second.bytes;
+        }
+    }
+    return bytes;
+}
+
+std::map<const LayerCacheBudget::Client *, qint64>
+LayerCacheBudget::getUsageByClient() const
+{
+    std::map<const Client *, qint64> usage;
+    for (const auto &e: m_entries) {
+        usage[e.first.first] += e.second.bytes;
+    }
+    return usage;
+}
+
+qint64
+LayerCacheBudget::getAvailable() const
+{
+    if (m_bytes >= m_limit) return 0;
+    return m_limit - m_bytes;
+}
+
+void
+LayerCacheBudget::setMemoryLimit(qint64 bytes)
+{
+    m_limit = bytes;
+    if (m_bytes > m_limit) {
+        scheduleEviction();
+    }
+}
+
+void
+LayerCacheBudget::scheduleEviction()
+{
+    if (!m_evictTimer->isActive()) {
+        m_evictTimer->start(0);
+    }
+}
+
+void
+LayerCacheBudget::evict()
+{
+    qint64 now = m_clock.elapsed() + 1;
+    bool evicted = false;
+
+    while (m_bytes > m_limit) {
+
+        // Search afresh each time, as the client may remove or change
+        // other entries when evicting one
+
+        auto oldest = m_entries.end();
+
+        for (auto itr = m_entries.begin(); itr != m_entries.end(); ++itr) {
+            if (itr->second.bytes == 0 ||
+                now - itr->second.lastUsed < minimumAgeForEviction) {
+                continue;
+            }
+            if (oldest == m_entries.end() ||
+                itr->second.lastUsed < oldest->second.lastUsed) {
+                oldest = itr;
+            }
+        }
+
+        if (oldest == m_entries.end()) {
+            // Everything left is in active use: try again later
+            m_evictTimer->start(int(minimumAgeForEviction));
+            break;
+        }
+
+        Client *client = oldest->first.first;
+        int key = oldest->first.second;
+
+#ifdef DEBUG_LAYER_CACHE_BUDGET
+        SVDEBUG << "LayerCacheBudget::evict: evicting cache " << key
+                << " of client " << client << " ("
+                << oldest->second.bytes << " bytes, last used "
+                << now - oldest->second.lastUsed << "ms ago)" << endl;
+#endif
+
+        m_bytes -= oldest->second.bytes;
+        m_entries.erase(oldest);
+        evicted = true;
+
+        client->evictCache(key);
+    }
+
+    if (evicted) {
+        emit usageChanged();
+    }
+}
+
+} // end namespace sv
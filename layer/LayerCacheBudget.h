@@ -0,0 +1,152 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+    Sonic Visualiser
+    An audio file viewer and annotation editor.
+    Centre for Digital Music, Queen Mary, University of London.
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation; either version 2 of the
+    License, or (at your option) any later version.  See the file
+    COPYING included with this distribution for more information.
+*/
+
+#ifndef SV_LAYER_CACHE_BUDGET_H
+#define SV_LAYER_CACHE_BUDGET_H
+
+#include <QObject>
+#include <QElapsedTimer>
+
+#include <map>
+
+class QTimer;
+
+namespace sv {
+
+/**
+ * Process-wide account of the memory used by the caches that layers
+ * keep for rendering (renderer image caches, peak caches, waveform
+ * pixmaps and the like), with a single limit across all of them.
+ *
+ * Each cache is registered by a Client, usually the layer that owns
+ * it, under a key of the client's choosing, and its size is updated
+ * whenever it is used. When the total exceeds the limit, the least
+ * recently used caches are asked to go away, via
+ * Client::evictCache, until it no longer does. Eviction happens from
+ * the event loop rather than from within setUsage, so a client is
+ * never asked to discard a cache while it is in the middle of using
+ * one. A cache used very recently is not evicted even when over the
+ * limit, as it is presumably needed for what is on screen now.
+ *
+ * This class is not thread-safe: it must be used only from the GUI
+ * thread.
+ */
+class LayerCacheBudget : public QObject
+{
+    Q_OBJECT
+
+public:
+    class Client {
+    public:
+        virtual ~Client() { }
+
+        /**
+         * Discard the cache registered under the given key. The
+         * cache's entry has already been removed from the budget when
+         * this is called; the client should not call remove for it.
+         */
+        virtual void evictCache(int key) = 0;
+    };
+
+    static LayerCacheBudget *getInstance();
+
+    virtual ~LayerCacheBudget();
+
+    /**
+     * Record the size in bytes of the cache with the given client
+     * and key, and mark it as used now. If there is no such cache
+     * registered yet, register it.
+     */
+    void setUsage(Client *client, int key, qint64 bytes);
+
+    /**
+     * Mark the cache with the given client and key as used now,
+     * without changing its size.
+     */
+    void touch(Client *client, int key);
+
+    /**
+     * Remove the cache with the given client and key, because the
+     * client has discarded it.
+     */
+    void remove(Client *client, int key);
+
+    /**
+     * Remove all caches for the given client. Clients must call this
+     * on destruction.
+     */
+    void removeAll(Client *client);
+
+    /**
+     * Return the total size of all registered caches in bytes.
+     */
+    qint64 getUsage() const { return m_bytes; }
+
+    /**
+     * Return the total size of all caches registered by the given
+     * client in bytes.
+     */
+    qint64 getUsage(const Client *client) const;
+
+    /**
+     * Return the sizes of all caches registered by each client.
+     */
+    std::map<const Client *, qint64> getUsageByClient() const;
+
+    /**
+     * Return the number of bytes that can be allocated before the
+     * limit is reached, or zero if it has been already.
+     */
+    qint64 getAvailable() const;
+
+    /**
+     * Set the approximate upper limit on total cache memory, in
+     * bytes. The initial limit is taken from the
+     * "layer-cache-memory-limit-mb" preference, or is 1GB if that is
+     * not set.
+     */
+    void setMemoryLimit(qint64 bytes);
+    qint64 getMemoryLimit() const { return m_limit; }
+
+signals:
+    void usageChanged();
+
+protected slots:
+    void evict();
+
+protected:
+    LayerCacheBudget();
+
+    typedef std::pair<Client *, int> Key;
+
+    struct Entry {
+        Entry() : bytes(0), lastUsed(0) { }
+        qint64 bytes;
+        qint64 lastUsed;
+    };
+
+    std::map<Key, Entry> m_entries;
+    qint64 m_bytes;
+    qint64 m_limit;
+    QElapsedTimer m_clock;
+    QTimer *m_evictTimer;
+
+    void scheduleEviction();
+
+    static LayerCacheBudget *m_instance;
+};
+
+} // end namespace sv
+
+#endif
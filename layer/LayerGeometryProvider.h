@@ -18,10 +18,16 @@
 #include "base/BaseTypes.h"
 #include "base/ZoomLevel.h"
 
+#include "PixelFrameTable.h"
+
+#include "data/model/Model.h"
+
 #include <QMutex>
 #include <QMutexLocker>
 #include <QPainter>
 
+#include <memory>
+
 namespace sv {
 
 class ViewManager;
@@ -107,6 +113,19 @@ public:
      */
     virtual sv_frame_t getFrameForX(int x) const = 0;
 
+    /**
+     * Return a table of the mappings made by getFrameForX and
+     * getXForFrame, for use in loops over pixels or events while
+     * painting. The table is valid only until the geometry changes,
+     * so it should be obtained afresh for each paint. The default
+     * implementation builds a new one each time; implementations
+     * used for a single paint may build it once and share it between
+     * all the layers they are passed to.
+     */
+    virtual std::shared_ptr<const PixelFrameTable> getPixelFrameTable() const {
+        return std::make_shared<PixelFrameTable>(this);
+    }
+
     virtual sv_frame_t getModelsStartFrame() const = 0;
     virtual sv_frame_t getModelsEndFrame() const = 0;
 
@@ -204,6 +223,22 @@ public:
 
     virtual void updatePaintRect(QRect r) = 0;
 
+    /**
+     * Return the factor by which a layer should scale the time it
+     * allows itself for time-constrained rendering (see RenderTimer)
+     * in a single paint. Less than 1.0 for views the user is not
+     * currently working in, so that their rendering is spread across
+     * more paints and gets in the way less.
+     */
+    virtual double getRenderTimeScale() const { return 1.0; }
+
+    /**
+     * Return the alignment model through which this provider maps
+     * frames, if it is a re-aligning proxy (see ViewProxy), or none
+     * otherwise.
+     */
+    virtual ModelId getAlignmentModel() const { return {}; }
+
     virtual double scaleSize(double size) const = 0;
     virtual int scalePixelSize(int size) const = 0;
     virtual double scalePenWidth(double width) const = 0;
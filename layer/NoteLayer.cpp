@@ -438,12 +438,21 @@ NoteLayer::getLocalPoints(LayerGeometryProvider *v, int x) const
     auto model = ModelById::getAs<NoteModel>(m_model);
     if (!model) return {};
     
+    int fuzz = ViewManager::scalePixelSize(2);
+
+    // Try the notes drawn in a recent paint first, with the same
+    // order of preference as the model queries below
+
+    EventVector cached;
+    if (getHitCache(v).getDurationsNear(v, x, fuzz, cached)) {
+        return cached;
+    }
+    
     sv_frame_t frame = v->getFrameForX(x);
 
     EventVector local = model->getEventsCovering(frame);
     if (!local.empty()) return local;
 
-    int fuzz = ViewManager::scalePixelSize(2);
     sv_frame_t start = v->getFrameForX(x - fuzz);
     sv_frame_t end = v->getFrameForX(x + fuzz);
 
@@ -462,6 +471,12 @@ NoteLayer::getPointToDrag(LayerGeometryProvider *v, int x, int y, Event &point)
     auto model = ModelById::getAs<NoteModel>(m_model);
     if (!model) return false;
 
+    bool found = false;
+    if (getHitCache(v).getNearestInColumn
+        (v, x, y, FeatureHitCache::Anchor::Centre, found, point)) {
+        return found;
+    }
+
     sv_frame_t frame = v->getFrameForX(x);
 
     EventVector onPoints = model->getEventsCovering(frame);
@@ -752,6 +767,8 @@ NoteLayer::paint(LayerGeometryProvider *v, QPainter &paint, QRect rect) const
                                           illuminatePoint);
     }
 
+    FeatureHitCache::Recorder recorder(getHitCache(v), v, rect);
+
     paint.save();
     paint.setRenderHint(QPainter::Antialiasing, false);
     
@@ -773,6 +790,8 @@ NoteLayer::paint(LayerGeometryProvider *v, QPainter &paint, QRect rect) const
         }
 
         if (w < 1) w = 1;
+
+        recorder.add(p, QRect(x, y - h/2, w, h));
         paint.setPen(getBaseQColor());
         paint.setBrush(brushColour);
 
@@ -22,10 +22,16 @@
 #include "base/Debug.h"
 
 #include <QPaintDevice>
+#include <QPaintEngine>
 #include <QPainter>
+#include <QImage>
+#include <QMutex>
+#include <QMutexLocker>
 
 #include <iostream>
 #include <cmath>
+#include <map>
+#include <list>
 
 namespace sv {
 
@@ -199,6 +205,120 @@ PaintAssistant::getYForValue(Scale scale, AudioLevel::Quantity sort,
     return vy;
 }
 
+/**
+ * Bounded least-recently-used cache of pre-rendered outlined text
+ * labels. Drawing an outlined label directly takes nine drawText
+ * calls (eight offset halo passes plus the foreground), and labels
+ * such as time ruler and scale markings are redrawn on every
+ * repaint, so we rasterise each distinct label once and blit it
+ * thereafter.
+ */
+class OutlinedTextSpriteCache
+{
+public:
+    struct Sprite {
+        QImage image;     // at device resolution, with DPR set
+        QPointF offset;   // top-left relative to the text origin
+    };
+
+    static OutlinedTextSpriteCache &getInstance() {
+        static OutlinedTextSpriteCache instance;
+        return instance;
+    }
+
+    bool get(QString key, Sprite &sprite) {
+        QMutexLocker locker(&m_mutex);
+        auto itr = m_sprites.find(key);
+        if (itr == m_sprites.end()) return false;
+        m_lru.splice(m_lru.begin(), m_lru, itr->second.lruPosition);
+        sprite = itr->second.sprite;
+        return true;
+    }
+
+    void put(QString key, const Sprite &sprite) {
+        QMutexLocker locker(&m_mutex);
+        if (m_sprites.find(key) != m_sprites.end()) return;
+        qsizetype bytes = sprite.image.sizeInBytes();
+        if (bytes > m_maxBytes / 4) return;
+        while (!m_lru.empty() && m_bytes + bytes > m_maxBytes) {
+            auto oldest = m_sprites.find(m_lru.back());
+            m_bytes -= oldest->second.sprite.image.sizeInBytes();
+            m_sprites.erase(oldest);
+            m_lru.pop_back();
+        }
+        m_lru.push_front(key);
+        m_sprites[key] = { sprite, m_lru.begin() };
+        m_bytes += bytes;
+    }
+
+private:
+    OutlinedTextSpriteCache() : m_bytes(0), m_maxBytes(8 * 1024 * 1024) { }
+
+    struct Entry {
+        Sprite sprite;
+        std::list<QString>::iterator lruPosition;
+    };
+
+    QMutex m_mutex;
+    std::map<QString, Entry> m_sprites;
+    std::list<QString> m_lru; // most recently used at front
+    qsizetype m_bytes;
+    const qsizetype m_maxBytes;
+};
+
+static void
+drawOutlinedText(QPainter &paint, QPointF origin, QString text,
+                 QColor penColour, QColor surroundColour, QColor boxColour)
+{
+    // origin is the text origin less the ascent, i.e. the top-left
+    // of the text bounding rect
+    
+    QRectF boundingRect = paint.boundingRect
+        (QRectF(), Qt::AlignTop | Qt::AlignLeft, text);
+
+    QRectF textRect = boundingRect.translated(origin);
+
+    QRectF boxRect(textRect.x() - 2, textRect.y() - 2,
+                   textRect.width() + 4, textRect.height() + 4);
+
+    paint.setPen(Qt::NoPen);
+    paint.setBrush(boxColour);
+        
+    paint.drawRect(boxRect);
+    paint.setBrush(Qt::NoBrush);
+
+    paint.setPen(surroundColour);
+
+    for (int dx = -1; dx <= 1; ++dx) {
+        for (int dy = -1; dy <= 1; ++dy) {
+            if (!(dx || dy)) continue;
+            paint.drawText(textRect.translated(QPointF(dx, dy)),
+                           Qt::AlignTop | Qt::AlignLeft,
+                           text);
+        }
+    }
+
+    paint.setPen(penColour);
+
+    paint.drawText(textRect,
+                   Qt::AlignTop | Qt::AlignLeft,
+                   text);
+}
+
+static bool
+canUseTextSprites(QPainter &paint)
+{
+    // Only worth doing (and only correct) when painting to a raster
+    // surface with no scaling or rotation in effect - not for
+    // e.g. SVG export, where we want the text to remain text
+    
+    QPaintEngine *engine = paint.paintEngine();
+    if (!engine || engine->type() != QPaintEngine::Raster) {
+        return false;
+    }
+    return paint.worldTransform().type() <= QTransform::TxTranslate;
+}
+
 void
 PaintAssistant::drawVisibleText(const LayerGeometryProvider *v,
                                 QPainter &paint, int x, int y,
@@ -221,38 +341,60 @@ PaintAssistant::drawVisibleText(const LayerGeometryProvider *v,
         boxColour = surroundColour;
         boxColour.setAlpha(127);
 
-        QRectF boundingRect = paint.boundingRect
-            (QRectF(), Qt::AlignTop | Qt::AlignLeft, text);
-
-        QRectF textRect = boundingRect.translated
-            (QPointF(x, y - paint.fontMetrics().ascent()));
+        int ascent = paint.fontMetrics().ascent();
 
-        QRectF boxRect(textRect.x() - 2, textRect.y() - 2,
-                       textRect.width() + 4, textRect.height() + 4);
-
-        paint.setPen(Qt::NoPen);
-        paint.setBrush(boxColour);
-        
-        paint.drawRect(boxRect);
-        paint.setBrush(Qt::NoBrush);
-
-        paint.setPen(surroundColour);
-
-        for (int dx = -1; dx <= 1; ++dx) {
-            for (int dy = -1; dy <= 1; ++dy) {
-                if (!(dx || dy)) continue;
-                paint.drawText(textRect.translated(QPointF(dx, dy)),
-                               Qt::AlignTop | Qt::AlignLeft,
-                               text);
-            }
+        if (!canUseTextSprites(paint)) {
+            drawOutlinedText(paint, QPointF(x, y - ascent), text,
+                             penColour, surroundColour, boxColour);
+            paint.restore();
+            return;
         }
 
-        paint.setPen(penColour);
-
-        paint.drawText(textRect,
-                       Qt::AlignTop | Qt::AlignLeft,
-                       text);
+        double dpr = paint.device()->devicePixelRatioF();
+        bool antialias = paint.testRenderHint(QPainter::TextAntialiasing);
+
+        QString key = QString("%1|%2|%3|%4|%5|%6")
+            .arg(paint.font().key())
+            .arg(penColour.rgba())
+            .arg(surroundColour.rgba())
+            .arg(dpr)
+            .arg(antialias)
+            .arg(text);
+
+        OutlinedTextSpriteCache &cache = OutlinedTextSpriteCache::getInstance();
+        OutlinedTextSpriteCache::Sprite sprite;
+
+        if (!cache.get(key, sprite)) {
+
+            QRectF boundingRect = paint.boundingRect
+                (QRectF(), Qt::AlignTop | Qt::AlignLeft, text);
+
+            QRectF boxRect(boundingRect.x() - 2, boundingRect.y() - 2,
+                           boundingRect.width() + 4,
+                           boundingRect.height() + 4);
+            QRect outer = boxRect.toAlignedRect();
+
+            sprite.image = QImage(int(ceil(outer.width() * dpr)),
+                                  int(ceil(outer.height() * dpr)),
+                                  QImage::Format_ARGB32_Premultiplied);
+            sprite.image.setDevicePixelRatio(dpr);
+            sprite.image.fill(Qt::transparent);
+            sprite.offset = QPointF(outer.x(), outer.y() - ascent);
+
+            QPainter spaint(&sprite.image);
+            spaint.setFont(paint.font());
+            spaint.setRenderHint(QPainter::TextAntialiasing, antialias);
+            spaint.setRenderHint(QPainter::Antialiasing,
+                                 paint.testRenderHint(QPainter::Antialiasing));
+            drawOutlinedText(spaint, QPointF(-outer.x(), -outer.y()), text,
+                             penColour, surroundColour, boxColour);
+            spaint.end();
+
+            cache.put(key, sprite);
+        }
 
+        paint.drawImage(QPointF(x, y) + sprite.offset, sprite.image);
+        
         paint.restore();
 
     } else {
@@ -263,4 +405,3 @@ PaintAssistant::drawVisibleText(const LayerGeometryProvider *v,
 
 
 } // end namespace sv
-
@@ -0,0 +1,106 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+    Sonic Visualiser
+    An audio file viewer and annotation editor.
+    Centre for Digital Music, Queen Mary, University of London.
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation; either version 2 of the
+    License, or (at your option) any later version.  See the file
+    COPYING included with this distribution for more information.
+*/
+
+#include "PeakCachePyramid.h"
+
+#include "data/model/Dense3DModelPeakCache.h"
+
+#include "base/Debug.h"
+
+namespace sv {
+
+PeakCachePyramid::PeakCachePyramid() :
+    m_firstColumnsPerPeak(0),
+    m_maxColumnsPerPeak(0)
+{
+}
+
+PeakCachePyramid::~PeakCachePyramid()
+{
+    release();
+}
+
+void
+PeakCachePyramid::create(ModelId source, int firstColumnsPerPeak,
+                         int maxColumnsPerPeak)
+{
+    release();
+
+    m_source = source;
+    m_firstColumnsPerPeak = firstColumnsPerPeak;
+    m_maxColumnsPerPeak = maxColumnsPerPeak;
+
+    if (m_source.isNone() || m_firstColumnsPerPeak < 1) return;
+
+    m_levels.push_back(ModelById::add
+                       (std::make_shared<Dense3DModelPeakCache>
+                        (m_source, m_firstColumnsPerPeak)));
+
+    createUpperLevels();
+}
+
+void
+PeakCachePyramid::createUpperLevels()
+{
+    int columnsPerPeak = m_firstColumnsPerPeak;
+
+    while (!m_levels.empty() && columnsPerPeak * 2 <= m_maxColumnsPerPeak) {
+        m_levels.push_back(ModelById::add
+                           (std::make_shared<Dense3DModelPeakCache>
+                            (*m_levels.rbegin(), 2)));
+        columnsPerPeak *= 2;
+    }
+
+    SVDEBUG << "PeakCachePyramid: have " << m_levels.size()
+            << " levels over source " << m_source
+            << ", from " << m_firstColumnsPerPeak << " to "
+            << columnsPerPeak << " columns per peak" << endl;
+}
+
+void
+PeakCachePyramid::release()
+{
+    for (auto id: m_levels) {
+        ModelById::release(id);
+    }
+    m_levels.clear();
+}
+
+qint64
+PeakCachePyramid::getEstimatedMemoryUsage() const
+{
+    qint64 bytes = 0;
+    for (auto id: m_levels) {
+        if (auto cache = ModelById::getAs<Dense3DModelPeakCache>(id)) {
+            bytes += qint64(cache->getWidth()) * cache->getHeight() *
+                qint64(sizeof(float));
+        }
+    }
+    return bytes;
+}
+
+void
+PeakCachePyramid::resetUpperLevels()
+{
+    if (m_levels.size() < 2) return;
+
+    for (size_t i = 1; i < m_levels.size(); ++i) {
+        ModelById::release(m_levels[i]);
+    }
+    m_levels.resize(1);
+
+    createUpperLevels();
+}
+
+} // end namespace sv
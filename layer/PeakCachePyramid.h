@@ -0,0 +1,94 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+    Sonic Visualiser
+    An audio file viewer and annotation editor.
+    Centre for Digital Music, Queen Mary, University of London.
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation; either version 2 of the
+    License, or (at your option) any later version.  See the file
+    COPYING included with this distribution for more information.
+*/
+
+#ifndef SV_PEAK_CACHE_PYRAMID_H
+#define SV_PEAK_CACHE_PYRAMID_H
+
+#include "data/model/Model.h"
+
+#include <vector>
+
+namespace sv {
+
+/**
+ * A series of Dense3DModelPeakCaches over a single dense 3D model,
+ * at successive power-of-two resolutions, for use as the peak caches
+ * of a Colour3DPlotRenderer.
+ *
+ * The first level is built on the source model with a given number
+ * of columns per peak. Each further level is built on the level
+ * before it with two columns per peak, so the levels are filled
+ * lazily and cheaply from one another as they are used, and together
+ * take no more memory than the first. Levels are added until the
+ * total number of source columns per peak reaches a maximum.
+ *
+ * The pyramid registers its caches with ModelById and is responsible
+ * for releasing them.
+ */
+class PeakCachePyramid
+{
+public:
+    PeakCachePyramid();
+    ~PeakCachePyramid();
+
+    static const int defaultMaxColumnsPerPeak = 4096;
+    
+    /**
+     * Release any existing levels and create new ones over the given
+     * source model.
+     */
+    void create(ModelId source, int firstColumnsPerPeak,
+                int maxColumnsPerPeak = defaultMaxColumnsPerPeak);
+
+    /**
+     * Release all levels.
+     */
+    void release();
+
+    /**
+     * Release and recreate the levels above the first. Those levels
+     * are built on other caches rather than the source model, so they
+     * are not told when the source changes and should be reset by the
+     * owner when it does.
+     */
+    void resetUpperLevels();
+
+    bool isEmpty() const { return m_levels.empty(); }
+
+    /**
+     * Return the caches, finest first.
+     */
+    const std::vector<ModelId> &getLevels() const { return m_levels; }
+
+    /**
+     * Return the amount of memory in bytes that the levels will use
+     * once they have been completely filled.
+     */
+    qint64 getEstimatedMemoryUsage() const;
+
+private:
+    ModelId m_source;
+    int m_firstColumnsPerPeak;
+    int m_maxColumnsPerPeak;
+    std::vector<ModelId> m_levels;
+
+    void createUpperLevels();
+
+    PeakCachePyramid(const PeakCachePyramid &) =delete;
+    PeakCachePyramid &operator=(const PeakCachePyramid &) =delete;
+};
+
+} // end namespace sv
+
+#endif
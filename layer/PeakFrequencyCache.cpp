@@ -0,0 +1,123 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+    Sonic Visualiser
+    An audio file viewer and annotation editor.
+    Centre for Digital Music, Queen Mary, University of London.
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation; either version 2 of the
+    License, or (at your option) any later version.  See the file
+    COPYING included with this distribution for more information.
+*/
+
+#include "PeakFrequencyCache.h"
+
+#include "data/model/FFTModel.h"
+
+#include "base/Debug.h"
+
+namespace sv {
+
+PeakFrequencyCache::PeakFrequencyCache() :
+    m_useCounter(0)
+{
+}
+
+void
+PeakFrequencyCache::reset(ModelId fftModel)
+{
+    m_fftModel = fftModel;
+    invalidate();
+}
+
+void
+PeakFrequencyCache::invalidate()
+{
+    // Release the memory, as this may be on eviction
+    m_stores.clear();
+}
+
+PeakFrequencyCache::Store &
+PeakFrequencyCache::getStore(BinRange range)
+{
+    auto itr = m_stores.find(range);
+
+    if (itr == m_stores.end()) {
+        if (int(m_stores.size()) >= maxStores) {
+            auto oldest = m_stores.begin();
+            for (auto j = m_stores.begin(); j != m_stores.end(); ++j) {
+                if (j->second.lastUsed < oldest->second.lastUsed) {
+                    oldest = j;
+                }
+            }
+            m_stores.erase(oldest);
+        }
+        itr = m_stores.insert({ range, Store() }).first;
+    }
+
+    itr->second.lastUsed = ++m_useCounter;
+    return itr->second;
+}
+
+bool
+PeakFrequencyCache::getPeaks(int column, int minbin, int maxbin,
+                             const int *&bins, const float *&freqs, int &count)
+{
+    bins = nullptr;
+    freqs = nullptr;
+    count = 0;
+
+    if (column < 0 || minbin < 0 || maxbin < minbin) return false;
+
+    Store &store = getStore(BinRange(minbin, maxbin));
+    
+    if (column >= int(store.extents.size()) ||
+        store.extents[column].count < 0) {
+
+        auto fft = ModelById::getAs<FFTModel>(m_fftModel);
+        if (!fft) return false;
+
+        // The model may still be growing, as its source is loaded
+        int width = fft->getWidth();
+        if (column >= width) return false;
+        if (int(store.extents.size()) < width) {
+            store.extents.resize(width);
+        }
+
+        FFTModel::PeakSet peaks = fft->getPeakFrequencies
+            (FFTModel::AllPeaks, column, minbin, maxbin);
+
+        Extent &extent = store.extents[column];
+        extent.offset = uint32_t(store.bins.size());
+        extent.count = int32_t(peaks.size());
+
+        for (const auto &p: peaks) {
+            store.bins.push_back(p.first);
+            store.freqs.push_back(float(p.second));
+        }
+    }
+
+    const Extent &extent = store.extents[column];
+    if (extent.count > 0) {
+        bins = store.bins.data() + extent.offset;
+        freqs = store.freqs.data() + extent.offset;
+        count = extent.count;
+    }
+    return true;
+}
+
+qint64
+PeakFrequencyCache::getMemoryUsage() const
+{
+    qint64 bytes = 0;
+    for (const auto &s: m_stores) {
+        bytes += qint64(s.second.extents.capacity()) * qint64(sizeof(Extent)) +
+            qint64(s.second.bins.capacity()) * qint64(sizeof(int)) +
+            qint64(s.second.freqs.capacity()) * qint64(sizeof(float));
+    }
+    return bytes;
+}
+
+} // end namespace sv
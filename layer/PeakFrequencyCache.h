@@ -0,0 +1,103 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+    Sonic Visualiser
+    An audio file viewer and annotation editor.
+    Centre for Digital Music, Queen Mary, University of London.
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation; either version 2 of the
+    License, or (at your option) any later version.  See the file
+    COPYING included with this distribution for more information.
+*/
+
+#ifndef SV_PEAK_FREQUENCY_CACHE_H
+#define SV_PEAK_FREQUENCY_CACHE_H
+
+#include "data/model/Model.h"
+
+#include <map>
+#include <vector>
+#include <cstdint>
+
+namespace sv {
+
+/**
+ * The estimated peak frequencies of every column of an FFTModel, as
+ * used by the spectrogram's peak-frequency display mode, computed
+ * once per column and kept for reuse on later paints and by every
+ * view showing the layer.
+ *
+ * The peaks for each column are found across the requested bin range
+ * when the column is first requested, and appended to a pair of flat
+ * arrays holding the bin number and frequency of each peak in
+ * ascending bin order. Peaks are kept separately for each bin range,
+ * since whether a bin at the edge of a range counts as a peak depends
+ * on the range, and computing over the whole height would make the
+ * first paint of a vertically zoomed view needlessly slow. Only the
+ * few most recently used ranges are retained.
+ *
+ * This class is not thread-safe.
+ */
+class PeakFrequencyCache
+{
+public:
+    PeakFrequencyCache();
+
+    /**
+     * Discard all peaks and use the given FFTModel from now on.
+     */
+    void reset(ModelId fftModel);
+
+    /**
+     * Discard all peaks, because the model has changed.
+     */
+    void invalidate();
+
+    /**
+     * Look up the peaks for the given column within bins minbin to
+     * maxbin inclusive, calculating them if they are not yet known.
+     * Set bins and freqs to point to arrays of count peak bins and
+     * frequencies, valid until the next call to any non-const
+     * method. Return false if the column is out of range or the
+     * model has gone away.
+     */
+    bool getPeaks(int column, int minbin, int maxbin,
+                  const int *&bins, const float *&freqs, int &count);
+
+    /**
+     * Return the amount of memory in bytes currently used.
+     */
+    qint64 getMemoryUsage() const;
+
+private:
+    ModelId m_fftModel;
+
+    struct Extent {
+        Extent() : offset(0), count(-1) { }
+        uint32_t offset;
+        int32_t count; // -1 if not yet calculated
+    };
+    
+    struct Store {
+        Store() : lastUsed(0) { }
+        std::vector<Extent> extents; // per column
+        std::vector<int> bins;
+        std::vector<float> freqs;
+        qint64 lastUsed;
+    };
+
+    typedef std::pair<int, int> BinRange;
+    
+    std::map<BinRange, Store> m_stores;
+    qint64 m_useCounter;
+
+    static const int maxStores = 4;
+
+    Store &getStore(BinRange range);
+};
+
+} // end namespace sv
+
+#endif
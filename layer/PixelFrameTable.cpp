@@ -0,0 +1,124 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+    Sonic Visualiser
+    An audio file viewer and annotation editor.
+    Centre for Digital Music, Queen Mary, University of London.
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation; either version 2 of the
+    License, or (at your option) any later version.  See the file
+    COPYING included with this distribution for more information.
+*/
+
+#include "PixelFrameTable.h"
+
+#include "LayerGeometryProvider.h"
+
+#include <algorithm>
+
+namespace sv {
+
+PixelFrameTable::PixelFrameTable(const LayerGeometryProvider *v) :
+    m_v(v),
+    m_zoomLevel(v->getZoomLevel()),
+    m_level(m_zoomLevel.level),
+    m_linear(false),
+    m_anchorX(0),
+    m_anchorFrame(0)
+{
+    if (m_level < 1) m_level = 1;
+
+    int w = v->getPaintWidth();
+    if (w < 1) w = 1;
+
+    // One more than the paint width, so that the frame at the right
+    // edge of the last pixel is also available
+
+    m_frames.resize(w + 1);
+    for (int x = 0; x <= w; ++x) {
+        m_frames[x] = v->getFrameForX(x);
+    }
+
+    // Find an anchor from which the frames can be extrapolated: in
+    // the frames-per-pixel zone any pixel will do, but in the
+    // pixels-per-frame zone we need the first pixel of some frame
+
+    bool haveAnchor = false;
+
+    if (m_zoomLevel.zone == ZoomLevel::FramesPerPixel) {
+        m_anchorX = 0;
+        m_anchorFrame = m_frames[0];
+        haveAnchor = true;
+    } else {
+        for (int x = 1; x <= w; ++x) {
+            if (m_frames[x] != m_frames[x-1]) {
+                m_anchorX = x;
+                m_anchorFrame = m_frames[x];
+                haveAnchor = true;
+                break;
+            }
+        }
+    }
+
+    if (!haveAnchor) return;
+
+    // Linear if every frame in the table is where the zoom level
+    // says it should be, and a sample of frames map back to the
+    // right pixels through the provider as well (it might round them
+    // differently, as ViewProxy does with a scale factor)
+
+    m_linear = true;
+
+    for (int x = 0; x <= w; ++x) {
+        if (m_frames[x] != getFrameForX(x)) {
+            m_linear = false;
+            return;
+        }
+    }
+
+    int samples[] = { 0, m_anchorX, m_anchorX + 1, w / 2, w - 1 };
+    for (int x: samples) {
+        if (x < 0 || x > w) continue;
+        sv_frame_t frame = m_frames[x];
+        if (m_zoomLevel.zone == ZoomLevel::PixelsPerFrame &&
+            (x == 0 || m_frames[x-1] == frame)) {
+            // not the first pixel of its frame, so not its x
+            continue;
+        }
+        if (v->getXForFrame(frame) != x) {
+            m_linear = false;
+            return;
+        }
+    }
+
+    m_frames.clear();
+}
+
+sv_frame_t
+PixelFrameTable::getFrameForXFromProvider(int x) const
+{
+    return m_v->getFrameForX(x);
+}
+
+int
+PixelFrameTable::getXForFrameFromTable(sv_frame_t frame) const
+{
+    if (m_frames.empty() ||
+        frame < m_frames[0] ||
+        frame >= *m_frames.rbegin()) {
+        return m_v->getXForFrame(frame);
+    }
+
+    // The first pixel whose frame is at least the one sought, if it
+    // is that frame exactly; otherwise the pixel before it, which is
+    // the one covering the frame
+
+    auto itr = std::lower_bound(m_frames.begin(), m_frames.end(), frame);
+    int x = int(itr - m_frames.begin());
+    if (*itr != frame) --x;
+    return x;
+}
+
+} // end namespace sv
@@ -0,0 +1,107 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+    Sonic Visualiser
+    An audio file viewer and annotation editor.
+    Centre for Digital Music, Queen Mary, University of London.
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation; either version 2 of the
+    License, or (at your option) any later version.  See the file
+    COPYING included with this distribution for more information.
+*/
+
+#ifndef SV_PIXEL_FRAME_TABLE_H
+#define SV_PIXEL_FRAME_TABLE_H
+
+#include "base/BaseTypes.h"
+#include "base/ZoomLevel.h"
+
+#include <vector>
+
+namespace sv {
+
+class LayerGeometryProvider;
+
+/**
+ * The mapping between pixel x-coordinates and sample frames of a
+ * LayerGeometryProvider at one moment, for use in the inner loops of
+ * layer painting, where calling getFrameForX and getXForFrame through
+ * the provider for every pixel or event means a virtual call, zoom
+ * arithmetic and, for an aligned layer, an alignment model lookup
+ * each time.
+ *
+ * The table takes the provider's frame for every x across its paint
+ * width, so any alignment is folded into it. If those frames turn out
+ * to be spaced exactly as the zoom level says, as they are whenever
+ * no alignment is involved, both directions are then worked out
+ * arithmetically for any argument. Otherwise values within the paint
+ * width are looked up in the table, and anything outside it is passed
+ * to the provider.
+ *
+ * Frames are always the same as the provider's. Pixels are too,
+ * except that in the table lookup case getXForFrame returns the
+ * pixel whose frame range covers the given frame, which may be one
+ * away from the provider's answer if the provider's two directions
+ * disagree (as they can through an alignment).
+ *
+ * The table is valid only as long as the provider's geometry is
+ * unchanged, in practice for the duration of a single paint. Obtain
+ * one through LayerGeometryProvider::getPixelFrameTable(), which lets
+ * a provider share a table between all the layers painted in one go.
+ */
+class PixelFrameTable
+{
+public:
+    PixelFrameTable(const LayerGeometryProvider *v);
+
+    sv_frame_t getFrameForX(int x) const {
+        if (m_linear) {
+            if (m_zoomLevel.zone == ZoomLevel::FramesPerPixel) {
+                return m_anchorFrame + sv_frame_t(x - m_anchorX) * m_level;
+            } else {
+                return m_anchorFrame + floorDiv(x - m_anchorX, m_level);
+            }
+        }
+        if (x >= 0 && x < int(m_frames.size())) {
+            return m_frames[x];
+        }
+        return getFrameForXFromProvider(x);
+    }
+
+    int getXForFrame(sv_frame_t frame) const {
+        if (m_linear) {
+            if (m_zoomLevel.zone == ZoomLevel::FramesPerPixel) {
+                return m_anchorX + int(floorDiv(frame - m_anchorFrame, m_level));
+            } else {
+                return m_anchorX + int((frame - m_anchorFrame) * m_level);
+            }
+        }
+        return getXForFrameFromTable(frame);
+    }
+
+    ZoomLevel getZoomLevel() const { return m_zoomLevel; }
+
+private:
+    const LayerGeometryProvider *m_v;
+    ZoomLevel m_zoomLevel;
+    sv_frame_t m_level;
+    bool m_linear;
+    int m_anchorX;
+    sv_frame_t m_anchorFrame;
+    std::vector<sv_frame_t> m_frames; // only if not linear
+
+    static sv_frame_t floorDiv(sv_frame_t a, sv_frame_t b) {
+        sv_frame_t q = a / b;
+        if ((a % b != 0) && ((a < 0) != (b < 0))) --q;
+        return q;
+    }
+
+    sv_frame_t getFrameForXFromProvider(int x) const;
+    int getXForFrameFromTable(sv_frame_t frame) const;
+};
+
+} // end namespace sv
+
+#endif
@@ -339,12 +339,21 @@ RegionLayer::getLocalPoints(LayerGeometryProvider *v, int x) const
     auto model = ModelById::getAs<RegionModel>(m_model);
     if (!model) return EventVector();
 
+    int fuzz = ViewManager::scalePixelSize(2);
+
+    // Try the regions drawn in a recent paint first, with the same
+    // order of preference as the model queries below
+
+    EventVector cached;
+    if (getHitCache(v).getDurationsNear(v, x, fuzz, cached)) {
+        return cached;
+    }
+
     sv_frame_t frame = v->getFrameForX(x);
 
     EventVector local = model->getEventsCovering(frame);
     if (!local.empty()) return local;
 
-    int fuzz = ViewManager::scalePixelSize(2);
     sv_frame_t start = v->getFrameForX(x - fuzz);
     sv_frame_t end = v->getFrameForX(x + fuzz);
 
@@ -363,6 +372,14 @@ RegionLayer::getPointToDrag(LayerGeometryProvider *v, int x, int y, Event &point
     auto model = ModelById::getAs<RegionModel>(m_model);
     if (!model) return false;
 
+    // Regions are recorded with their top at the y coordinate of
+    // their value
+    bool found = false;
+    if (getHitCache(v).getNearestInColumn
+        (v, x, y, FeatureHitCache::Anchor::Top, found, point)) {
+        return found;
+    }
+
     sv_frame_t frame = v->getFrameForX(x);
 
     EventVector onPoints = model->getEventsCovering(frame);
@@ -913,6 +930,8 @@ RegionLayer::paint(LayerGeometryProvider *v, QPainter &paint, QRect rect) const
     bool clippingRequired = (m_plotStyle == PlotSegmentation);
     paint.setClipRect(rect);
     paint.setClipping(clippingRequired);
+
+    FeatureHitCache::Recorder recorder(getHitCache(v), v, rect);
     
     for (EventVector::const_iterator i = points.begin();
          i != points.end(); ++i) {
@@ -924,6 +943,8 @@ RegionLayer::paint(LayerGeometryProvider *v, QPainter &paint, QRect rect) const
         int y = getYForValue(v, p.getValue());
         int ex = x + w;
 
+        recorder.add(p, QRect(x, y, w, 1));
+
         int gap = v->scalePixelSize(2);
         
         EventVector::const_iterator j = i;
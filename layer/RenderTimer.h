@@ -41,8 +41,12 @@ public:
      * rendering. If outOfTime() returns true, abandon rendering!  and
      * schedule the rest for after some user responsiveness has
      * happened.
+     *
+     * The time limits are multiplied by limitScale, which a view
+     * may reduce to spread its rendering over more, shorter slices
+     * (see LayerGeometryProvider::getRenderTimeScale()).
      */
-    RenderTimer(Type t) :
+    RenderTimer(Type t, double limitScale = 1.0) :
         m_start(std::chrono::steady_clock::now()),
         m_haveLimits(true),
         m_minFraction(0.15),
@@ -57,6 +61,9 @@ public:
             m_softLimit = 0.2;
             m_hardLimit = 0.4;
         }
+
+        m_softLimit *= limitScale;
+        m_hardLimit *= limitScale;
     }
 
 
@@ -175,6 +175,19 @@ ScrollableImageCache::drawImage(int left,
                       QRect(imageLeft, 0, imageWidth, image.height()));
     painter.end();
 
+    markDrawn(left, width);
+}
+
+void
+ScrollableImageCache::markDrawn(int left, int width)
+{
+    if (left < 0 || width < 0 || left + width > m_image.width()) {
+        cerr << "ScrollableImageCache::markDrawn: ERROR: Area (left = "
+             << left << ", width = " << width << ", so right = " << left + width
+             << ") out of bounds for cache of width " << m_image.width() << endl;
+        throw std::logic_error("Area out of bounds in ScrollableImageCache::markDrawn");
+    }
+    
     if (!isValid()) {
         m_validLeft = left;
         m_validWidth = width;
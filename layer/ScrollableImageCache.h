@@ -34,7 +34,8 @@ namespace sv {
  * range of the image is valid.
  *
  * The only way to *update* the valid area in a cache is to draw to it
- * using the drawImage call.
+ * using the drawImage call, or to write to it directly and then call
+ * markDrawn.
  */
 class ScrollableImageCache
 {
@@ -153,6 +154,23 @@ public:
                    QImage image,
                    int imageLeft,
                    int imageWidth);
+
+    /**
+     * Return a pointer to the pixels of row y of the cache image, in
+     * ARGB32 premultiplied format, so that the caller can write to
+     * them directly without going through an intermediate image. The
+     * caller must then call markDrawn for the columns written.
+     */
+    QRgb *getScanLineForWriting(int y) {
+        return reinterpret_cast<QRgb *>(m_image.scanLine(y));
+    }
+
+    /**
+     * Update the valid area to account for the given region of the
+     * cache, at full height, having been written via
+     * getScanLineForWriting.
+     */
+    void markDrawn(int left, int width);
     
 private:
     QImage m_image;
@@ -0,0 +1,138 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+    Sonic Visualiser
+    An audio file viewer and annotation editor.
+    Centre for Digital Music, Queen Mary, University of London.
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation; either version 2 of the
+    License, or (at your option) any later version.  See the file
+    COPYING included with this distribution for more information.
+*/
+
+#include "ScrollableValueCache.h"
+
+#include "base/Debug.h"
+
+#include <cstring>
+#include <stdexcept>
+
+using namespace std;
+
+//#define DEBUG_SCROLLABLE_VALUE_CACHE 1
+
+namespace sv {
+
+void
+ScrollableValueCache::resize(QSize newSize)
+{
+    if (m_size == newSize) return;
+
+    m_size = newSize;
+    m_values = vector<float>(size_t(newSize.width()) * newSize.height(), 0.f);
+    m_columnSet = vector<bool>(newSize.width(), false);
+}
+
+void
+ScrollableValueCache::scrollTo(const LayerGeometryProvider *v,
+                               sv_frame_t newStartFrame)
+{
+    int dx = (v->getXForFrame(m_startFrame) -
+              v->getXForFrame(newStartFrame));
+
+#ifdef DEBUG_SCROLLABLE_VALUE_CACHE
+    SVDEBUG << "ScrollableValueCache::scrollTo: start frame " << m_startFrame
+            << " -> " << newStartFrame << ", dx = " << dx << endl;
+#endif
+
+    if (m_startFrame == newStartFrame) {
+        return;
+    }
+
+    m_startFrame = newStartFrame;
+
+    if (dx == 0) {
+        return;
+    }
+
+    int w = m_size.width();
+    int h = m_size.height();
+
+    if (dx <= -w || dx >= w) {
+        invalidate();
+        return;
+    }
+
+    int dxp = dx;
+    if (dxp < 0) dxp = -dxp;
+
+    size_t copylen = size_t(w - dxp) * sizeof(float);
+    for (int y = 0; y < h; ++y) {
+        float *line = m_values.data() + size_t(y) * w;
+        if (dx < 0) {
+            memmove(line, line + dxp, copylen);
+        } else {
+            memmove(line + dxp, line, copylen);
+        }
+    }
+
+    if (dx < 0) {
+        m_columnSet.erase(m_columnSet.begin(), m_columnSet.begin() + dxp);
+        m_columnSet.insert(m_columnSet.end(), dxp, false);
+    } else {
+        m_columnSet.erase(m_columnSet.end() - dxp, m_columnSet.end());
+        m_columnSet.insert(m_columnSet.begin(), dxp, false);
+    }
+}
+
+void
+ScrollableValueCache::drawValues(int left, int width,
+                                 const float *source, int sourceStride,
+                                 int sourceLeft)
+{
+    int w = m_size.width();
+    int h = m_size.height();
+
+    if (left < 0 || width < 0 || left + width > w) {
+        SVCERR << "ScrollableValueCache::drawValues: ERROR: Target area (left = "
+               << left << ", width = " << width << ", so right = "
+               << left + width << ") out of bounds for cache of width "
+               << w << endl;
+        throw std::logic_error("Target area out of bounds in ScrollableValueCache::drawValues");
+    }
+    if (sourceLeft < 0 || sourceLeft + width > sourceStride) {
+        SVCERR << "ScrollableValueCache::drawValues: ERROR: Source area (left = "
+               << sourceLeft << ", width = " << width
+               << ") out of bounds for source of stride " << sourceStride
+               << endl;
+        throw std::logic_error("Source area out of bounds in ScrollableValueCache::drawValues");
+    }
+
+    for (int y = 0; y < h; ++y) {
+        memcpy(m_values.data() + size_t(y) * w + left,
+               source + size_t(y) * sourceStride + sourceLeft,
+               size_t(width) * sizeof(float));
+    }
+
+    markColumnsSet(left, width);
+}
+
+void
+ScrollableValueCache::markColumnsSet(int left, int width)
+{
+    if (left < 0 || width < 0 || left + width > m_size.width()) {
+        SVCERR << "ScrollableValueCache::markColumnsSet: ERROR: Area (left = "
+               << left << ", width = " << width
+               << ") out of bounds for cache of width "
+               << m_size.width() << endl;
+        throw std::logic_error("Area out of bounds in ScrollableValueCache::markColumnsSet");
+    }
+    
+    for (int x = left; x < left + width; ++x) {
+        m_columnSet[x] = true;
+    }
+}
+
+} // end namespace sv
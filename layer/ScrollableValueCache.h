@@ -0,0 +1,160 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+    Sonic Visualiser
+    An audio file viewer and annotation editor.
+    Centre for Digital Music, Queen Mary, University of London.
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation; either version 2 of the
+    License, or (at your option) any later version.  See the file
+    COPYING included with this distribution for more information.
+*/
+
+#ifndef SCROLLABLE_VALUE_CACHE_H
+#define SCROLLABLE_VALUE_CACHE_H
+
+#include "base/BaseTypes.h"
+
+#include "LayerGeometryProvider.h"
+
+#include <QSize>
+
+#include <vector>
+
+namespace sv {
+
+/**
+ * A cached plane of values, one per pixel, for a view that scrolls
+ * horizontally, such as a spectrogram. This is intended to be used
+ * alongside a ScrollableImageCache, recording for each pixel in the
+ * image the value that was mapped to a colour to produce it, so that
+ * the image can be regenerated with a different colour mapping
+ * without going back to the source data.
+ *
+ * Values are stored row by row, with row zero at the top, as for the
+ * image. A pixel that does not correspond to any value (i.e. that was
+ * filled with the background colour) is stored as NaN.
+ *
+ * The cache can scroll and report which columns have been
+ * written. The only way to *update* a column is to draw to it using
+ * the drawValues call, or to write to it directly and then call
+ * markColumnsSet.
+ */
+class ScrollableValueCache
+{
+public:
+    ScrollableValueCache() :
+        m_startFrame(0)
+    {}
+
+    void invalidate() {
+        m_columnSet = std::vector<bool>(m_columnSet.size(), false);
+    }
+
+    QSize getSize() const {
+        return m_size;
+    }
+
+    /**
+     * Set the size of the cache. If the new size differs from the
+     * current size, the cache is invalidated.
+     */
+    void resize(QSize newSize);
+
+    ZoomLevel getZoomLevel() const {
+        return m_zoomLevel;
+    }
+
+    /**
+     * Set the zoom level. If the new zoom level differs from the
+     * current one, the cache is invalidated.
+     */
+    void setZoomLevel(ZoomLevel zoom) {
+        using namespace std::rel_ops;
+        if (m_zoomLevel != zoom) {
+            m_zoomLevel = zoom;
+            invalidate();
+        }
+    }
+
+    sv_frame_t getStartFrame() const {
+        return m_startFrame;
+    }
+
+    /**
+     * Set the start frame. If the new start frame differs from the
+     * current one, the cache is invalidated. To scroll, use
+     * scrollTo() instead.
+     */
+    void setStartFrame(sv_frame_t frame) {
+        if (m_startFrame != frame) {
+            m_startFrame = frame;
+            invalidate();
+        }
+    }
+
+    bool isColumnSet(int column) const {
+        return in_range_for(m_columnSet, column) && m_columnSet[column];
+    }
+
+    bool areColumnsSet(int x, int count) const {
+        for (int i = 0; i < count; ++i) {
+            if (!isColumnSet(x + i)) return false;
+        }
+        return true;
+    }
+
+    /**
+     * Return a pointer to the values for row y. The row contains
+     * getSize().width() values.
+     */
+    const float *getRow(int y) const {
+        return m_values.data() + size_t(y) * m_size.width();
+    }
+
+    /**
+     * Set the new start frame for the cache, according to the
+     * geometry of the supplied LayerGeometryProvider, if possible
+     * also moving along any existing values within the cache so that
+     * they continue to be valid for the new start frame.
+     */
+    void scrollTo(const LayerGeometryProvider *v, sv_frame_t newStartFrame);
+
+    /**
+     * Copy values into the cache. The source must have the same
+     * number of rows as the cache, with row y starting at source + y
+     * * sourceStride, and the full height is always copied. The left
+     * and width parameters determine the target columns of the
+     * cache, sourceLeft the first source column.
+     */
+    void drawValues(int left, int width,
+                    const float *source, int sourceStride, int sourceLeft);
+
+    /**
+     * Return a pointer to the values for row y, so that the caller
+     * can write to them directly. The caller must then call
+     * markColumnsSet for the columns written.
+     */
+    float *getRowForWriting(int y) {
+        return m_values.data() + size_t(y) * m_size.width();
+    }
+
+    /**
+     * Record that the given columns have been written, at full
+     * height, via getRowForWriting.
+     */
+    void markColumnsSet(int left, int width);
+
+private:
+    QSize m_size;
+    std::vector<float> m_values;
+    std::vector<bool> m_columnSet;
+    sv_frame_t m_startFrame;
+    ZoomLevel m_zoomLevel;
+};
+
+} // end namespace sv
+
+#endif
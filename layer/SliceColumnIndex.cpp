@@ -0,0 +1,261 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+    Sonic Visualiser
+    An audio file viewer and annotation editor.
+    Centre for Digital Music, Queen Mary, University of London.
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation; either version 2 of the
+    License, or (at your option) any later version.  See the file
+    COPYING included with this distribution for more information.
+*/
+
+#include "SliceColumnIndex.h"
+
+#include "data/model/DenseThreeDimensionalModel.h"
+
+#include "base/Debug.h"
+#include "base/Profiler.h"
+
+#include <algorithm>
+
+//#define DEBUG_SLICE_COLUMN_INDEX 1
+
+namespace sv {
+
+// Number of columns in the smallest indexed span. Larger blocks take
+// less memory but leave more columns to be read directly at the ends
+// of each query
+static const int blockSize = 32;
+
+SliceColumnIndex::SliceColumnIndex() :
+    m_bytes(0)
+{
+}
+
+SliceColumnIndex::~SliceColumnIndex()
+{
+    LayerCacheBudget::getInstance()->removeAll(this);
+}
+
+void
+SliceColumnIndex::setModel(ModelId model)
+{
+    m_model = model;
+    invalidate();
+}
+
+void
+SliceColumnIndex::invalidate()
+{
+    m_spans.clear();
+    m_bytes = 0;
+    LayerCacheBudget::getInstance()->remove(this, 0);
+}
+
+void
+SliceColumnIndex::invalidate(int col0, int col1)
+{
+    if (col0 < 0) col0 = 0;
+    if (col1 < col0) return;
+    
+    for (auto itr = m_spans.begin(); itr != m_spans.end(); ) {
+        int size = blockSize << itr->first.first;
+        int start = itr->first.second * size;
+        if (start <= col1 && start + size > col0) {
+            m_bytes -= getSpanBytes(itr->second);
+            itr = m_spans.erase(itr);
+        } else {
+            ++itr;
+        }
+    }
+
+    if (m_spans.empty()) {
+        m_bytes = 0;
+        LayerCacheBudget::getInstance()->remove(this, 0);
+    }
+}
+
+qint64
+SliceColumnIndex::getSpanBytes(const Span &span)
+{
+    return qint64(sizeof(Span) + sizeof(SpanKey) +
+                  span.sums.size() * sizeof(double) +
+                  span.maxima.size() * sizeof(float));
+}
+
+void
+SliceColumnIndex::evictCache(int)
+{
+#ifdef DEBUG_SLICE_COLUMN_INDEX
+    SVDEBUG << "SliceColumnIndex::evictCache: discarding " << m_spans.size()
+            << " spans (" << m_bytes << " bytes)" << endl;
+#endif
+    
+    m_spans.clear();
+    m_bytes = 0;
+}
+
+const SliceColumnIndex::Span &
+SliceColumnIndex::getSpan(int level, int index, int height)
+{
+    SpanKey key(level, index);
+    
+    auto itr = m_spans.find(key);
+    if (itr != m_spans.end()) {
+        return itr->second;
+    }
+
+    Span span;
+    span.sums = std::vector<double>(height, 0.0);
+    span.maxima = std::vector<float>(height, 0.f);
+
+    bool first = true;
+    
+    auto addMaxima = [&](const float *mm, int n) {
+        for (int i = 0; i < n; ++i) {
+            if (first || mm[i] > span.maxima[i]) span.maxima[i] = mm[i];
+        }
+    };
+
+    if (level == 0) {
+
+        auto model = ModelById::getAs<DenseThreeDimensionalModel>(m_model);
+        if (model) {
+            int col0 = index * blockSize;
+            for (int col = col0; col < col0 + blockSize; ++col) {
+                auto column = model->getColumn(col);
+                if (column.empty()) continue;
+                int n = std::min(int(column.size()), height);
+                for (int i = 0; i < n; ++i) {
+                    span.sums[i] += column[i];
+                }
+                addMaxima(column.data(), n);
+                ++span.count;
+                first = false;
+            }
+        }
+        
+    } else {
+
+        for (int child = index * 2; child < index * 2 + 2; ++child) {
+            const Span &c = getSpan(level - 1, child, height);
+            if (c.count == 0) continue;
+            for (int i = 0; i < height; ++i) {
+                span.sums[i] += c.sums[i];
+            }
+            addMaxima(c.maxima.data(), height);
+            span.count += c.count;
+            first = false;
+        }
+    }
+
+#ifdef DEBUG_SLICE_COLUMN_INDEX
+    SVDEBUG << "SliceColumnIndex::getSpan: calculated span at level "
+            << level << ", index " << index << " with " << span.count
+            << " non-empty columns" << endl;
+#endif
+
+    m_bytes += getSpanBytes(span);
+    
+    return m_spans.insert({ key, span }).first->second;
+}
+
+void
+SliceColumnIndex::addColumn(const std::vector<float> &column,
+                            int bin0, int nbins,
+                            Aggregate type, std::vector<float> &values) const
+{
+    int n = std::min(int(column.size()) - bin0, nbins);
+    for (int i = 0; i < n; ++i) {
+        float value = column[bin0 + i];
+        if (type == Maximum) {
+            if (value > values[i]) values[i] = value;
+        } else {
+            values[i] += value;
+        }
+    }
+}
+
+int
+SliceColumnIndex::aggregate(int col0, int col1, int bin0, int nbins,
+                            Aggregate type, std::vector<float> &values)
+{
+    Profiler profiler("SliceColumnIndex::aggregate");
+    
+    values = std::vector<float>(std::max(nbins, 0), 0.f);
+    
+    auto model = ModelById::getAs<DenseThreeDimensionalModel>(m_model);
+    if (!model || nbins <= 0 || bin0 < 0) return 0;
+
+    int width = model->getWidth();
+    int height = model->getHeight();
+    
+    if (col0 < 0) col0 = 0;
+    if (col1 >= width) col1 = width - 1;
+    if (col1 < col0) return 0;
+
+    int count = 0;
+    
+    auto addDirect = [&](int from, int to) { // to is exclusive
+        for (int col = from; col < to; ++col) {
+            auto column = model->getColumn(col);
+            if (column.empty()) continue;
+            addColumn(column, bin0, nbins, type, values);
+            ++count;
+        }
+    };
+
+    int end = col1 + 1;
+    int col = col0;
+
+    // Leading columns, up to the first block boundary
+    int aligned = ((col0 + blockSize - 1) / blockSize) * blockSize;
+    if (aligned + blockSize > end) {
+        // Not even one whole block: just read the lot
+        addDirect(col0, end);
+        return count;
+    }
+    addDirect(col0, aligned);
+    col = aligned;
+
+    int n = std::min(nbins, height - bin0);
+
+    // Whole spans, each as large as its alignment and what is left
+    // of the range allow
+    while (col + blockSize <= end) {
+        int level = 0;
+        int size = blockSize;
+        while (col % (size * 2) == 0 && col + size * 2 <= end) {
+            size *= 2;
+            ++level;
+        }
+        const Span &span = getSpan(level, col / size, height);
+        if (span.count > 0) {
+            for (int i = 0; i < n; ++i) {
+                if (type == Maximum) {
+                    if (span.maxima[bin0 + i] > values[i]) {
+                        values[i] = span.maxima[bin0 + i];
+                    }
+                } else {
+                    values[i] += float(span.sums[bin0 + i]);
+                }
+            }
+            count += span.count;
+        }
+        col += size;
+    }
+
+    // Trailing columns
+    addDirect(col, end);
+
+    if (m_bytes > 0) {
+        LayerCacheBudget::getInstance()->setUsage(this, 0, m_bytes);
+    }
+
+    return count;
+}
+
+} // end namespace sv
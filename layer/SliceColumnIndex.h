@@ -0,0 +1,117 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+    Sonic Visualiser
+    An audio file viewer and annotation editor.
+    Centre for Digital Music, Queen Mary, University of London.
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation; either version 2 of the
+    License, or (at your option) any later version.  See the file
+    COPYING included with this distribution for more information.
+*/
+
+#ifndef SV_SLICE_COLUMN_INDEX_H
+#define SV_SLICE_COLUMN_INDEX_H
+
+#include "LayerCacheBudget.h"
+
+#include "data/model/Model.h"
+
+#include <map>
+#include <vector>
+
+namespace sv {
+
+/**
+ * Per-bin sums and maxima over ranges of columns of a
+ * DenseThreeDimensionalModel, for slices that aggregate many columns
+ * at once.
+ *
+ * The columns are grouped into aligned blocks of a fixed size, and
+ * blocks into a binary hierarchy of aligned spans of 2, 4, 8 ... blocks.
+ * The sum and maximum of each span are calculated when first needed,
+ * from the two spans below it, and kept. A range of columns is then
+ * aggregated from at most two spans per level plus the few columns
+ * at either end that do not fill a block, so the cost of a query
+ * hardly depends on the number of columns it covers once the spans
+ * it uses are known.
+ *
+ * Only spans lying entirely within the model's current width are
+ * kept, so a model that is still growing can be indexed as it goes.
+ * When existing columns change, the spans covering them must be
+ * invalidated; spans elsewhere are unaffected.
+ *
+ * The spans are accounted with LayerCacheBudget as a single cache,
+ * and are all discarded if the budget evicts it. They are then
+ * calculated again as queries need them.
+ *
+ * This class is not thread-safe.
+ */
+class SliceColumnIndex : public LayerCacheBudget::Client
+{
+public:
+    SliceColumnIndex();
+    virtual ~SliceColumnIndex();
+
+    SliceColumnIndex(const SliceColumnIndex &) =delete;
+    SliceColumnIndex &operator=(const SliceColumnIndex &) =delete;
+
+    enum Aggregate {
+        Sum,
+        Maximum
+    };
+
+    /**
+     * Discard everything and index the given model (a
+     * DenseThreeDimensionalModel) from now on.
+     */
+    void setModel(ModelId model);
+
+    /**
+     * Discard everything, because the model's columns have changed.
+     */
+    void invalidate();
+
+    /**
+     * Discard the spans that include any of the columns col0 to col1
+     * inclusive, because those columns have changed.
+     */
+    void invalidate(int col0, int col1);
+
+    /**
+     * Fill values with the sum or maximum of each of the nbins bins
+     * starting at bin0, across the columns col0 to col1 inclusive.
+     * Columns outside the model, or empty, are skipped. Maxima are
+     * taken with zero, and any value missing from a short column is
+     * treated as zero. Return the number of columns aggregated.
+     */
+    int aggregate(int col0, int col1, int bin0, int nbins,
+                  Aggregate type, std::vector<float> &values);
+
+    void evictCache(int key) override;
+
+private:
+    struct Span {
+        Span() : count(0) { }
+        std::vector<double> sums;
+        std::vector<float> maxima;
+        int count; // non-empty columns
+    };
+
+    typedef std::pair<int, int> SpanKey; // level, index within level
+
+    ModelId m_model;
+    std::map<SpanKey, Span> m_spans;
+    qint64 m_bytes;
+
+    const Span &getSpan(int level, int index, int height);
+    static qint64 getSpanBytes(const Span &span);
+    void addColumn(const std::vector<float> &column, int bin0, int nbins,
+                   Aggregate type, std::vector<float> &values) const;
+};
+
+} // end namespace sv
+
+#endif
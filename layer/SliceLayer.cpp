@@ -68,11 +68,31 @@ SliceLayer::setSliceableModel(ModelId modelId)
     }
 
     if (m_sliceableModel == modelId) return;
+
+    auto oldModel = ModelById::get(m_sliceableModel);
+    if (oldModel) {
+        disconnect(oldModel.get(), nullptr,
+                   this, SLOT(sliceableModelChanged()));
+        disconnect(oldModel.get(), nullptr,
+                   this, SLOT(sliceableModelChangedWithin
+                              (ModelId, sv_frame_t, sv_frame_t)));
+    }
+    
     m_sliceableModel = modelId;
+    m_columnIndex.setModel(m_sliceableModel);
 
     if (newModel) {
         connectSignals(m_sliceableModel);
 
+        // The column index must be rebuilt where existing columns
+        // change
+        connect(newModel.get(), SIGNAL(modelChanged(ModelId)),
+                this, SLOT(sliceableModelChanged()));
+        connect(newModel.get(),
+                SIGNAL(modelChangedWithin(ModelId, sv_frame_t, sv_frame_t)),
+                this, SLOT(sliceableModelChangedWithin
+                           (ModelId, sv_frame_t, sv_frame_t)));
+
         if (m_minbin == 0 && m_maxbin == 0) {
             m_minbin = 0;
             m_maxbin = newModel->getHeight();
@@ -93,6 +113,31 @@ SliceLayer::sliceableModelReplaced(ModelId orig, ModelId replacement)
     }
 }
 
+void
+SliceLayer::sliceableModelChanged()
+{
+    m_columnIndex.invalidate();
+}
+
+void
+SliceLayer::sliceableModelChangedWithin(ModelId, sv_frame_t startFrame,
+                                        sv_frame_t endFrame)
+{
+    auto sliceableModel =
+        ModelById::getAs<DenseThreeDimensionalModel>(m_sliceableModel);
+    if (!sliceableModel) return;
+
+    int resolution = sliceableModel->getResolution();
+    if (resolution < 1) {
+        m_columnIndex.invalidate();
+        return;
+    }
+
+    int col0 = int(startFrame / resolution);
+    int col1 = int(endFrame / resolution);
+    m_columnIndex.invalidate(col0, col1);
+}
+
 QString
 SliceLayer::getFeatureDescription(LayerGeometryProvider *v, QPoint &p) const
 {
@@ -540,13 +585,6 @@ SliceLayer::paint(LayerGeometryProvider *v, QPainter &paint, QRect rect) const
 
     QPainterPath path;
     
-    int divisor = 0;
-
-    m_values.clear();
-    for (int bin = 0; bin < mh; ++bin) {
-        m_values.push_back(0.0);
-    }
-
     sv_frame_t f0 = v->getCentreFrame();
     int f0x = v->getXForFrame(f0);
     f0 = v->getFrameForX(f0x);
@@ -572,28 +610,17 @@ SliceLayer::paint(LayerGeometryProvider *v, QPainter &paint, QRect rect) const
     getBiasCurve(curve);
     int cs = int(curve.size());
 
-    int modelWidth = sliceableModel->getWidth();
-    
-    for (int col = col0; col <= col1; ++col) {
-        if (col < 0) continue;
-        if (col >= modelWidth) break;
-        DenseThreeDimensionalModel::Column column =
-            sliceableModel->getColumn(col);
-        if (column.size() == 0) continue;
-        for (int bin = 0; bin < mh; ++bin) {
-            float value = column[bin0 + bin];
-            if (bin < cs) value *= curve[bin];
-            if (m_samplingMode == SamplePeak) {
-                if (value > m_values[bin]) m_values[bin] = value;
-            } else {
-                m_values[bin] += value;
-            }
-        }
-        ++divisor;
-    }
+    // The bias curve is a per-bin scale factor, so it can be applied
+    // to the sum or peak across columns rather than to each column
+    int divisor = m_columnIndex.aggregate
+        (col0, col1, bin0, mh,
+         m_samplingMode == SamplePeak ?
+         SliceColumnIndex::Maximum : SliceColumnIndex::Sum,
+         m_values);
 
     float max = 0.0;
     for (int bin = 0; bin < mh; ++bin) {
+        if (bin < cs) m_values[bin] *= curve[bin];
         if (m_samplingMode == SampleMean && divisor > 0) {
             m_values[bin] /= float(divisor);
         }
@@ -24,6 +24,8 @@
 
 #include "data/model/DenseThreeDimensionalModel.h"
 
+#include "SliceColumnIndex.h"
+
 #include <QColor>
 
 namespace sv {
@@ -46,6 +48,7 @@ public:
 
     int getVerticalScaleWidth(LayerGeometryProvider *v, bool, QPainter &) const override;
     void paintVerticalScale(LayerGeometryProvider *v, bool, QPainter &paint, QRect rect) const override;
+    bool isVerticalScaleRetainable() const override { return false; }
 
     ColourSignificance getLayerColourSignificance() const override {
         return ColourAndBackgroundSignificant;
@@ -123,6 +126,10 @@ public:
 public slots:
     void sliceableModelReplaced(ModelId, ModelId);
 
+protected slots:
+    void sliceableModelChanged();
+    void sliceableModelChangedWithin(ModelId, sv_frame_t, sv_frame_t);
+
 protected:
     /// Convert a (possibly non-integral) bin into x-coord. May be overridden
     virtual double getXForBin(const LayerGeometryProvider *, double bin) const;
@@ -201,6 +208,7 @@ protected:
     mutable sv_frame_t          m_currentf0;
     mutable sv_frame_t          m_currentf1;
     mutable std::vector<float>  m_values;
+    mutable SliceColumnIndex    m_columnIndex;
 };
 
 } // end namespace sv
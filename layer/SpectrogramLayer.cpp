@@ -87,7 +87,8 @@ SpectrogramLayer::SpectrogramLayer(Configuration config) :
     m_synchronous(false),
     m_haveDetailedScale(false),
     m_exiting(false),
-    m_peakCacheDivisor(8)
+    m_peakCacheDivisor(8),
+    m_renderers(this, this)
 {
     QString colourConfigName = "spectrogram-colour";
     int colourConfigDefault = int(ColourMapper::Green);
@@ -129,6 +130,9 @@ SpectrogramLayer::SpectrogramLayer(Configuration config) :
     Preferences *prefs = Preferences::getInstance();
     connect(prefs, SIGNAL(propertyChanged(PropertyContainer::PropertyName)),
             this, SLOT(preferenceChanged(PropertyContainer::PropertyName)));
+
+    connect(&m_readouts, SIGNAL(readoutReady()), this, SLOT(readoutReady()));
+    
     setWindowType(prefs->getWindowType());
         
     auto smoothing = prefs->getSpectrogramSmoothing();
@@ -137,6 +141,7 @@ SpectrogramLayer::SpectrogramLayer(Configuration config) :
 
 SpectrogramLayer::~SpectrogramLayer()
 {
+    LayerCacheBudget::getInstance()->removeAll(this);
     invalidateRenderers();
     deleteDerivedModels();
 }
@@ -173,8 +178,8 @@ SpectrogramLayer::getExportModel(LayerGeometryProvider *v) const
         m_normalization != ColumnNormalization::Hybrid) {
         params.scaleFactor *= 2.f / float(getWindowSize());
     }
-    params.threshold = m_threshold; // matching ColourScale in getRenderer
-    params.gain = m_gain; // matching ColourScale in getRenderer
+    params.threshold = m_threshold; // matching ColourScale in getRendererParameters
+    params.gain = m_gain; // matching ColourScale in getRendererParameters
     params.normalization = m_normalization;
     
     ModelId exporter = ModelById::add
@@ -187,8 +192,11 @@ void
 SpectrogramLayer::deleteDerivedModels()
 {
     ModelById::release(m_fftModel);
-    ModelById::release(m_peakCache);
+    m_peakCaches.release();
+    m_peakFrequencies.reset({});
+    m_readouts.setModel(nullptr);
     ModelById::release(m_wholeCache);
+    LayerCacheBudget::getInstance()->remove(this, peakCachesBudgetKey);
 
     for (auto exporterId: m_exporters) {
         if (auto exporter =
@@ -200,7 +208,6 @@ SpectrogramLayer::deleteDerivedModels()
     m_exporters.clear();
     
     m_fftModel = {};
-    m_peakCache = {};
     m_wholeCache = {};
 }
 
@@ -754,13 +761,65 @@ SpectrogramLayer::invalidateRenderers()
     SVDEBUG << "SpectrogramLayer::invalidateRenderers called" << endl;
 #endif
 
-    for (ViewRendererMap::iterator i = m_renderers.begin();
-         i != m_renderers.end(); ++i) {
-        delete i->second;
-    }
     m_renderers.clear();
 }
 
+void
+SpectrogramLayer::updateCacheBudget(LayerGeometryProvider *v) const
+{
+    m_renderers.painted(v);
+
+    qint64 peakBytes = m_peakCaches.getEstimatedMemoryUsage() +
+        m_peakFrequencies.getMemoryUsage();
+    if (auto whole = ModelById::getAs<Dense3DModelPeakCache>(m_wholeCache)) {
+        peakBytes += qint64(whole->getWidth()) * whole->getHeight() *
+            qint64(sizeof(float));
+    }
+    LayerCacheBudget::getInstance()->setUsage
+        (const_cast<SpectrogramLayer *>(this), peakCachesBudgetKey, peakBytes);
+}
+
+void
+SpectrogramLayer::evictCache(int key)
+{
+#ifdef DEBUG_SPECTROGRAM
+    SVDEBUG << "SpectrogramLayer::evictCache(" << key << ")" << endl;
+#endif
+
+    if (key == peakCachesBudgetKey) {
+        // The renderers refer to the caches, so must go too. The peak
+        // caches are recreated when next needed, but the whole-model
+        // cache is not, as it is by far the larger
+        invalidateRenderers();
+        m_peakCaches.release();
+        m_peakFrequencies.invalidate();
+        ModelById::release(m_wholeCache);
+        m_wholeCache = {};
+    } else {
+        m_renderers.evict(key);
+    }
+}
+
+void
+SpectrogramLayer::recolourRenderers()
+{
+#ifdef DEBUG_SPECTROGRAM
+    SVDEBUG << "SpectrogramLayer::recolourRenderers called" << endl;
+#endif
+
+    // Colour-only changes can be applied to the renderers' existing
+    // caches, without going back to the FFT model. Any renderer that
+    // can't do that is discarded, as in invalidateRenderers
+
+    m_renderers.recolour([this](int viewId) {
+                             return getRendererParameters(viewId);
+                         });
+
+    m_crosshairColour =
+        ColourMapper(m_colourMap, m_colourInverted, 1.f, 255.f)
+        .getContrastingColour();
+}
+
 void
 SpectrogramLayer::preferenceChanged(PropertyContainer::PropertyName name)
 {
@@ -890,9 +949,9 @@ SpectrogramLayer::setGain(float gain)
 
     if (m_gain == gain) return;
 
-    invalidateRenderers();
-    
     m_gain = gain;
+
+    recolourRenderers();
     
     emit layerParametersChanged();
 }
@@ -908,10 +967,10 @@ SpectrogramLayer::setThreshold(float threshold)
 {
     if (m_threshold == threshold) return;
 
-    invalidateRenderers();
-    
     m_threshold = threshold;
 
+    recolourRenderers();
+
     emit layerParametersChanged();
 }
 
@@ -982,11 +1041,9 @@ SpectrogramLayer::setColourRotation(int r)
         m_colourRotation = r;
     }
 
-    // Initially the idea with colour rotation was that we would just
-    // rotate the palette of an already-generated cache. That's not
-    // really practical now that cacheing is handled in a separate
-    // class in which the main cache no longer has a palette.
-    invalidateRenderers();
+    // The renderers retain the values behind their cached images,
+    // so can remap them with the rotated palette
+    recolourRenderers();
     
     emit layerParametersChanged();
 }
@@ -996,9 +1053,11 @@ SpectrogramLayer::setColourScale(ColourScaleType colourScale)
 {
     if (m_colourScale == colourScale) return;
 
-    invalidateRenderers();
-    
     m_colourScale = colourScale;
+
+    // (This discards the renderers when switching to or from the
+    // phase scale, which reads different data)
+    recolourRenderers();
     
     emit layerParametersChanged();
 }
@@ -1014,9 +1073,9 @@ SpectrogramLayer::setColourScaleMultiple(double multiple)
 {
     if (m_colourScaleMultiple == multiple) return;
 
-    invalidateRenderers();
-    
     m_colourScaleMultiple = multiple;
+
+    recolourRenderers();
     
     emit layerParametersChanged();
 }
@@ -1032,10 +1091,10 @@ SpectrogramLayer::setColourMap(int map)
 {
     if (m_colourMap == map) return;
 
-    invalidateRenderers();
-    
     m_colourMap = map;
 
+    recolourRenderers();
+
     emit layerParametersChanged();
 }
 
@@ -1148,6 +1207,12 @@ SpectrogramLayer::isLayerScrollable(const LayerGeometryProvider *) const
     return false;
 }
 
+void
+SpectrogramLayer::fftModelCompletionChanged(ModelId)
+{
+    emit modelCompletionChanged(m_model);
+}
+
 void
 SpectrogramLayer::cacheInvalid(ModelId)
 {
@@ -1155,6 +1220,9 @@ SpectrogramLayer::cacheInvalid(ModelId)
     SVDEBUG << "SpectrogramLayer::cacheInvalid()" << endl;
 #endif
 
+    m_peakCaches.resetUpperLevels();
+    m_peakFrequencies.invalidate();
+    m_readouts.invalidate();
     invalidateRenderers();
     invalidateMagnitudes();
 }
@@ -1179,6 +1247,9 @@ SpectrogramLayer::cacheInvalid(
     // pulling out the image cache code, but it might not matter very
     // much, since the underlying models for spectrogram layers don't
     // change very often. Let's see.
+    m_peakCaches.resetUpperLevels();
+    m_peakFrequencies.invalidate();
+    m_readouts.invalidate();
     invalidateRenderers();
     invalidateMagnitudes();
 }
@@ -1347,9 +1418,8 @@ const
 }
 
 bool
-SpectrogramLayer::getAdjustedYBinSourceRange(LayerGeometryProvider *v, int x, int y,
-                                             double &freqMin, double &freqMax,
-                                             double &adjFreqMin, double &adjFreqMax)
+SpectrogramLayer::getXYBinSourceRegion(LayerGeometryProvider *v, int x, int y,
+                                       SpectrogramReadoutCache::Region &region)
 const
 {
     auto model = ModelById::getAs<DenseTimeValueModel>(m_model);
@@ -1357,126 +1427,25 @@ const
         return false;
     }
 
-    auto fft = ModelById::getAs<FFTModel>(m_fftModel);
-    if (!fft) return false;
-
-    double s0 = 0, s1 = 0;
-    if (!getXBinRange(v, x, s0, s1)) return false;
-
-    double q0 = 0, q1 = 0;
-    if (!getYBinRange(v, y, q0, q1)) return false;
-
-    int s0i = int(s0 + 0.001);
-    int s1i = int(s1);
-
-    int q0i = int(q0 + 0.001);
-    int q1i = int(q1);
-
-    sv_samplerate_t sr = model->getSampleRate();
-
-    bool haveAdj = false;
-
-    bool peaksOnly = (m_binDisplay == BinDisplay::PeakBins ||
-                      m_binDisplay == BinDisplay::PeakFrequencies);
-
-    for (int q = q0i; q <= q1i; ++q) {
-
-        for (int s = s0i; s <= s1i; ++s) {
-
-            double binfreq = (double(sr) * q) / getFFTSize();
-            if (q == q0i) freqMin = binfreq;
-            if (q == q1i) freqMax = binfreq;
-
-            if (peaksOnly && !fft->isLocalPeak(s, q)) continue;
-
-            if (!fft->isOverThreshold
-                (s, q, float(m_threshold * double(getFFTSize())/2.0))) {
-                continue;
-            }
-
-            double freq = binfreq;
-            
-            if (s < int(fft->getWidth()) - 1) {
-
-                fft->estimateStableFrequency(s, q, freq);
-            
-                if (!haveAdj || freq < adjFreqMin) adjFreqMin = freq;
-                if (!haveAdj || freq > adjFreqMax) adjFreqMax = freq;
-
-                haveAdj = true;
-            }
-        }
-    }
-
-    if (!haveAdj) {
-        adjFreqMin = adjFreqMax = 0.0;
-    }
-
-    return haveAdj;
-}
-    
-bool
-SpectrogramLayer::getXYBinSourceRange(LayerGeometryProvider *v, int x, int y,
-                                      double &min, double &max,
-                                      double &phaseMin, double &phaseMax) const
-{
-    auto model = ModelById::getAs<DenseTimeValueModel>(m_model);
-    if (!model || !model->isOK() || !model->isReady()) {
-        return false;
-    }
-
     double q0 = 0, q1 = 0;
     if (!getYBinRange(v, y, q0, q1)) return false;
 
     double s0 = 0, s1 = 0;
     if (!getXBinRange(v, x, s0, s1)) return false;
     
-    int q0i = int(q0 + 0.001);
-    int q1i = int(q1);
-
-    int s0i = int(s0 + 0.001);
-    int s1i = int(s1);
-
-    bool rv = false;
-
-    auto fft = ModelById::getAs<FFTModel>(m_fftModel);
-
-    if (fft) {
-
-        int cw = fft->getWidth();
-        int ch = fft->getHeight();
-
-        min = 0.0;
-        max = 0.0;
-        phaseMin = 0.0;
-        phaseMax = 0.0;
-        bool have = false;
-
-        for (int q = q0i; q <= q1i; ++q) {
-            for (int s = s0i; s <= s1i; ++s) {
-                if (s >= 0 && q >= 0 && s < cw && q < ch) {
-
-                    double value;
+    region.q0 = int(q0 + 0.001);
+    region.q1 = int(q1);
 
-                    value = fft->getPhaseAt(s, q);
-                    if (!have || value < phaseMin) { phaseMin = value; }
-                    if (!have || value > phaseMax) { phaseMax = value; }
+    region.s0 = int(s0 + 0.001);
+    region.s1 = int(s1);
 
-                    value = fft->getMagnitudeAt(s, q) / (getFFTSize()/2.0);
-                    if (!have || value < min) { min = value; }
-                    if (!have || value > max) { max = value; }
-                    
-                    have = true;
-                }       
-            }
-        }
-        
-        if (have) {
-            rv = true;
-        }
+    region.adjusted = (m_binDisplay == BinDisplay::PeakFrequencies);
+    if (region.adjusted) {
+        region.peaksOnly = true;
+        region.threshold = float(m_threshold * double(getFFTSize())/2.0);
     }
 
-    return rv;
+    return true;
 }
         
 void
@@ -1515,24 +1484,39 @@ SpectrogramLayer::recreateFFTModel()
     
     m_fftModel = ModelById::add(newFFTModel);
 
+    // Our completion is that of the FFT model, so pass its progress
+    // on as if it were our own model's
+    connect(newFFTModel.get(), SIGNAL(completionChanged(ModelId)),
+            this, SLOT(fftModelCompletionChanged(ModelId)));
+
     bool createWholeCache = false;
     checkCacheSpace(&m_peakCacheDivisor, &createWholeCache);
     
     if (createWholeCache) {
-
         auto whole = std::make_shared<Dense3DModelPeakCache>(m_fftModel, 1);
         m_wholeCache = ModelById::add(whole);
+    }
 
-        auto peaks = std::make_shared<Dense3DModelPeakCache>(m_fftModel,
-                                                             m_peakCacheDivisor);
-        m_peakCache = ModelById::add(peaks);
+    // The renderer picks the coarsest of these that is still finer
+    // than a pixel at the current zoom, so when zoomed a long way out
+    // it can read a handful of columns from a high level rather than
+    // thousands from the first
+    m_peakCaches.create(m_fftModel, m_peakCacheDivisor);
 
-    } else {
+    m_peakFrequencies.reset(m_fftModel);
 
-        auto peaks = std::make_shared<Dense3DModelPeakCache>(m_fftModel,
-                                                             m_peakCacheDivisor);
-        m_peakCache = ModelById::add(peaks);
+    // The readout cache reads on a worker thread, so it gets an FFT
+    // model of its own rather than sharing the one we render from
+    auto readoutModel = std::make_shared<FFTModel>(m_model,
+                                                   m_channel,
+                                                   m_windowType,
+                                                   m_windowSize,
+                                                   getWindowIncrement(),
+                                                   getFFTSize());
+    if (m_verticallyFixed) {
+        readoutModel->setMaximumFrequency(getMaxFrequency());
     }
+    m_readouts.setModel(readoutModel);
 }
 
 void
@@ -1565,6 +1549,9 @@ SpectrogramLayer::checkCacheSpace(int *suggestedPeakDivisor,
              (sz / 8) / 1024, sz / 1024);
         if (recommendation & StorageAdviser::UseDisc) {
             SVDEBUG << "Seems inadvisable to create whole-model cache" << endl;
+        } else if (qint64(sz) >
+                   LayerCacheBudget::getInstance()->getAvailable()) {
+            SVDEBUG << "Whole-model cache would not fit within layer cache budget" << endl;
         } else if (recommendation & StorageAdviser::ConserveSpace) {
             SVDEBUG << "Seems inadvisable to create whole-model cache but acceptable to use the slightly higher-resolution peak cache" << endl;
             *suggestedPeakDivisor = 4;
@@ -1598,79 +1585,96 @@ SpectrogramLayer::setSynchronousPainting(bool synchronous)
     m_synchronous = synchronous;
 }
 
+Colour3DPlotRenderer::Parameters
+SpectrogramLayer::getRendererParameters(int viewId) const
+{
+    ColourScale::Parameters cparams;
+    cparams.colourMap = m_colourMap;
+    cparams.scaleType = m_colourScale;
+    cparams.multiple = m_colourScaleMultiple;
+
+    if (m_colourScale != ColourScaleType::Phase) {
+        cparams.gain = m_gain;
+        cparams.threshold = m_threshold;
+    }
+
+    double minValue = 0.0f;
+    double maxValue = 1.0f;
+        
+    if (m_normalizeVisibleArea && m_viewMags[viewId].isSet()) {
+        minValue = m_viewMags[viewId].getMin();
+        maxValue = m_viewMags[viewId].getMax();
+    } else if (m_colourScale == ColourScaleType::Linear &&
+               m_normalization == ColumnNormalization::None) {
+        maxValue = 0.1f;
+    }
+
+    if (maxValue <= minValue) {
+        maxValue = minValue + 0.1f;
+    }
+    if (maxValue <= m_threshold) {
+        maxValue = m_threshold + 0.1f;
+    }
+
+    cparams.minValue = minValue;
+    cparams.maxValue = maxValue;
+
+    m_lastRenderedMags[viewId] = MagnitudeRange(float(minValue),
+                                                float(maxValue));
+
+    Colour3DPlotRenderer::Parameters params;
+    params.colourScale = ColourScale(cparams);
+    params.normalization = m_normalization;
+    params.binDisplay = m_binDisplay;
+    params.binScale = m_binScale;
+    params.alwaysOpaque = true;
+    params.invertVertical = false;
+    params.scaleFactor = 1.0;
+    params.colourRotation = m_colourRotation;
+
+    if (m_colourScale != ColourScaleType::Phase &&
+        m_normalization != ColumnNormalization::Hybrid) {
+        params.scaleFactor *= 2.f / float(getWindowSize());
+    }
+
+    params.interpolate = m_smooth;
+
+    return params;
+}
+
 Colour3DPlotRenderer *
 SpectrogramLayer::getRenderer(LayerGeometryProvider *v) const
 {
     int viewId = v->getId();
+
+    // Views with identical geometry can share a renderer and its
+    // cache, unless the colour mapping depends on the view's own
+    // visible area
+    bool share = !m_normalizeVisibleArea;
     
-    if (m_renderers.find(viewId) == m_renderers.end()) {
+    return m_renderers.getRenderer(v, share, [this, viewId]() {
 
+        if (m_peakCaches.isEmpty()) {
+            m_peakCaches.create(m_fftModel, m_peakCacheDivisor);
+        }
+        
         Colour3DPlotRenderer::Sources sources;
         sources.verticalBinLayer = this;
         sources.fft = m_fftModel;
         sources.source = sources.fft;
-        if (!m_peakCache.isNone()) sources.peakCaches.push_back(m_peakCache);
-        if (!m_wholeCache.isNone()) sources.peakCaches.push_back(m_wholeCache);
-
-        ColourScale::Parameters cparams;
-        cparams.colourMap = m_colourMap;
-        cparams.scaleType = m_colourScale;
-        cparams.multiple = m_colourScaleMultiple;
-
-        if (m_colourScale != ColourScaleType::Phase) {
-            cparams.gain = m_gain;
-            cparams.threshold = m_threshold;
-        }
-
-        double minValue = 0.0f;
-        double maxValue = 1.0f;
-        
-        if (m_normalizeVisibleArea && m_viewMags[viewId].isSet()) {
-            minValue = m_viewMags[viewId].getMin();
-            maxValue = m_viewMags[viewId].getMax();
-        } else if (m_colourScale == ColourScaleType::Linear &&
-                   m_normalization == ColumnNormalization::None) {
-            maxValue = 0.1f;
-        }
-
-        if (maxValue <= minValue) {
-            maxValue = minValue + 0.1f;
+        for (auto id: m_peakCaches.getLevels()) {
+            sources.peakCaches.push_back(id);
         }
-        if (maxValue <= m_threshold) {
-            maxValue = m_threshold + 0.1f;
-        }
-
-        cparams.minValue = minValue;
-        cparams.maxValue = maxValue;
-
-        m_lastRenderedMags[viewId] = MagnitudeRange(float(minValue),
-                                                    float(maxValue));
-
-        Colour3DPlotRenderer::Parameters params;
-        params.colourScale = ColourScale(cparams);
-        params.normalization = m_normalization;
-        params.binDisplay = m_binDisplay;
-        params.binScale = m_binScale;
-        params.alwaysOpaque = true;
-        params.invertVertical = false;
-        params.scaleFactor = 1.0;
-        params.colourRotation = m_colourRotation;
-
-        if (m_colourScale != ColourScaleType::Phase &&
-            m_normalization != ColumnNormalization::Hybrid) {
-            params.scaleFactor *= 2.f / float(getWindowSize());
-        }
-
-        params.interpolate = m_smooth;
-
-        m_renderers[viewId] = new Colour3DPlotRenderer(sources, params);
+        if (!m_wholeCache.isNone()) sources.peakCaches.push_back(m_wholeCache);
+        sources.peakFrequencies = &m_peakFrequencies;
 
         m_crosshairColour =
             ColourMapper(m_colourMap, m_colourInverted, 1.f, 255.f)
             .getContrastingColour();
-    }
 
-    return m_renderers[viewId];
+        return new Colour3DPlotRenderer
+            (sources, getRendererParameters(viewId));
+    });
 }
 
 void
@@ -1723,13 +1727,27 @@ SpectrogramLayer::paintWithRenderer(LayerGeometryProvider *v, QPainter &paint, Q
     if (!continuingPaint && m_normalizeVisibleArea &&
         m_viewMags[viewId] != m_lastRenderedMags[viewId]) {
 #ifdef DEBUG_SPECTROGRAM_REPAINT
-        SVDEBUG << "mag range has changed from last rendered range: re-rendering"
+        SVDEBUG << "mag range has changed from last rendered range: recolouring"
              << endl;
 #endif
-        delete m_renderers[viewId];
-        m_renderers.erase(viewId);
-        v->updatePaintRect(v->getPaintRect());
+        // Only the colour mapping depends on the range, so we can
+        // remap what has already been rendered instead of discarding
+        // it and rendering the whole view again. Anything we need to
+        // paint again is then served from the renderer's cache
+        if (renderer->recolour(getRendererParameters(viewId))) {
+            if (!result.rendered.isEmpty()) {
+                renderer->render(v, paint, result.rendered);
+            }
+            if (result.rendered != v->getPaintRect()) {
+                v->updatePaintRect(v->getPaintRect());
+            }
+        } else {
+            m_renderers.discard(viewId);
+            v->updatePaintRect(v->getPaintRect());
+        }
     }
+
+    updateCacheBudget(v);
 }
 
 void
@@ -2079,46 +2097,60 @@ SpectrogramLayer::getFeatureDescription(LayerGeometryProvider *v, QPoint &pos) c
     auto model = ModelById::getAs<DenseTimeValueModel>(m_model);
     if (!model || !model->isOK()) return "";
 
-    double magMin = 0, magMax = 0;
-    double phaseMin = 0, phaseMax = 0;
     double freqMin = 0, freqMax = 0;
-    double adjFreqMin = 0, adjFreqMax = 0;
     QString pitchMin, pitchMax;
     RealTime rtMin, rtMax;
 
-    bool haveValues = false;
-
     if (!getXBinSourceRange(v, x, rtMin, rtMax)) {
         return "";
     }
-    if (getXYBinSourceRange(v, x, y, magMin, magMax, phaseMin, phaseMax)) {
-        haveValues = true;
-    }
+
+    // The values read from the FFT model come from a cache filled in
+    // the background, so as not to hold up the pointer. If they are
+    // not ready yet, we describe what we can and are asked to update
+    // once they are
+
+    SpectrogramReadoutCache::Region region;
+    SpectrogramReadoutCache::Readout readout;
+    bool haveRegion = getXYBinSourceRegion(v, x, y, region);
+    bool haveReadout = haveRegion && m_readouts.getReadout(region, readout);
+    bool haveValues = haveReadout && readout.haveValues;
 
     QString adjFreqText = "", adjPitchText = "";
 
     if (m_binDisplay == BinDisplay::PeakFrequencies) {
 
-        if (!getAdjustedYBinSourceRange(v, x, y, freqMin, freqMax,
-                                        adjFreqMin, adjFreqMax)) {
-            return "";
-        }
+        if (!haveRegion) return "";
 
-        if (adjFreqMin != adjFreqMax) {
-            adjFreqText = tr("Peak Frequency:\t%1 - %2 Hz\n")
-                .arg(adjFreqMin).arg(adjFreqMax);
-        } else {
-            adjFreqText = tr("Peak Frequency:\t%1 Hz\n")
-                .arg(adjFreqMin);
-        }
+        sv_samplerate_t sr = model->getSampleRate();
+        freqMin = (double(sr) * region.q0) / getFFTSize();
+        freqMax = (double(sr) * region.q1) / getFFTSize();
 
-        QString pmin = Pitch::getPitchLabelForFrequency(adjFreqMin);
-        QString pmax = Pitch::getPitchLabelForFrequency(adjFreqMax);
+        if (haveReadout) {
 
-        if (pmin != pmax) {
-            adjPitchText = tr("Peak Pitch:\t%3 - %4\n").arg(pmin).arg(pmax);
-        } else {
-            adjPitchText = tr("Peak Pitch:\t%2\n").arg(pmin);
+            if (!readout.haveAdjusted) {
+                return "";
+            }
+
+            double adjFreqMin = readout.adjFreqMin;
+            double adjFreqMax = readout.adjFreqMax;
+            
+            if (adjFreqMin != adjFreqMax) {
+                adjFreqText = tr("Peak Frequency:\t%1 - %2 Hz\n")
+                    .arg(adjFreqMin).arg(adjFreqMax);
+            } else {
+                adjFreqText = tr("Peak Frequency:\t%1 Hz\n")
+                    .arg(adjFreqMin);
+            }
+
+            QString pmin = Pitch::getPitchLabelForFrequency(adjFreqMin);
+            QString pmax = Pitch::getPitchLabelForFrequency(adjFreqMax);
+
+            if (pmin != pmax) {
+                adjPitchText = tr("Peak Pitch:\t%3 - %4\n").arg(pmin).arg(pmax);
+            } else {
+                adjPitchText = tr("Peak Pitch:\t%2\n").arg(pmin);
+            }
         }
 
     } else {
@@ -2154,8 +2186,8 @@ SpectrogramLayer::getFeatureDescription(LayerGeometryProvider *v, QPoint &pos) c
     }   
 
     if (haveValues) {
-        double dbMin = AudioLevel::voltage_to_dB(magMin);
-        double dbMax = AudioLevel::voltage_to_dB(magMax);
+        double dbMin = AudioLevel::voltage_to_dB(readout.magMin);
+        double dbMax = AudioLevel::voltage_to_dB(readout.magMax);
         QString dbMinString;
         QString dbMaxString;
         if (dbMin == AudioLevel::DB_FLOOR) {
@@ -2173,16 +2205,23 @@ SpectrogramLayer::getFeatureDescription(LayerGeometryProvider *v, QPoint &pos) c
         } else {
             text += tr("dB:\t%1").arg(dbMinString);
         }
-        if (phaseMin != phaseMax) {
-            text += tr("\nPhase:\t%1 - %2").arg(phaseMin).arg(phaseMax);
+        if (readout.phaseMin != readout.phaseMax) {
+            text += tr("\nPhase:\t%1 - %2")
+                .arg(readout.phaseMin).arg(readout.phaseMax);
         } else {
-            text += tr("\nPhase:\t%1").arg(phaseMin);
+            text += tr("\nPhase:\t%1").arg(readout.phaseMin);
         }
     }
 
     return text;
 }
 
+void
+SpectrogramLayer::readoutReady()
+{
+    emit layerFeatureDescriptionChanged();
+}
+
 int
 SpectrogramLayer::getColourScaleWidth(QPainter &paint) const
 {
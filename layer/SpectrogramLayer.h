@@ -29,6 +29,11 @@
 #include "VerticalBinLayer.h"
 #include "ColourScale.h"
 #include "Colour3DPlotRenderer.h"
+#include "PeakCachePyramid.h"
+#include "PeakFrequencyCache.h"
+#include "SpectrogramReadoutCache.h"
+#include "LayerCacheBudget.h"
+#include "Colour3DPlotRendererPool.h"
 
 #include <QMutex>
 #include <QWaitCondition>
@@ -52,7 +57,8 @@ class Dense3DModelPeakCache;
  */
 
 class SpectrogramLayer : public VerticalBinLayer,
-                         public PowerOfSqrtTwoZoomConstraint
+                         public PowerOfSqrtTwoZoomConstraint,
+                         public LayerCacheBudget::Client
 {
     Q_OBJECT
 
@@ -263,12 +269,18 @@ public:
 
     ModelId getSliceableModel() const override;
 
+    void evictCache(int key) override;
+
 protected slots:
     void cacheInvalid(ModelId);
     void cacheInvalid(ModelId, sv_frame_t startFrame, sv_frame_t endFrame);
     
     void preferenceChanged(PropertyContainer::PropertyName name);
 
+    void readoutReady();
+
+    void fftModelCompletionChanged(ModelId);
+
 protected:
     ModelId m_model; // a DenseTimeValueModel
 
@@ -320,12 +332,9 @@ protected:
     bool getYBinRange(LayerGeometryProvider *v, int y, double &freqBinMin, double &freqBinMax) const;
 
     bool getYBinSourceRange(LayerGeometryProvider *v, int y, double &freqMin, double &freqMax) const;
-    bool getAdjustedYBinSourceRange(LayerGeometryProvider *v, int x, int y,
-                                    double &freqMin, double &freqMax,
-                                    double &adjFreqMin, double &adjFreqMax) const;
     bool getXBinSourceRange(LayerGeometryProvider *v, int x, RealTime &timeMin, RealTime &timeMax) const;
-    bool getXYBinSourceRange(LayerGeometryProvider *v, int x, int y, double &min, double &max,
-                             double &phaseMin, double &phaseMax) const;
+    bool getXYBinSourceRegion(LayerGeometryProvider *v, int x, int y,
+                              SpectrogramReadoutCache::Region &region) const;
 
     int getWindowIncrement() const {
         if (m_windowHopLevel == 0) return m_windowSize;
@@ -339,7 +348,9 @@ protected:
     // models and caches with ModelById
     ModelId m_fftModel; // an FFTModel
     ModelId m_wholeCache; // a Dense3DModelPeakCache
-    ModelId m_peakCache; // a Dense3DModelPeakCache
+    mutable PeakCachePyramid m_peakCaches; // recreated lazily if evicted
+    mutable PeakFrequencyCache m_peakFrequencies; // shared by renderers
+    mutable SpectrogramReadoutCache m_readouts; // for feature description
     int m_peakCacheDivisor;
     
     mutable std::vector<ModelId> m_exporters; // used, waiting to be released
@@ -353,10 +364,16 @@ protected:
     mutable ViewMagMap m_lastRenderedMags; // when in normalizeVisibleArea mode
     void invalidateMagnitudes();
 
-    typedef std::map<int, Colour3DPlotRenderer *> ViewRendererMap; // key is view id
-    mutable ViewRendererMap m_renderers;
+    mutable Colour3DPlotRendererPool m_renderers;
     Colour3DPlotRenderer *getRenderer(LayerGeometryProvider *) const;
+    Colour3DPlotRenderer::Parameters getRendererParameters(int viewId) const;
     void invalidateRenderers();
+    void recolourRenderers();
+
+    // Renderers are accounted with LayerCacheBudget by the pool, and
+    // the peak and whole-model caches together under this key
+    void updateCacheBudget(LayerGeometryProvider *v) const;
+    static const int peakCachesBudgetKey = -1;
 
     void deleteDerivedModels();
     
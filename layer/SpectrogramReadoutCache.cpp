@@ -0,0 +1,242 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+    Sonic Visualiser
+    An audio file viewer and annotation editor.
+    Centre for Digital Music, Queen Mary, University of London.
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation; either version 2 of the
+    License, or (at your option) any later version.  See the file
+    COPYING included with this distribution for more information.
+*/
+
+#include "SpectrogramReadoutCache.h"
+
+#include "data/model/FFTModel.h"
+
+#include "base/Debug.h"
+#include "base/Profiler.h"
+
+#include <QMutexLocker>
+#include <QRunnable>
+
+//#define DEBUG_SPECTROGRAM_READOUT_CACHE 1
+
+namespace sv {
+
+// The readouts are small, but there is no point in keeping more than
+// a pointer's sweep across a few views
+static const size_t maxReadouts = 4096;
+
+class SpectrogramReadoutCache::Job : public QRunnable
+{
+public:
+    Job(SpectrogramReadoutCache *cache) : m_cache(cache) { }
+
+    void run() override {
+        m_cache->run();
+    }
+
+private:
+    SpectrogramReadoutCache *m_cache;
+};
+
+SpectrogramReadoutCache::SpectrogramReadoutCache() :
+    m_generation(0),
+    m_haveWanted(false),
+    m_running(false)
+{
+    m_pool.setMaxThreadCount(1);
+}
+
+SpectrogramReadoutCache::~SpectrogramReadoutCache()
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        m_haveWanted = false;
+    }
+    m_pool.clear();
+    m_pool.waitForDone();
+}
+
+void
+SpectrogramReadoutCache::setModel(std::shared_ptr<FFTModel> fftModel)
+{
+    // Let any calculation in progress finish with the old model, so
+    // that it is never released (or replaced) while in use by the
+    // worker
+    {
+        QMutexLocker locker(&m_mutex);
+        m_haveWanted = false;
+    }
+    m_pool.waitForDone();
+    
+    QMutexLocker locker(&m_mutex);
+    m_fftModel = fftModel;
+    m_readouts.clear();
+    m_haveWanted = false;
+    ++m_generation;
+}
+
+void
+SpectrogramReadoutCache::invalidate()
+{
+    QMutexLocker locker(&m_mutex);
+    m_readouts.clear();
+    m_haveWanted = false;
+    ++m_generation;
+}
+
+bool
+SpectrogramReadoutCache::getReadout(const Region &region, Readout &readout)
+{
+    QMutexLocker locker(&m_mutex);
+
+    auto itr = m_readouts.find(region);
+    if (itr != m_readouts.end()) {
+        readout = itr->second;
+        return true;
+    }
+
+    if (!m_fftModel) {
+        return false;
+    }
+    
+    m_wanted = region;
+    m_haveWanted = true;
+    
+    if (!m_running) {
+        m_running = true;
+        m_pool.start(new Job(this));
+    }
+
+    return false;
+}
+
+void
+SpectrogramReadoutCache::run()
+{
+    bool done = false;
+    
+    while (true) {
+
+        Region region;
+        std::shared_ptr<FFTModel> fftModel;
+        int generation;
+        
+        {
+            QMutexLocker locker(&m_mutex);
+            if (!m_haveWanted) {
+                m_running = false;
+                break;
+            }
+            region = m_wanted;
+            fftModel = m_fftModel;
+            generation = m_generation;
+            m_haveWanted = false;
+        }
+
+        Readout readout = calculate(fftModel, region);
+
+        QMutexLocker locker(&m_mutex);
+        if (generation == m_generation) {
+            if (m_readouts.size() >= maxReadouts) {
+                m_readouts.clear();
+            }
+            m_readouts[region] = readout;
+            done = true;
+        }
+    }
+
+    if (done) {
+        // Queued to the GUI thread, as we live there
+        emit readoutReady();
+    }
+}
+
+SpectrogramReadoutCache::Readout
+SpectrogramReadoutCache::calculate(std::shared_ptr<FFTModel> fft,
+                                   const Region &region)
+{
+    Profiler profiler("SpectrogramReadoutCache::calculate");
+    
+    Readout readout;
+    
+    if (!fft) return readout;
+
+    int cw = fft->getWidth();
+    int ch = fft->getHeight();
+    int fftSize = fft->getFFTSize();
+    sv_samplerate_t sr = fft->getSampleRate();
+
+    for (int q = region.q0; q <= region.q1; ++q) {
+        for (int s = region.s0; s <= region.s1; ++s) {
+            if (s >= 0 && q >= 0 && s < cw && q < ch) {
+
+                double value;
+
+                value = fft->getPhaseAt(s, q);
+                if (!readout.haveValues || value < readout.phaseMin) {
+                    readout.phaseMin = value;
+                }
+                if (!readout.haveValues || value > readout.phaseMax) {
+                    readout.phaseMax = value;
+                }
+
+                value = fft->getMagnitudeAt(s, q) / (fftSize/2.0);
+                if (!readout.haveValues || value < readout.magMin) {
+                    readout.magMin = value;
+                }
+                if (!readout.haveValues || value > readout.magMax) {
+                    readout.magMax = value;
+                }
+                    
+                readout.haveValues = true;
+            }       
+        }
+    }
+
+    if (!region.adjusted) {
+        return readout;
+    }
+
+    for (int q = region.q0; q <= region.q1; ++q) {
+        for (int s = region.s0; s <= region.s1; ++s) {
+
+            if (region.peaksOnly && !fft->isLocalPeak(s, q)) continue;
+
+            if (!fft->isOverThreshold(s, q, region.threshold)) {
+                continue;
+            }
+
+            double freq = (double(sr) * q) / fftSize;
+            
+            if (s < cw - 1) {
+
+                fft->estimateStableFrequency(s, q, freq);
+
+                if (!readout.haveAdjusted || freq < readout.adjFreqMin) {
+                    readout.adjFreqMin = freq;
+                }
+                if (!readout.haveAdjusted || freq > readout.adjFreqMax) {
+                    readout.adjFreqMax = freq;
+                }
+
+                readout.haveAdjusted = true;
+            }
+        }
+    }
+
+#ifdef DEBUG_SPECTROGRAM_READOUT_CACHE
+    SVDEBUG << "SpectrogramReadoutCache::calculate: columns " << region.s0
+            << "-" << region.s1 << ", bins " << region.q0 << "-" << region.q1
+            << ": have values = " << readout.haveValues
+            << ", have adjusted = " << readout.haveAdjusted << endl;
+#endif
+    
+    return readout;
+}
+
+} // end namespace sv
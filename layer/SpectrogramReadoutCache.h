@@ -0,0 +1,142 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+    Sonic Visualiser
+    An audio file viewer and annotation editor.
+    Centre for Digital Music, Queen Mary, University of London.
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation; either version 2 of the
+    License, or (at your option) any later version.  See the file
+    COPYING included with this distribution for more information.
+*/
+
+#ifndef SV_SPECTROGRAM_READOUT_CACHE_H
+#define SV_SPECTROGRAM_READOUT_CACHE_H
+
+#include "data/model/Model.h"
+
+#include <QObject>
+#include <QMutex>
+#include <QThreadPool>
+
+#include <map>
+#include <memory>
+#include <tuple>
+
+namespace sv {
+
+class FFTModel;
+
+/**
+ * Values read from an FFTModel for the spectrogram's feature
+ * description (the readout shown next to the crosshairs): the
+ * magnitude and phase ranges within a rectangle of bins and,
+ * optionally, the range of estimated peak frequencies within it.
+ *
+ * Reading these can be slow for a large rectangle, or when the FFT
+ * columns have to be calculated, so they are read on a worker thread
+ * and kept, keyed by the bin rectangle - so any view geometry mapping
+ * the pointer to the same bins shares them. A caller asking for a
+ * readout that is not yet available gets false back and is notified
+ * with readoutReady once it is. Only the most recently requested
+ * readout is waited for: if the pointer moves on before the worker
+ * gets to a request, that request is dropped.
+ *
+ * FFTModel makes no promise that its column and peak accessors may
+ * be used from more than one thread at once, so the worker does not
+ * read the FFTModel that the layer renders from. The cache is given
+ * an FFTModel of its own, made with the same parameters, which only
+ * the worker reads (setModel waits for the worker to finish before
+ * replacing it). The only thing the worker shares with the GUI
+ * thread is the source audio model, which is already read from other
+ * threads during playback.
+ *
+ * Must be called from the GUI thread only.
+ */
+class SpectrogramReadoutCache : public QObject
+{
+    Q_OBJECT
+
+public:
+    SpectrogramReadoutCache();
+    virtual ~SpectrogramReadoutCache();
+
+    struct Region {
+        Region() : s0(0), s1(0), q0(0), q1(0),
+                   adjusted(false), peaksOnly(false), threshold(0.f) { }
+        int s0, s1; // columns, inclusive
+        int q0, q1; // bins, inclusive
+        bool adjusted; // estimate peak frequencies as well
+        bool peaksOnly; // when adjusted, only at local peak bins
+        float threshold; // when adjusted, minimum magnitude
+        bool operator<(const Region &r) const {
+            return std::tie(s0, s1, q0, q1, adjusted, peaksOnly, threshold) <
+                std::tie(r.s0, r.s1, r.q0, r.q1,
+                         r.adjusted, r.peaksOnly, r.threshold);
+        }
+        bool operator==(const Region &r) const {
+            return !(*this < r) && !(r < *this);
+        }
+    };
+
+    struct Readout {
+        Readout() : haveValues(false),
+                    magMin(0), magMax(0), phaseMin(0), phaseMax(0),
+                    haveAdjusted(false), adjFreqMin(0), adjFreqMax(0) { }
+        bool haveValues;
+        double magMin, magMax; // scaled to 0-1
+        double phaseMin, phaseMax;
+        bool haveAdjusted;
+        double adjFreqMin, adjFreqMax;
+    };
+
+    /**
+     * Discard all readouts and read from the given FFTModel from now
+     * on, or from nothing if it is null. The model must not be used
+     * by anything else, as it will be read from the worker thread.
+     * It should be constructed with the same parameters as the model
+     * being displayed, so that bins and columns correspond.
+     */
+    void setModel(std::shared_ptr<FFTModel> fftModel);
+
+    /**
+     * Discard all readouts, because the model has changed.
+     */
+    void invalidate();
+
+    /**
+     * Look up the readout for the given region. If it is known,
+     * return it in readout and return true; otherwise schedule it to
+     * be read and return false.
+     */
+    bool getReadout(const Region &region, Readout &readout);
+
+signals:
+    /**
+     * Emitted when a readout requested earlier has become available.
+     */
+    void readoutReady();
+
+protected:
+    class Job;
+    friend class Job;
+
+    void run();
+    static Readout calculate(std::shared_ptr<FFTModel> fft,
+                             const Region &region);
+
+    mutable QMutex m_mutex;
+    std::shared_ptr<FFTModel> m_fftModel;
+    int m_generation;
+    std::map<Region, Readout> m_readouts;
+    Region m_wanted;
+    bool m_haveWanted;
+    bool m_running;
+    QThreadPool m_pool;
+};
+
+} // end namespace sv
+
+#endif
@@ -129,6 +129,13 @@ TextLayer::getLocalPoints(LayerGeometryProvider *v, int x, int y) const
     auto model = ModelById::getAs<TextModel>(m_model);
     if (!model) return {};
 
+    // The boxes drawn in the last paint are the quickest answer, if
+    // they cover this point
+    FeatureHitCache::HitVector hits;
+    if (getHitCache(v).getHitsAt(v, QPoint(x, y), 0, hits)) {
+        return FeatureHitCache::toEvents(hits);
+    }
+
     int overlap = ViewManager::scalePixelSize(150);
     
     sv_frame_t frame0 = v->getFrameForX(-overlap);
@@ -335,6 +342,8 @@ TextLayer::paint(LayerGeometryProvider *v, QPainter &paint, QRect rect) const
     int boxMaxWidth = 150;
     int boxMaxHeight = 200;
 
+    FeatureHitCache::Recorder recorder(getHitCache(v), v, rect);
+
     paint.save();
     paint.setClipRect(rect.x(), 0, rect.width() + boxMaxWidth, v->getPaintHeight());
     
@@ -377,6 +386,8 @@ TextLayer::paint(LayerGeometryProvider *v, QPainter &paint, QRect rect) const
 //        boxRect = QRect(x, y, boxRect.width(), boxRect.height());
 //        textRect = QRect(x + 3, y + 2, textRect.width(), textRect.height());
 
+        recorder.add(p, boxRect);
+
         paint.setRenderHint(QPainter::Antialiasing, false);
         paint.drawRect(boxRect);
 
@@ -206,6 +206,18 @@ TimeInstantLayer::getLocalPoints(LayerGeometryProvider *v, int x) const
 
     sv_frame_t frame = v->getFrameForX(x);
 
+    double fuzz = v->scaleSize(2);
+    sv_frame_t suitable = 0;
+    bool have = false;
+
+    // If the instants around x were drawn in a recent paint, pick
+    // from those rather than going back to the model
+
+    EventVector cached;
+    if (getHitCache(v).getInstantsNear(v, x, fuzz, cached)) {
+        return cached;
+    }
+
     EventVector exact = model->getEventsStartingAt(frame);
     if (!exact.empty()) return exact;
 
@@ -213,10 +225,6 @@ TimeInstantLayer::getLocalPoints(LayerGeometryProvider *v, int x) const
     EventVector neighbouring = model->getEventsWithin
         (frame, model->getResolution(), 1);
 
-    double fuzz = v->scaleSize(2);
-    sv_frame_t suitable = 0;
-    bool have = false;
-    
     for (Event e: neighbouring) {
         sv_frame_t f = e.getFrame();
         if (f < v->getStartFrame() || f > v->getEndFrame()) {
@@ -429,6 +437,8 @@ TimeInstantLayer::paint(LayerGeometryProvider *v, QPainter &paint, QRect rect) c
     paint.setClipping(clippingRequired);
     
     bool illuminated = false;
+
+    FeatureHitCache::Recorder recorder(getHitCache(v), v, rect);
     
     for (EventVector::const_iterator i = points.begin();
          i != points.end(); ++i) {
@@ -439,6 +449,8 @@ TimeInstantLayer::paint(LayerGeometryProvider *v, QPainter &paint, QRect rect) c
 
         int x = v->getXForFrame(p.getFrame());
 
+        recorder.add(p, QRect(x, 0, 1, v->getPaintHeight()));
+
 #ifdef DEBUG_TIME_INSTANT_LAYER
         SVCERR << "point frame = " << p.getFrame() << " -> x = " << x << endl;
 #endif
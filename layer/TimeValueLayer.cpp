@@ -634,6 +634,18 @@ TimeValueLayer::getLocalPoints(LayerGeometryProvider *v, int x) const
     // vector.
     
     sv_frame_t frame = v->getFrameForX(x);
+
+    double fuzz = v->scaleSize(2);
+    sv_frame_t suitable = 0;
+    bool have = false;
+
+    // If the points around x were drawn in a recent paint, pick from
+    // those rather than going back to the model
+
+    EventVector cached;
+    if (getHitCache(v).getInstantsNear(v, x, fuzz, cached)) {
+        return cached;
+    }
     
     EventVector exact = model->getEventsStartingAt(frame);
     if (!exact.empty()) return exact;
@@ -641,10 +653,6 @@ TimeValueLayer::getLocalPoints(LayerGeometryProvider *v, int x) const
     // overspill == 1, so one event either side of the given span
     EventVector neighbouring = model->getEventsWithin
         (frame, model->getResolution(), 1);
-
-    double fuzz = v->scaleSize(2);
-    sv_frame_t suitable = 0;
-    bool have = false;
     
     for (Event e: neighbouring) {
         sv_frame_t f = e.getFrame();
@@ -1071,14 +1079,25 @@ TimeValueLayer::paint(LayerGeometryProvider *v, QPainter &paint, QRect rect) con
 
     bool illuminated = false;
     sv_frame_t illuminatedFrame = 0;
+
+    FeatureHitCache::Recorder recorder(getHitCache(v), v, rect);
+
+    auto table = v->getPixelFrameTable();
+    sv_frame_t modelsEndFrame = v->getModelsEndFrame();
     
     for (EventVector::const_iterator i = points.begin();
          i != points.end(); ++i) {
 
-        if (m_derivative && i == points.begin()) continue;
-
         Event p(*i);
 
+        // Record every point, including those we don't draw, so that
+        // hit-testing gives the same results as a model query would
+        int x = table->getXForFrame(p.getFrame());
+        
+        recorder.add(p, QRect(x, 0, 1, v->getPaintHeight()));
+
+        if (m_derivative && i == points.begin()) continue;
+
         double value = p.getValue();
         if (m_derivative) {
             EventVector::const_iterator j = i;
@@ -1086,7 +1105,6 @@ TimeValueLayer::paint(LayerGeometryProvider *v, QPainter &paint, QRect rect) con
             value -= j->getValue();
         }
 
-        int x = v->getXForFrame(p.getFrame());
         int y = getYForValue(v, value);
 
         bool gap = false;
@@ -1109,8 +1127,8 @@ TimeValueLayer::paint(LayerGeometryProvider *v, QPainter &paint, QRect rect) con
 
         bool haveNext = false;
         double nvalue = 0.f;
-        sv_frame_t nf = v->getModelsEndFrame();
-        int nx = v->getXForFrame(nf);
+        sv_frame_t nf = modelsEndFrame;
+        int nx = table->getXForFrame(nf);
         int ny = y;
 
         EventVector::const_iterator j = i;
@@ -1121,7 +1139,7 @@ TimeValueLayer::paint(LayerGeometryProvider *v, QPainter &paint, QRect rect) con
             nvalue = q.getValue();
             if (m_derivative) nvalue -= p.getValue();
             nf = q.getFrame();
-            nx = v->getXForFrame(nf);
+            nx = table->getXForFrame(nf);
             ny = getYForValue(v, nvalue);
             haveNext = true;
         }
@@ -64,9 +64,18 @@ WaveformLayer::WaveformLayer() :
 
 WaveformLayer::~WaveformLayer()
 {
+    LayerCacheBudget::getInstance()->removeAll(this);
     delete m_cache;
 }
 
+void
+WaveformLayer::evictCache(int)
+{
+    delete m_cache;
+    m_cache = nullptr;
+    m_cacheValid = false;
+}
+
 const ZoomConstraint *
 WaveformLayer::getZoomConstraint() const
 {
@@ -523,18 +532,22 @@ WaveformLayer::isLayerScrollable(const LayerGeometryProvider *) const
     return !m_autoNormalize;
 }
 
+bool
+WaveformLayer::isModelChangeLocalised() const
+{
+    return !m_autoNormalize && !m_aggressive;
+}
+
 static float meterdbs[] = { -40, -30, -20, -15, -10,
                             -5, -3, -2, -1, -0.5, 0 };
 
-bool
-WaveformLayer::getSourceFramesForX(LayerGeometryProvider *v,
-                                   int x, int modelZoomLevel,
-                                   sv_frame_t &f0, sv_frame_t &f1) const
+template <typename Mapping>
+static bool
+sourceFramesForX(const Mapping &mapping, ZoomLevel zoomLevel,
+                 int x, int modelZoomLevel, sv_frame_t modelEnd,
+                 sv_frame_t &f0, sv_frame_t &f1)
 {
-    auto model = ModelById::getAs<RangeSummarisableTimeValueModel>(m_model);
-    if (!model) return false;
-    
-    sv_frame_t viewFrame = v->getFrameForX(x);
+    sv_frame_t viewFrame = mapping.getFrameForX(x);
     if (viewFrame < 0) {
         f0 = 0;
         f1 = 0;
@@ -545,16 +558,38 @@ WaveformLayer::getSourceFramesForX(LayerGeometryProvider *v,
     f0 = f0 / modelZoomLevel;
     f0 = f0 * modelZoomLevel;
 
-    if (v->getZoomLevel().zone == ZoomLevel::PixelsPerFrame) {
+    if (zoomLevel.zone == ZoomLevel::PixelsPerFrame) {
         f1 = f0 + 1;
     } else {
-        viewFrame = v->getFrameForX(x + 1);
+        viewFrame = mapping.getFrameForX(x + 1);
         f1 = viewFrame;
         f1 = f1 / modelZoomLevel;
         f1 = f1 * modelZoomLevel;
     }
     
-    return (f0 < model->getEndFrame());
+    return (f0 < modelEnd);
+}
+
+bool
+WaveformLayer::getSourceFramesForX(LayerGeometryProvider *v,
+                                   int x, int modelZoomLevel,
+                                   sv_frame_t &f0, sv_frame_t &f1) const
+{
+    auto model = ModelById::getAs<RangeSummarisableTimeValueModel>(m_model);
+    if (!model) return false;
+
+    return sourceFramesForX(*v, v->getZoomLevel(), x, modelZoomLevel,
+                            model->getEndFrame(), f0, f1);
+}
+
+bool
+WaveformLayer::getSourceFramesForX(const PixelFrameTable &table,
+                                   int x, int modelZoomLevel,
+                                   sv_frame_t modelEnd,
+                                   sv_frame_t &f0, sv_frame_t &f1) const
+{
+    return sourceFramesForX(table, table.getZoomLevel(), x, modelZoomLevel,
+                            modelEnd, f0, f1);
 }
 
 float
@@ -655,6 +690,8 @@ WaveformLayer::paint(LayerGeometryProvider *v, QPainter &viewPainter, QRect rect
 
         if (m_cacheValid) {
             viewPainter.drawPixmap(rect, *m_cache, rect);
+            LayerCacheBudget::getInstance()->touch
+                (const_cast<WaveformLayer *>(this), 0);
             return;
         }
 
@@ -766,6 +803,10 @@ WaveformLayer::paint(LayerGeometryProvider *v, QPainter &viewPainter, QRect rect
         paint->end();
         delete paint;
         viewPainter.drawPixmap(rect, *m_cache, rect);
+        LayerCacheBudget::getInstance()->setUsage
+            (const_cast<WaveformLayer *>(this), 0,
+             qint64(m_cache->width()) * m_cache->height() *
+             (m_cache->depth() / 8));
     }
 }
 
@@ -954,6 +995,10 @@ WaveformLayer::paintChannel(LayerGeometryProvider *v,
 
     bool firstPoint = true;
     double prevRangeBottom = 0, prevRangeTop = 0;
+
+    auto table = v->getPixelFrameTable();
+    ZoomLevel zoomLevel = table->getZoomLevel();
+    sv_frame_t modelEnd = model->getEndFrame();
     
     for (int x = x0; x <= x1; ++x) {
 
@@ -962,17 +1007,17 @@ WaveformLayer::paintChannel(LayerGeometryProvider *v,
 
         bool showIndividualSample = false;
         
-        if (v->getZoomLevel().zone == ZoomLevel::FramesPerPixel) {
-            if (!getSourceFramesForX(v, x, blockSize, f0, f1)) {
+        if (zoomLevel.zone == ZoomLevel::FramesPerPixel) {
+            if (!getSourceFramesForX(*table, x, blockSize, modelEnd, f0, f1)) {
                 continue;
             }
             f1 = f1 - 1;
             i0 = (f0 - frame0) / blockSize;
             i1 = (f1 - frame0) / blockSize;
         } else {
-            int oversampleBy = v->getZoomLevel().level;
-            f0 = f1 = v->getFrameForX(x);
-            int xf0 = v->getXForFrame(f0);
+            int oversampleBy = zoomLevel.level;
+            f0 = f1 = table->getFrameForX(x);
+            int xf0 = table->getXForFrame(f0);
             showIndividualSample = (x == xf0);
             i0 = i1 = (f0 - frame0) * oversampleBy + (x - xf0);
         }
@@ -19,6 +19,7 @@
 #include <QRect>
 
 #include "SingleColourLayer.h"
+#include "LayerCacheBudget.h"
 
 #include "base/ZoomLevel.h"
 
@@ -30,8 +31,10 @@ class QPixmap;
 namespace sv {
 
 class View;
+class PixelFrameTable;
 
-class WaveformLayer : public SingleColourLayer
+class WaveformLayer : public SingleColourLayer,
+                      public LayerCacheBudget::Client
 {
     Q_OBJECT
 
@@ -51,6 +54,7 @@ public:
 
     int getVerticalScaleWidth(LayerGeometryProvider *v, bool detailed, QPainter &) const override;
     void paintVerticalScale(LayerGeometryProvider *v, bool detailed, QPainter &paint, QRect rect) const override;
+    bool isVerticalScaleRetainable() const override { return !m_autoNormalize; }
 
     void setModel(ModelId model); // a RangeSummarisableTimeValueModel
 
@@ -179,6 +183,7 @@ public:
     bool getAggressiveCacheing() const { return m_aggressive; }
 
     bool isLayerScrollable(const LayerGeometryProvider *) const override;
+    bool isModelChangeLocalised() const override;
 
     int getCompletion(LayerGeometryProvider *) const override;
 
@@ -204,6 +209,8 @@ public:
 
     bool canExistWithoutModel() const override { return true; }
 
+    void evictCache(int key) override;
+
 protected:
     double dBscale(double sample, int m) const;
     double dBscaleMeter(double sample, int m) const;
@@ -241,6 +248,12 @@ protected:
     bool getSourceFramesForX(LayerGeometryProvider *v, int x, int modelZoomLevel,
                              sv_frame_t &f0, sv_frame_t &f1) const;
 
+    // As above, but using a pixel/frame table and a known model end
+    // frame, for the paint loop
+    bool getSourceFramesForX(const PixelFrameTable &table,
+                             int x, int modelZoomLevel, sv_frame_t modelEnd,
+                             sv_frame_t &f0, sv_frame_t &f1) const;
+
     float getNormalizeGain(LayerGeometryProvider *v, int channel) const;
 
     void flagBaseColourChanged() override { m_cacheValid = false; }
@@ -0,0 +1,80 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+    Sonic Visualiser
+    An audio file viewer and annotation editor.
+    Centre for Digital Music, Queen Mary, University of London.
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation; either version 2 of the
+    License, or (at your option) any later version.  See the file
+    COPYING included with this distribution for more information.
+*/
+
+#include "OverlayCache.h"
+
+#include <QPainter>
+#include <QPaintEngine>
+#include <QPaintDevice>
+
+#include <cmath>
+
+namespace sv {
+
+OverlayCache::OverlayCache() :
+    m_dpr(1.0),
+    m_valid(false)
+{
+}
+
+void
+OverlayCache::invalidate()
+{
+    m_valid = false;
+    m_image = QImage();
+}
+
+void
+OverlayCache::paint(QPainter &target, QRect rect, QString key, Drawer drawer)
+{
+    if (rect.isEmpty()) return;
+
+    QPaintEngine *engine = target.paintEngine();
+    if (!engine || engine->type() != QPaintEngine::Raster ||
+        target.worldTransform().type() > QTransform::TxTranslate) {
+        drawer(target);
+        return;
+    }
+
+    double dpr = target.device()->devicePixelRatioF();
+
+    if (!m_valid || key != m_key || rect != m_rect || dpr != m_dpr) {
+
+        if (m_image.isNull() || rect.size() != m_rect.size() || dpr != m_dpr) {
+            m_image = QImage(int(ceil(rect.width() * dpr)),
+                             int(ceil(rect.height() * dpr)),
+                             QImage::Format_ARGB32_Premultiplied);
+            m_image.setDevicePixelRatio(dpr);
+        }
+        m_image.fill(Qt::transparent);
+
+        QPainter paint(&m_image);
+        paint.setFont(target.font());
+        paint.setPen(target.pen());
+        paint.setBrush(target.brush());
+        paint.setRenderHints(target.renderHints());
+        paint.translate(-rect.topLeft());
+        drawer(paint);
+        paint.end();
+
+        m_key = key;
+        m_rect = rect;
+        m_dpr = dpr;
+        m_valid = true;
+    }
+
+    target.drawImage(rect.topLeft(), m_image);
+}
+
+} // end namespace sv
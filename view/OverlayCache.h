@@ -0,0 +1,72 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+    Sonic Visualiser
+    An audio file viewer and annotation editor.
+    Centre for Digital Music, Queen Mary, University of London.
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation; either version 2 of the
+    License, or (at your option) any later version.  See the file
+    COPYING included with this distribution for more information.
+*/
+
+#ifndef SV_OVERLAY_CACHE_H
+#define SV_OVERLAY_CACHE_H
+
+#include <QImage>
+#include <QRect>
+#include <QString>
+
+#include <functional>
+
+class QPainter;
+
+namespace sv {
+
+/**
+ * A retained image of one of the overlays that a view paints over
+ * its layers, such as a vertical scale or a list of layer names. The
+ * overlay is described by a key string made up by the caller from
+ * everything its appearance depends on; it is redrawn only when the
+ * key, the area it covers, or the device pixel ratio changes, or
+ * after invalidate() has been called, and otherwise the retained
+ * image is simply composited again.
+ *
+ * When the target painter is not a raster one, or has a scaling or
+ * rotating transform, the overlay is drawn directly instead.
+ */
+class OverlayCache
+{
+public:
+    typedef std::function<void(QPainter &)> Drawer;
+
+    OverlayCache();
+
+    /**
+     * Composite the overlay identified by the given key onto the
+     * target painter, covering the given rect, calling the drawer to
+     * draw it first if the retained image is not up to date. The
+     * drawer receives a painter with the same font, pen, brush and
+     * render hints as the target, with coordinates the same as the
+     * target's, and should draw only within the rect.
+     */
+    void paint(QPainter &target, QRect rect, QString key, Drawer drawer);
+
+    /**
+     * Discard the retained image, so that it is redrawn on next use.
+     */
+    void invalidate();
+
+private:
+    QImage m_image;
+    QRect m_rect;
+    QString m_key;
+    double m_dpr;
+    bool m_valid;
+};
+
+} // end namespace sv
+
+#endif
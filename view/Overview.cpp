@@ -17,11 +17,14 @@
 #include "layer/Layer.h"
 #include "data/model/Model.h"
 #include "base/ZoomConstraint.h"
+#include "base/Profiler.h"
 
 #include <QPaintEvent>
 #include <QPainter>
 #include <QPainterPath>
 #include <iostream>
+#include <cmath>
+#include <cstdlib>
 
 //#define DEBUG_OVERVIEW 1
 
@@ -31,13 +34,13 @@ namespace sv {
 Overview::Overview(QWidget *w) :
     View(w, false),
     m_clickedInRange(false),
-    m_dragCentreFrame(0)
+    m_dragCentreFrame(0),
+    m_cacheRescaled(false)
 {
     setObjectName(tr("Overview"));
     m_followPan = false;
     m_followZoom = false;
     setPlaybackFollow(PlaybackIgnore);
-    m_modelTestTimer.start();
 
     bool light = hasLightBackground();
     if (light) m_boxColour = Qt::darkGray;
@@ -59,21 +62,34 @@ Overview::modelChangedWithin(ModelId modelId, sv_frame_t startFrame, sv_frame_t
         zoomChanged = true;
     }
 
-    if (!zoomChanged) {
-        if (m_modelTestTimer.elapsed() < 1000) {
-            for (LayerList::const_iterator i = m_layerStack.begin();
-                 i != m_layerStack.end(); ++i) {
-                auto model = ModelById::get((*i)->getModel());
-                if (model && (!model->isOK() || !model->isReady())) {
-                    return;
-                }
-            }
-        } else {
-            m_modelTestTimer.restart();
-        }
+    View::modelChangedWithin(modelId, startFrame, endFrame);
+
+    // The view will repaint only the part of its cache showing the
+    // changed frames, but if the zoom has to change, everything
+    // moves: paintEvent rescales the cache rather than redrawing it,
+    // but we still need to be repainted from it in full
+    if (zoomChanged) {
+        scheduleUpdate(QRect());
     }
+}
 
-    View::modelChangedWithin(modelId, startFrame, endFrame);
+void
+Overview::modelCompletionChanged(ModelId modelId)
+{
+    View::modelCompletionChanged(modelId);
+
+    // Each rescale loses a little detail, so once the models have
+    // stopped growing, replace the squeezed cache with a proper
+    // rendering at the final zoom level
+    if (m_cacheRescaled && getLayerCompletion() >= 100) {
+#ifdef DEBUG_OVERVIEW
+        cerr << "Overview::modelCompletionChanged: models complete, "
+             << "redrawing rescaled cache" << endl;
+#endif
+        m_cacheRescaled = false;
+        m_cacheValid = false;
+        scheduleUpdate(QRect());
+    }
 }
 
 void
@@ -171,6 +187,133 @@ Overview::setBoxColour(QColor c)
     m_boxColour = c;
 }
 
+bool
+Overview::rescaleCache(ZoomLevel fromZoom, sv_frame_t fromCentre,
+                       ZoomLevel toZoom, sv_frame_t toCentre)
+{
+    // The cache must show exactly what we had at the old zoom level
+    // (apart from any stale range, which stays stale) and we can only
+    // squeeze it, not stretch it
+    
+    if (!m_cache || !m_cacheValid) return false;
+    if (m_cacheZoomLevel != fromZoom || m_cacheCentreFrame != fromCentre) {
+        return false;
+    }
+    if (fromZoom.zone != ZoomLevel::FramesPerPixel ||
+        toZoom.zone != ZoomLevel::FramesPerPixel ||
+        toZoom.level <= fromZoom.level) {
+        return false;
+    }
+
+    int dpratio = effectiveDevicePixelRatio();
+    if (m_cache->size() != scaledSize(size(), dpratio)) return false;
+
+    // Only layers that draw just what is at each frame look right
+    // squeezed: anything with labels or ticks must be redrawn
+    bool changed = false;
+    LayerList scrollables = getScrollableBackLayers(false, changed);
+    if (scrollables.empty()) return false;
+    for (auto layer: scrollables) {
+        if (!layer->isModelChangeLocalised()) return false;
+    }
+
+    Profiler profiler("Overview::rescaleCache");
+    
+    int w = m_cache->width();
+    int h = m_cache->height();
+    double half = w / 2.0;
+    double fromRatio = double(fromZoom.level) / dpratio; // frames per pixel
+    double toRatio = double(toZoom.level) / dpratio;
+    sv_frame_t modelsStart = getModelsStartFrame();
+
+    // Source columns for each target column, or -1 if the target
+    // column shows frames we did not have on screen before
+    std::vector<int> src0(w, -1), src1(w, -1);
+
+    bool haveStale = m_cacheHasStaleRange;
+    sv_frame_t staleStart = m_cacheStaleStart, staleEnd = m_cacheStaleEnd;
+    
+    for (int x = 0; x < w; ++x) {
+        double f0 = double(toCentre) + (x - half) * toRatio;
+        double f1 = f0 + toRatio;
+        int i0 = int(floor(half + (f0 - double(fromCentre)) / fromRatio));
+        int i1 = int(ceil(half + (f1 - double(fromCentre)) / fromRatio));
+        if (i1 <= i0) i1 = i0 + 1;
+        if (i0 >= 0 && i1 <= w) {
+            src0[x] = i0;
+            src1[x] = i1;
+        } else if (sv_frame_t(f1) >= modelsStart) {
+            if (!haveStale || sv_frame_t(f0) < staleStart) {
+                staleStart = sv_frame_t(f0);
+            }
+            if (!haveStale || sv_frame_t(f1) > staleEnd) {
+                staleEnd = sv_frame_t(f1);
+            }
+            haveStale = true;
+        }
+    }
+
+    // Of the source pixels making up each target pixel, keep the one
+    // that stands out most from the background, so thin features
+    // survive rather than being averaged away
+    QRgb bg = getBackground().rgba();
+    auto distance = [bg](QRgb p) {
+        return abs(qRed(p) - qRed(bg)) + abs(qGreen(p) - qGreen(bg)) +
+            abs(qBlue(p) - qBlue(bg));
+    };
+
+    // The cache may have been scrolled, in which case view column i
+    // is found at cache column (i + m_cacheOrigin) modulo the width.
+    // We write the rescaled image unwrapped
+    if (m_cacheOrigin != 0) {
+        for (int x = 0; x < w; ++x) {
+            if (src0[x] < 0) continue;
+            src0[x] += m_cacheOrigin;
+            src1[x] += m_cacheOrigin;
+        }
+    }
+    
+    QImage rescaled(m_cache->size(), m_cache->format());
+    
+    for (int y = 0; y < h; ++y) {
+        const QRgb *from = reinterpret_cast<const QRgb *>
+            (m_cache->constScanLine(y));
+        QRgb *to = reinterpret_cast<QRgb *>(rescaled.scanLine(y));
+        for (int x = 0; x < w; ++x) {
+            if (src0[x] < 0) {
+                to[x] = bg;
+                continue;
+            }
+            QRgb best = from[src0[x] % w];
+            int bestDistance = distance(best);
+            for (int i = src0[x] + 1; i < src1[x]; ++i) {
+                int d = distance(from[i % w]);
+                if (d > bestDistance) {
+                    best = from[i % w];
+                    bestDistance = d;
+                }
+            }
+            to[x] = best;
+        }
+    }
+
+#ifdef DEBUG_OVERVIEW
+    cerr << "Overview::rescaleCache: from zoom " << fromZoom << " to "
+         << toZoom << ", stale range now " << staleStart << " to "
+         << staleEnd << endl;
+#endif
+    
+    *m_cache = rescaled;
+    m_cacheOrigin = 0;
+    m_cacheZoomLevel = toZoom;
+    m_cacheCentreFrame = toCentre;
+    m_cacheHasStaleRange = haveStale;
+    m_cacheStaleStart = staleStart;
+    m_cacheStaleEnd = staleEnd;
+
+    return true;
+}
+
 void
 Overview::paintEvent(QPaintEvent *e)
 {
@@ -187,17 +330,31 @@ Overview::paintEvent(QPaintEvent *e)
     ZoomLevel zoomLevel { ZoomLevel::FramesPerPixel, int(frameCount / width()) };
     if (zoomLevel.level < 1) zoomLevel.level = 1;
     zoomLevel = getZoomConstraintLevel(zoomLevel, ZoomConstraint::RoundUp);
-    if (zoomLevel != m_zoomLevel) {
-        m_zoomLevel = zoomLevel;
-        emit zoomLevelChanged(m_zoomLevel, m_followZoom);
-    }
 
     sv_frame_t centreFrame = startFrame +
-        sv_frame_t(round(m_zoomLevel.pixelsToFrames(width()/2)));
+        sv_frame_t(round(zoomLevel.pixelsToFrames(width()/2)));
     
     if (centreFrame > (startFrame + getModelsEndFrame())/2) {
         centreFrame = (startFrame + getModelsEndFrame())/2;
     }
+
+    if (zoomLevel != m_zoomLevel) {
+        // Typically because the models have grown. Rather than redraw
+        // everything at the new zoom level, squeeze what we have and
+        // draw only the new part - unless they have finished growing,
+        // in which case this is the last zoom change and we may as
+        // well have it drawn properly
+        if (getLayerCompletion() < 100 &&
+            rescaleCache(m_zoomLevel, m_centreFrame, zoomLevel, centreFrame)) {
+            m_cacheRescaled = true;
+        } else if (m_cacheRescaled) {
+            m_cacheRescaled = false;
+            m_cacheValid = false;
+        }
+        m_zoomLevel = zoomLevel;
+        emit zoomLevelChanged(m_zoomLevel, m_followZoom);
+    }
+
     if (centreFrame != m_centreFrame) {
 #ifdef DEBUG_OVERVIEW
         cerr << "Overview::paintEvent: Centre frame changed from "
@@ -19,7 +19,6 @@
 #include "View.h"
 
 #include <QPoint>
-#include <QElapsedTimer>
 
 class QWidget;
 class QPaintEvent;
@@ -44,6 +43,7 @@ public:
 
 public slots:
     void modelChangedWithin(ModelId, sv_frame_t startFrame, sv_frame_t endFrame) override;
+    void modelCompletionChanged(ModelId) override;
     void modelReplaced() override;
 
     void globalCentreFrameChanged(sv_frame_t) override;
@@ -65,13 +65,16 @@ protected:
 
     QColor getFillWithin() const;
     QColor getFillWithout() const;
+
+    bool rescaleCache(ZoomLevel fromZoom, sv_frame_t fromCentre,
+                      ZoomLevel toZoom, sv_frame_t toCentre);
     
     QPoint m_clickPos;
     QPoint m_mousePos;
     bool m_clickedInRange;
     sv_frame_t m_dragCentreFrame;
-    QElapsedTimer m_modelTestTimer;
     QColor m_boxColour;
+    bool m_cacheRescaled; // cache has been squeezed since last drawn in full
     
     typedef std::set<View *> ViewSet;
     ViewSet m_views;
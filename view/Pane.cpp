@@ -96,7 +96,8 @@ Pane::Pane(QWidget *w) :
     m_lastVerticalPannerContextMenu(nullptr),
     m_mouseInWidget(false),
     m_playbackFrameMoveScheduled(false),
-    m_playbackFrameMoveTo(0)
+    m_playbackFrameMoveTo(0),
+    m_overlayGeneration(0)
 {
     setObjectName("Pane");
     setMouseTracking(true);
@@ -684,21 +685,57 @@ Pane::drawVerticalScale(QRect r, Layer *topLayer, QPainter &paint)
 
 //      Profiler profiler("Pane::paintEvent - painting vertical scale", true);
 
-        paint.save();
+        int scaleWidth = m_scaleWidth;
+        int h = height();
+        
+        auto drawer = [&](QPainter &spaint) {
+            
+            spaint.save();
             
-        paint.setPen(Qt::NoPen);
-        paint.setBrush(getBackground());
-        paint.drawRect(0, 0, m_scaleWidth, height());
+            spaint.setPen(Qt::NoPen);
+            spaint.setBrush(getBackground());
+            spaint.drawRect(0, 0, scaleWidth, h);
         
-        paint.setPen(getForeground());
-        paint.drawLine(m_scaleWidth, 0, m_scaleWidth, height());
+            spaint.setPen(getForeground());
+            spaint.drawLine(scaleWidth, 0, scaleWidth, h);
 
-        paint.setBrush(Qt::NoBrush);
-        scaleLayer->paintVerticalScale
-            (this, includeColourScale, paint,
-             QRect(0, 0, m_scaleWidth, height()));
+            spaint.setBrush(Qt::NoBrush);
+            scaleLayer->paintVerticalScale
+                (this, includeColourScale, spaint, QRect(0, 0, scaleWidth, h));
         
-        paint.restore();
+            spaint.restore();
+        };
+
+        // A detailed scale includes a colour scale, whose range
+        // typically follows whatever is currently visible, so we
+        // don't try to retain that
+        
+        if (includeColourScale || !scaleLayer->isVerticalScaleRetainable()) {
+            m_scaleOverlay.invalidate();
+            drawer(paint);
+            return;
+        }
+
+        double dmin = 0.0, dmax = 0.0;
+        if (!scaleLayer->getDisplayExtents(dmin, dmax)) {
+            bool log;
+            QString unit;
+            (void)scaleLayer->getValueExtents(dmin, dmax, log, unit);
+        }
+
+        QString key = QString("%1|%2|%3|%4|%5|%6|%7|%8|%9")
+            .arg(quintptr(scaleLayer))
+            .arg(scaleWidth)
+            .arg(h)
+            .arg(getBackground().rgba())
+            .arg(getForeground().rgba())
+            .arg(paint.font().key())
+            .arg(dmin)
+            .arg(dmax)
+            .arg(m_overlayGeneration);
+
+        m_scaleOverlay.paint(paint, QRect(0, 0, scaleWidth + 1, h),
+                             key, drawer);
     }
 }
             
@@ -1008,48 +1045,81 @@ Pane::drawLayerNames(QRect r, QPainter &paint)
         return;
     }
 
-    QStringList texts;
-    std::vector<QPixmap> pixmaps;
-    for (LayerList::iterator i = m_layerStack.begin(); i != m_layerStack.end(); ++i) {
-        texts.push_back((*i)->getLayerPresentationName());
-//        SVCERR << "Pane " << this << ": Layer presentation name for " << *i << ": "
-//                  << texts[texts.size()-1] << endl;
-        pixmaps.push_back((*i)->getLayerPresentationPixmap
-                          (QSize(fontAscent, fontAscent)));
-    }
-
     int maxTextWidth = width() / 3;
-    texts = TextAbbrev::abbreviate(texts, paint.fontMetrics(), maxTextWidth,
-                                   TextAbbrev::ElideEndAndCommonPrefixes);
 
     int llx = width() - maxTextWidth - 5;
     if (m_manager->getZoomWheelsEnabled()) {
         llx -= m_manager->scalePixelSize(36);
     }
     
-    if (r.x() + r.width() >= llx - fontAscent - 3) {
+    if (r.x() + r.width() < llx - fontAscent - 3) {
+        return;
+    }
+
+    // The names are abbreviated and the pixmaps obtained only when
+    // the retained image has to be redrawn; the key needs just the
+    // unabbreviated names, as anything else that affects them is
+    // either included separately or bumps the overlay generation
+    
+    QString key = QString("%1|%2|%3|%4|%5|%6|%7")
+        .arg(width())
+        .arg(lly)
+        .arg(llx)
+        .arg(getBackground().rgba())
+        .arg(getForeground().rgba())
+        .arg(paint.font().key())
+        .arg(m_overlayGeneration);
+
+    for (LayerList::iterator i = m_layerStack.begin(); i != m_layerStack.end(); ++i) {
+        key += QString("|%1:%2").arg(quintptr(*i))
+            .arg((*i)->getLayerPresentationName());
+    }
+
+    int n = int(m_layerStack.size());
     
+    QRect rect(llx - fontAscent - 5, lly - n * fontHeight - 3,
+               width() - (llx - fontAscent - 5), n * fontHeight + 6);
+
+    auto drawer = [&](QPainter &spaint) {
+        
+        QStringList texts;
+        std::vector<QPixmap> pixmaps;
+        for (LayerList::iterator i = m_layerStack.begin(); i != m_layerStack.end(); ++i) {
+            texts.push_back((*i)->getLayerPresentationName());
+//            SVCERR << "Pane " << this << ": Layer presentation name for " << *i << ": "
+//                      << texts[texts.size()-1] << endl;
+            pixmaps.push_back((*i)->getLayerPresentationPixmap
+                              (QSize(fontAscent, fontAscent)));
+        }
+
+        texts = TextAbbrev::abbreviate(texts, spaint.fontMetrics(), maxTextWidth,
+                                       TextAbbrev::ElideEndAndCommonPrefixes);
+
+        int y = lly;
+        
         for (int i = 0; i < texts.size(); ++i) {
 
 //            SVCERR << "Pane "<< this << ": text " << i << ": " << texts[i] << endl;
             
             if (i + 1 == texts.size()) {
-                paint.setPen(getForeground());
+                spaint.setPen(getForeground());
             }
             
-            PaintAssistant::drawVisibleText(this, paint, llx,
-                            lly - fontHeight + fontAscent,
+            PaintAssistant::drawVisibleText(this, spaint, llx,
+                            y - fontHeight + fontAscent,
                             texts[i], PaintAssistant::OutlinedText);
 
             if (!pixmaps[i].isNull()) {
-                paint.drawPixmap(llx - fontAscent - 3,
-                                 lly - fontHeight + (fontHeight-fontAscent)/2,
-                                 pixmaps[i]);
+                spaint.drawPixmap(llx - fontAscent - 3,
+                                  y - fontHeight + (fontHeight-fontAscent)/2,
+                                  pixmaps[i]);
             }
             
-            lly -= fontHeight;
+            y -= fontHeight;
         }
-    }
+    };
+
+    m_layerNamesOverlay.paint(paint, rect, key, drawer);
 }
 
 void
@@ -2673,10 +2743,40 @@ Pane::resetVerticalPannerExtents()
 void
 Pane::layerParametersChanged()
 {
+    ++m_overlayGeneration;
     View::layerParametersChanged();
     updateHeadsUpDisplay();
 }
 
+void
+Pane::layerParameterRangesChanged()
+{
+    ++m_overlayGeneration;
+    View::layerParameterRangesChanged();
+}
+
+void
+Pane::modelChanged(ModelId modelId)
+{
+    ++m_overlayGeneration;
+    View::modelChanged(modelId);
+}
+
+void
+Pane::modelChangedWithin(ModelId modelId,
+                         sv_frame_t startFrame, sv_frame_t endFrame)
+{
+    ++m_overlayGeneration;
+    View::modelChangedWithin(modelId, startFrame, endFrame);
+}
+
+void
+Pane::modelReplaced()
+{
+    ++m_overlayGeneration;
+    View::modelReplaced();
+}
+
 void
 Pane::dragEnterEvent(QDragEnterEvent *e)
 {
@@ -21,6 +21,7 @@
 
 #include "base/ZoomConstraint.h"
 #include "View.h"
+#include "OverlayCache.h"
 #include "base/Selection.h"
 
 class QWidget;
@@ -114,6 +115,12 @@ public slots:
     void resetVerticalPannerExtents();
 
     virtual void layerParametersChanged() override;
+    virtual void layerParameterRangesChanged() override;
+
+    virtual void modelChanged(ModelId) override;
+    virtual void modelChangedWithin(ModelId, sv_frame_t startFrame,
+                                    sv_frame_t endFrame) override;
+    virtual void modelReplaced() override;
 
     virtual void propertyContainerSelected(View *, PropertyContainer *pc) override;
 
@@ -237,6 +244,14 @@ protected:
 
     bool m_playbackFrameMoveScheduled;
     sv_frame_t m_playbackFrameMoveTo;
+
+    // Retained images of the vertical scale and layer names, redrawn
+    // only when their keys change. The generation is part of both
+    // keys, and is bumped whenever a layer or model changes in a way
+    // that the rest of the key would not show
+    OverlayCache m_scaleOverlay;
+    OverlayCache m_layerNamesOverlay;
+    int m_overlayGeneration;
     
     static QCursor *m_measureCursor1;
     static QCursor *m_measureCursor2;
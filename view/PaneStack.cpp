@@ -22,6 +22,7 @@
 #include "layer/Layer.h"
 #include "ViewManager.h"
 #include "AlignmentView.h"
+#include "RenderScheduler.h"
 
 #include <QApplication>
 #include <QHBoxLayout>
@@ -558,6 +559,9 @@ PaneStack::setCurrentPane(Pane *pane) // may be null
 
     if (found || pane == nullptr) {
         m_currentPane = pane;
+        if (m_viewManager) {
+            m_viewManager->getRenderScheduler()->setCurrentView(pane);
+        }
         emit currentPaneChanged(m_currentPane);
     } else {
         SVCERR << "WARNING: PaneStack::setCurrentPane(" << pane << "): pane is not a visible pane in this stack" << endl;
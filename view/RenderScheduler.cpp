@@ -0,0 +1,238 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+    Sonic Visualiser
+    An audio file viewer and annotation editor.
+    Centre for Digital Music, Queen Mary, University of London.
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation; either version 2 of the
+    License, or (at your option) any later version.  See the file
+    COPYING included with this distribution for more information.
+*/
+
+#include "RenderScheduler.h"
+
+#include "View.h"
+#include "Pane.h"
+
+#include "base/Debug.h"
+
+#include <QTimer>
+
+#include <vector>
+#include <algorithm>
+
+//#define DEBUG_RENDER_SCHEDULER 1
+
+namespace sv {
+
+RenderScheduler::RenderScheduler(QObject *parent) :
+    QObject(parent),
+    m_timer(new QTimer(this))
+{
+    m_timer->setSingleShot(true);
+    connect(m_timer, SIGNAL(timeout()), this, SLOT(flush()));
+}
+
+RenderScheduler::~RenderScheduler()
+{
+}
+
+void
+RenderScheduler::setCurrentView(View *view)
+{
+    if (view == m_current) return;
+
+    m_current = view;
+
+    // Anything held for the new current view can go now
+    if (view) {
+        auto itr = m_requests.find(view);
+        if (itr != m_requests.end()) {
+            release(itr->second);
+            m_requests.erase(itr);
+        }
+    }
+}
+
+View *
+RenderScheduler::getCurrentView() const
+{
+    return m_current;
+}
+
+RenderScheduler::Priority
+RenderScheduler::getPriority(const View *view) const
+{
+    if (!view) return Priority::Background;
+    if (view == m_current) return Priority::Current;
+
+    // The overview and alignment views are not panes, and are never
+    // what the user is working in
+    if (!qobject_cast<const Pane *>(view)) return Priority::Background;
+
+    if (!view->isVisible() || view->visibleRegion().isEmpty()) {
+        return Priority::Background;
+    }
+
+    return m_current ? Priority::Visible : Priority::Current;
+}
+
+double
+RenderScheduler::getRenderTimeScale(const View *view) const
+{
+    switch (getPriority(view)) {
+    case Priority::Current: return 1.0;
+    case Priority::Visible: return 0.5;
+    case Priority::Background: return 0.25;
+    }
+    return 1.0;
+}
+
+void
+RenderScheduler::requestUpdate(View *view, QRect rect)
+{
+    if (!view) return;
+
+    // A hidden view costs nothing to update, as Qt will not paint it
+    // until it is shown
+    if (!view->isVisible() || getPriority(view) == Priority::Current) {
+        if (rect.isNull()) view->update();
+        else view->update(rect);
+        return;
+    }
+
+    watch(view);
+
+    auto itr = m_requests.find(view);
+    if (itr == m_requests.end()) {
+        Request request;
+        request.view = view;
+        request.whole = false;
+        request.framesWaited = 0;
+        itr = m_requests.insert({ view, request }).first;
+    }
+
+    if (rect.isNull()) {
+        itr->second.whole = true;
+    } else {
+        itr->second.region += rect;
+    }
+
+    if (!m_timer->isActive()) {
+        m_timer->start(frameInterval);
+    }
+}
+
+void
+RenderScheduler::reportPaintTime(const View *view, double seconds)
+{
+    if (!view) return;
+    watch(view);
+    m_paintTimes[view] = seconds;
+}
+
+void
+RenderScheduler::watch(const View *view)
+{
+    if (m_watched.find(view) != m_watched.end()) return;
+    m_watched.insert(view);
+    connect(view, SIGNAL(destroyed(QObject *)),
+            this, SLOT(viewDestroyed(QObject *)));
+}
+
+void
+RenderScheduler::viewDestroyed(QObject *o)
+{
+    m_requests.erase(o);
+    m_paintTimes.erase(o);
+    m_watched.erase(o);
+}
+
+void
+RenderScheduler::release(Request &request)
+{
+    View *view = request.view;
+    if (!view) return;
+
+    if (request.whole) {
+        view->update();
+    } else if (!request.region.isEmpty()) {
+        view->update(request.region);
+    }
+}
+
+void
+RenderScheduler::flush()
+{
+    struct Candidate {
+        const QObject *key;
+        Priority priority;
+        int framesWaited;
+    };
+
+    std::vector<Candidate> candidates;
+
+    for (auto itr = m_requests.begin(); itr != m_requests.end(); ) {
+        if (!itr->second.view) {
+            itr = m_requests.erase(itr);
+            continue;
+        }
+        candidates.push_back({ itr->first,
+                               getPriority(itr->second.view),
+                               itr->second.framesWaited });
+        ++itr;
+    }
+
+    // Higher priority first, and the longest waiting first within
+    // the same priority
+    std::sort(candidates.begin(), candidates.end(),
+              [](const Candidate &a, const Candidate &b) {
+                  if (a.priority != b.priority) {
+                      return a.priority < b.priority;
+                  }
+                  return a.framesWaited > b.framesWaited;
+              });
+
+    double spent = 0.0;
+    bool releasedAny = false;
+
+    for (const auto &c: candidates) {
+
+        Request &request = m_requests.at(c.key);
+
+        double cost = 0.0;
+        auto pitr = m_paintTimes.find(c.key);
+        if (pitr != m_paintTimes.end()) cost = pitr->second;
+
+        bool go = (c.priority == Priority::Current ||
+                   request.framesWaited >= maxFramesWaited ||
+                   !releasedAny ||
+                   spent + cost <= frameBudget);
+
+#ifdef DEBUG_RENDER_SCHEDULER
+        SVDEBUG << "RenderScheduler::flush: view "
+                << request.view->getId() << " priority "
+                << int(c.priority) << " waited " << request.framesWaited
+                << " cost " << cost << " spent " << spent
+                << (go ? ": releasing" : ": holding") << endl;
+#endif
+
+        if (go) {
+            release(request);
+            m_requests.erase(c.key);
+            spent += cost;
+            releasedAny = true;
+        } else {
+            ++request.framesWaited;
+        }
+    }
+
+    if (!m_requests.empty()) {
+        m_timer->start(frameInterval);
+    }
+}
+
+} // end namespace sv
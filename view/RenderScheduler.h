@@ -0,0 +1,123 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+    Sonic Visualiser
+    An audio file viewer and annotation editor.
+    Centre for Digital Music, Queen Mary, University of London.
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation; either version 2 of the
+    License, or (at your option) any later version.  See the file
+    COPYING included with this distribution for more information.
+*/
+
+#ifndef SV_RENDER_SCHEDULER_H
+#define SV_RENDER_SCHEDULER_H
+
+#include <QObject>
+#include <QPointer>
+#include <QRegion>
+
+#include <map>
+#include <set>
+
+class QTimer;
+
+namespace sv {
+
+class View;
+
+/**
+ * Decides the order in which the views sharing a ViewManager get to
+ * repaint when something other than the user has changed them, so
+ * that with many panes open the one the user is working in stays
+ * responsive.
+ *
+ * Views pass repaints prompted by model changes, or by a layer that
+ * ran out of time and wants to carry on rendering, through
+ * requestUpdate() instead of updating themselves. A request for the
+ * current view goes straight through. Other requests are held and
+ * released once per display frame, visible panes before anything
+ * else, for as long as the time those views took to paint last time
+ * fits within the frame budget. At least one is released every
+ * frame, and none is held for more than a few frames.
+ *
+ * The same priority scales how long time-constrained rendering may
+ * run within a single paint (see getRenderTimeScale()), so that work
+ * for background views is spread across more, shorter slices.
+ */
+class RenderScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    RenderScheduler(QObject *parent = nullptr);
+    virtual ~RenderScheduler();
+
+    enum class Priority {
+        Current,    // The pane the user is working in
+        Visible,    // Other panes on screen
+        Background  // The overview and any other non-pane views
+    };
+
+    /**
+     * Set the view the user is currently working in, or null for
+     * none. While there is none, all visible panes are treated as
+     * current.
+     */
+    void setCurrentView(View *view);
+    View *getCurrentView() const;
+
+    Priority getPriority(const View *view) const;
+
+    /**
+     * Return the factor by which the view should scale the time it
+     * allows itself for time-constrained rendering in a single paint:
+     * 1.0 for the current view, less for others.
+     */
+    double getRenderTimeScale(const View *view) const;
+
+    /**
+     * Ask for the given rect of a view (in the view's own
+     * coordinates) to be repainted, or the whole view if the rect is
+     * null. The view will be updated in due course, according to its
+     * priority.
+     */
+    void requestUpdate(View *view, QRect rect = QRect());
+
+    /**
+     * Report how long a view has just taken to paint, in seconds.
+     * This is used as an estimate of the cost of its next repaint.
+     */
+    void reportPaintTime(const View *view, double seconds);
+
+protected slots:
+    void flush();
+    void viewDestroyed(QObject *);
+
+protected:
+    struct Request {
+        QPointer<View> view;
+        QRegion region;
+        bool whole;
+        int framesWaited;
+    };
+
+    QPointer<View> m_current;
+    std::map<const QObject *, Request> m_requests;
+    std::map<const QObject *, double> m_paintTimes;
+    std::set<const QObject *> m_watched;
+    QTimer *m_timer;
+
+    static const int frameInterval = 16; // ms
+    static const int maxFramesWaited = 8;
+    static constexpr double frameBudget = 0.012; // sec
+
+    void watch(const View *view);
+    void release(Request &request);
+};
+
+} // end namespace sv
+
+#endif
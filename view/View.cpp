@@ -22,6 +22,7 @@
 #include "base/Preferences.h"
 #include "base/HitCount.h"
 #include "ViewProxy.h"
+#include "RenderScheduler.h"
 
 #include "layer/TimeRulerLayer.h"
 #include "layer/SingleColourLayer.h"
@@ -37,6 +38,8 @@
 #include <QRect>
 #include <QApplication>
 #include <QProgressDialog>
+#include <QEventLoop>
+#include <QPointer>
 #include <QTextStream>
 #include <QFont>
 #include <QMessageBox>
@@ -45,6 +48,7 @@
 #include <QSvgGenerator>
 #include <QThreadPool>
 #include <QSemaphore>
+#include <QElapsedTimer>
 
 #include <iostream>
 #include <cassert>
@@ -60,6 +64,9 @@ namespace sv {
 View::View(QWidget *w, bool showProgress) :
     QFrame(w),
     m_id(getNextId()),
+    m_nextLayersReadyId(1),
+    m_lastLayerCompletion(100),
+    m_layersReadyFallbackTimer(nullptr),
     m_centreFrame(0),
     m_zoomLevel(ZoomLevel::FramesPerPixel, 1024),
     m_followPan(true),
@@ -71,9 +78,14 @@ View::View(QWidget *w, bool showProgress) :
     m_cache(nullptr),
     m_buffer(nullptr),
     m_cacheValid(false),
+    m_cacheHasStaleRange(false),
+    m_cacheStaleStart(0),
+    m_cacheStaleEnd(0),
     m_cacheCentreFrame(0),
     m_cacheZoomLevel(ZoomLevel::FramesPerPixel, 1024),
     m_selectionCached(false),
+    m_cacheOrigin(0),
+    m_modelChangeTimer(nullptr),
     m_deleting(false),
     m_haveSelectedLayer(false),
     m_useAligningProxy(false),
@@ -907,6 +919,8 @@ View::addLayer(Layer *layer)
             this,    SLOT(layerParameterRangesChanged()));
     connect(layer, SIGNAL(layerMeasurementRectsChanged()),
             this,    SLOT(layerMeasurementRectsChanged()));
+    connect(layer, SIGNAL(layerFeatureDescriptionChanged()),
+            this,    SLOT(layerFeatureDescriptionChanged()));
     connect(layer, SIGNAL(layerNameChanged()),
             this,    SLOT(layerNameChanged()));
     connect(layer, SIGNAL(modelChanged(ModelId)),
@@ -962,6 +976,8 @@ View::removeLayer(Layer *layer)
                this,    SLOT(layerParametersChanged()));
     disconnect(layer, SIGNAL(layerParameterRangesChanged()),
                this,    SLOT(layerParameterRangesChanged()));
+    disconnect(layer, SIGNAL(layerFeatureDescriptionChanged()),
+               this,    SLOT(layerFeatureDescriptionChanged()));
     disconnect(layer, SIGNAL(layerNameChanged()),
                this,    SLOT(layerNameChanged()));
     disconnect(layer, SIGNAL(modelChanged(ModelId)),
@@ -977,6 +993,11 @@ View::removeLayer(Layer *layer)
 
     update();
 
+    if (!m_layersReadyCallbacks.empty()) {
+        QMetaObject::invokeMethod(this, "checkLayersReady",
+                                  Qt::QueuedConnection);
+    }
+
     emit propertyContainerRemoved(layer);
 }
 
@@ -1131,6 +1152,125 @@ View::modelChanged(ModelId modelId)
     SVCERR << "View[" << getId() << "]::modelChanged(" << modelId << ")" << endl;
 #endif
 
+    m_pendingModelChanges[modelId].whole = true;
+    scheduleModelChanges();
+}
+
+void
+View::modelChangedWithin(ModelId modelId,
+                         sv_frame_t startFrame, sv_frame_t endFrame)
+{
+#ifdef DEBUG_VIEW_WIDGET_PAINT
+    SVCERR << "View[" << getId() << "]::modelChangedWithin(" << startFrame << "," << endFrame << ")" << endl;
+#endif
+
+    PendingModelChange &change = m_pendingModelChanges[modelId];
+    if (change.haveRange) {
+        change.startFrame = std::min(change.startFrame, startFrame);
+        change.endFrame = std::max(change.endFrame, endFrame);
+    } else {
+        change.startFrame = startFrame;
+        change.endFrame = endFrame;
+        change.haveRange = true;
+    }
+    scheduleModelChanges();
+}    
+
+void
+View::modelCompletionChanged(ModelId modelId)
+{
+#ifdef DEBUG_PROGRESS_STUFF
+    SVCERR << "View[" << getId() << "]::modelCompletionChanged(" << modelId << ")" << endl;
+#endif
+
+    // Nothing to record beyond the model itself, as all we do is
+    // check progress
+    m_pendingModelChanges[modelId];
+    scheduleModelChanges();
+}
+
+void
+View::scheduleModelChanges()
+{
+    if (!m_modelChangeTimer) {
+        m_modelChangeTimer = new QTimer(this);
+        m_modelChangeTimer->setSingleShot(true);
+        connect(m_modelChangeTimer, SIGNAL(timeout()),
+                this, SLOT(flushModelChanges()));
+    }
+
+    // Not restarted if already running, so that a steady stream of
+    // changes is still flushed at the full rate
+    if (!m_modelChangeTimer->isActive()) {
+        m_modelChangeTimer->start(modelChangeInterval);
+    }
+}
+
+void
+View::flushModelChanges()
+{
+    PendingModelChangeMap changes;
+    changes.swap(m_pendingModelChanges);
+
+    bool updateAll = false;
+    QRect updateRect;
+
+    for (const auto &c: changes) {
+
+        ModelId modelId = c.first;
+        const PendingModelChange &change = c.second;
+
+        if (change.whole) {
+            applyModelChanged(modelId, updateAll);
+        } else if (change.haveRange) {
+            applyModelChangedWithin(modelId,
+                                    change.startFrame, change.endFrame,
+                                    updateAll, updateRect);
+        }
+
+        checkProgress(modelId);
+    }
+
+    if (updateAll) {
+        scheduleUpdate(QRect());
+    } else if (!updateRect.isNull()) {
+        scheduleUpdate(updateRect);
+    }
+
+    if (!m_layersReadyCallbacks.empty()) {
+        checkLayersReady();
+    }
+}
+
+void
+View::scheduleUpdate(QRect r)
+{
+    if (m_manager) {
+        m_manager->getRenderScheduler()->requestUpdate(this, r);
+    } else if (r.isNull()) {
+        update();
+    } else {
+        update(r);
+    }
+}
+
+void
+View::updatePaintRect(QRect r)
+{
+    if (r.isEmpty()) return;
+    scheduleUpdate(r);
+}
+
+double
+View::getRenderTimeScale() const
+{
+    if (!m_manager) return 1.0;
+    return m_manager->getRenderScheduler()->getRenderTimeScale(this);
+}
+
+void
+View::applyModelChanged(ModelId modelId, bool &updateAll)
+{
     // If the model that has changed is not used by any of the cached
     // layers, we won't need to recreate the cache
     
@@ -1152,35 +1292,35 @@ View::modelChanged(ModelId modelId)
 
     emit layerModelChanged();
 
-    checkProgress(modelId);
-
-    update();
+    updateAll = true;
 }
 
 void
-View::modelChangedWithin(ModelId modelId,
-                         sv_frame_t startFrame, sv_frame_t endFrame)
+View::applyModelChangedWithin(ModelId modelId,
+                              sv_frame_t startFrame, sv_frame_t endFrame,
+                              bool &updateAll, QRect &updateRect)
 {
     sv_frame_t myStartFrame = getStartFrame();
     sv_frame_t myEndFrame = getEndFrame();
 
 #ifdef DEBUG_VIEW_WIDGET_PAINT
-    SVCERR << "View[" << getId() << "]::modelChangedWithin(" << startFrame << "," << endFrame << ") [me " << myStartFrame << "," << myEndFrame << "]" << endl;
+    SVCERR << "View[" << getId() << "]::applyModelChangedWithin(" << startFrame << "," << endFrame << ") [me " << myStartFrame << "," << myEndFrame << "]" << endl;
 #endif
 
     if (myStartFrame > 0 && endFrame < myStartFrame) {
-        checkProgress(modelId);
         return;
     }
     if (startFrame > myEndFrame) {
-        checkProgress(modelId);
         return;
     }
 
     // If the model that has changed is not used by any of the cached
-    // layers, we won't need to recreate the cache
+    // layers, we won't need to recreate the cache. If all of the
+    // layers that use it draw only around the frames that changed,
+    // we need to recreate only that part of it
     
     bool recreate = false;
+    bool localised = true;
 
     bool discard;
     LayerList scrollables = getScrollableBackLayers(false, discard);
@@ -1188,29 +1328,55 @@ View::modelChangedWithin(ModelId modelId,
          i != scrollables.end(); ++i) {
         if ((*i)->getModel() == modelId) {
             recreate = true;
-            break;
+            if (!(*i)->isModelChangeLocalised()) {
+                localised = false;
+            }
         }
     }
 
-    if (recreate) {
-        m_cacheValid = false;
+    LayerList nonScrollables = getNonScrollableFrontLayers(false, discard);
+    for (LayerList::const_iterator i = nonScrollables.begin();
+         i != nonScrollables.end(); ++i) {
+        if ((*i)->getModel() == modelId) {
+            localised = false;
+            break;
+        }
     }
 
     if (startFrame < myStartFrame) startFrame = myStartFrame;
     if (endFrame > myEndFrame) endFrame = myEndFrame;
 
-    checkProgress(modelId);
+    if (!recreate || !localised) {
+        if (recreate) {
+            m_cacheValid = false;
+        }
+        updateAll = true;
+        return;
+    }
 
-    update();
-}    
+    // A frame of margin either side, for layers that join adjacent
+    // samples (which at pixels-per-frame zoom may be many pixels
+    // apart), plus a pixel for their line width
+    int x0 = getXForFrame(startFrame - 1) - 1;
+    int x1 = getXForFrame(endFrame + 2) + 1;
 
-void
-View::modelCompletionChanged(ModelId modelId)
-{
-#ifdef DEBUG_PROGRESS_STUFF
-    SVCERR << "View[" << getId() << "]::modelCompletionChanged(" << modelId << ")" << endl;
+#ifdef DEBUG_VIEW_WIDGET_PAINT
+    SVCERR << "View[" << getId() << "]::applyModelChangedWithin: repainting x "
+           << x0 << " to " << x1 << " only" << endl;
 #endif
-    checkProgress(modelId);
+
+    if (m_cacheValid) {
+        if (m_cacheHasStaleRange) {
+            m_cacheStaleStart = std::min(m_cacheStaleStart, startFrame);
+            m_cacheStaleEnd = std::max(m_cacheStaleEnd, endFrame);
+        } else {
+            m_cacheStaleStart = startFrame;
+            m_cacheStaleEnd = endFrame;
+            m_cacheHasStaleRange = true;
+        }
+    }
+
+    updateRect = updateRect.united(QRect(x0, 0, x1 - x0 + 1, height()));
 }
 
 void
@@ -1263,6 +1429,13 @@ View::layerMeasurementRectsChanged()
     if (layer) update();
 }
 
+void
+View::layerFeatureDescriptionChanged()
+{
+    Layer *layer = dynamic_cast<Layer *>(sender());
+    if (layer) update();
+}
+
 void
 View::layerNameChanged()
 {
@@ -1993,11 +2166,6 @@ View::checkProgress(ModelId modelId)
     SVCERR << "View[" << getId() << "]::checkProgress(" << modelId << ")" << endl;
 #endif
 
-    QSettings settings;
-    settings.beginGroup("View");
-    bool showCancelButton = settings.value("showcancelbuttons", true).toBool();
-    settings.endGroup();
-    
     int ph = height();
     bool found = false;
 
@@ -2065,6 +2233,14 @@ View::checkProgress(ModelId modelId)
                 
             } else {
 
+                // Only read when there is a progress bar to show, as
+                // we are called on every model change
+                QSettings settings;
+                settings.beginGroup("View");
+                bool showCancelButton =
+                    settings.value("showcancelbuttons", true).toBool();
+                settings.endGroup();
+    
                 if (!pb->isVisible()) {
                     i->second.lastStallCheckValue = 0;
                     timer->setInterval(2000);
@@ -2262,6 +2438,9 @@ View::paintEvent(QPaintEvent *e)
 {
 //    Profiler prof("View::paintEvent", false);
 
+    QElapsedTimer paintTimer;
+    paintTimer.start();
+
     QFrame::paintEvent(e);
 
 #ifdef DEBUG_VIEW_WIDGET_PAINT
@@ -2393,11 +2572,14 @@ View::paintEvent(QPaintEvent *e)
                     m_cache = new QImage(wholeSize, QImage::Format_ARGB32_Premultiplied);
                 }
 
+                m_cacheOrigin = 0;
+
 #ifdef DEBUG_VIEW_WIDGET_PAINT
                 SVCERR << "View[" << getId() << "]::paintEvent: cache is invalid, will repaint whole" << endl;
 #endif
             }
 
+            m_cacheHasStaleRange = false;
             count.miss();
             
         } else if (m_cacheCentreFrame != m_centreFrame) {
@@ -2409,17 +2591,15 @@ View::paintEvent(QPaintEvent *e)
             int dx = dpratio * (getXForFrame(m_cacheCentreFrame) -
                                 getXForFrame(m_centreFrame));
 
-            if (dx > -m_cache->width() && dx < m_cache->width()) {
+            int cw = m_cache->width();
+
+            if (dx > -cw && dx < cw) {
+
+                // What was at view column x - dx is now to appear at
+                // x, so moving the origin back by dx scrolls the whole
+                // cache without touching any pixels
+                m_cacheOrigin = ((m_cacheOrigin - dx) % cw + cw) % cw;
 
-                int mx0 = std::max(0, -dx);
-                int mx1 = std::max(0, dx);
-                int mw = m_cache->width() - std::max(dx, -dx);
-                
-                for (int row = 0; row < m_cache->height(); ++row) {
-                    QRgb *sl = reinterpret_cast<QRgb *>(m_cache->scanLine(row));
-                    breakfastquay::v_move(sl + mx1, sl + mx0, mw);
-                }
-                
                 if (dx < 0) {
                     cacheAreaToRepaint = 
                         QRect(m_cache->width() + dx, 0, -dx, m_cache->height());
@@ -2434,12 +2614,19 @@ View::paintEvent(QPaintEvent *e)
                 SVCERR << "View[" << getId() << "]::paintEvent: scrolled cache by " << dx << endl;
 #endif
             } else {
+                m_cacheOrigin = 0;
                 count.miss();
 #ifdef DEBUG_VIEW_WIDGET_PAINT
                 SVCERR << "View[" << getId() << "]::paintEvent: scrolling too far" << endl;
 #endif
             }
 
+        } else if (m_cacheHasStaleRange) {
+#ifdef DEBUG_VIEW_WIDGET_PAINT
+            SVCERR << "View[" << getId() << "]::paintEvent: cache is good apart from frames " << m_cacheStaleStart << " to " << m_cacheStaleEnd << endl;
+#endif
+            cacheAreaToRepaint = QRect();
+            count.partial();
         } else {
 #ifdef DEBUG_VIEW_WIDGET_PAINT
             SVCERR << "View[" << getId() << "]::paintEvent: cache is good" << endl;
@@ -2447,6 +2634,24 @@ View::paintEvent(QPaintEvent *e)
             count.hit();
             shouldRepaintCache = false;
         }
+
+        if (shouldRepaintCache && m_cacheHasStaleRange &&
+            cacheAreaToRepaint != wholeArea) {
+            // Part of an otherwise valid cache is out of date because
+            // the model changed there: add that part (as it appears
+            // now, after any scroll) to the area to repaint
+            // with the same margins as in applyModelChangedWithin
+            int x0 = getXForFrame(m_cacheStaleStart - 1) - 1;
+            int x1 = getXForFrame(m_cacheStaleEnd + 2) + 1;
+            QRect stale(scaledRect(QRect(x0, 0, x1 - x0 + 1, height()),
+                                   dpratio));
+            cacheAreaToRepaint = cacheAreaToRepaint.united(stale & wholeArea);
+            if (cacheAreaToRepaint.isEmpty()) {
+                // It has since scrolled out of view
+                m_cacheHasStaleRange = false;
+                shouldRepaintCache = false;
+            }
+        }
     }
 
 #ifdef DEBUG_VIEW_WIDGET_PAINT
@@ -2497,7 +2702,10 @@ View::paintEvent(QPaintEvent *e)
 
     if (shouldRepaintCache) {
         paint.begin(m_cache);
-        paint.fillRect(cacheAreaToRepaint, getBackground());
+        for (const auto &seg: getCacheSegments(cacheAreaToRepaint)) {
+            paint.fillRect(seg.viewRect.translated(seg.offset, 0),
+                           getBackground());
+        }
         paint.end();
     } else {
         paint.begin(m_buffer);
@@ -2506,7 +2714,8 @@ View::paintEvent(QPaintEvent *e)
     }
 
     auto paintLayer = [&](Layer *layer, QImage *target,
-                          QRect area, bool enforceClipping) {
+                          QRect area, bool enforceClipping,
+                          int xoffset) {
         
         bool useAligningProxy = false;
         if (m_useAligningProxy) {
@@ -2522,6 +2731,9 @@ View::paintEvent(QPaintEvent *e)
 
         QPainter p(target);
         p.setRenderHint(QPainter::Antialiasing, false);
+        if (xoffset != 0) {
+            p.translate(xoffset, 0);
+        }
         if (enforceClipping) {
             p.setClipRect(area);
         }
@@ -2538,24 +2750,43 @@ View::paintEvent(QPaintEvent *e)
         // don't have a very precise idea about e.g. parts of text
         // labels which overlay an area. We pass the area to the paint
         // function anyway, so if clipping matters to it, it should
-        // enable it itself
+        // enable it itself.
+        //
+        // The exception is where the cache wraps, as anything painted
+        // past the wrap point would land at the far side of the
+        // view. A clip rect is not enough there, since layers may
+        // switch clipping off or widen it to draw labels, so each
+        // side is painted through an image covering only that side's
+        // columns of the cache, whose own bounds do the clipping
         if (shouldRepaintCache) {
-            paintLayer(layer, m_cache, cacheAreaToRepaint, false);
+            for (const auto &seg: getCacheSegments(cacheAreaToRepaint)) {
+                if (m_cacheOrigin == 0) {
+                    paintLayer(layer, m_cache, seg.viewRect, false, 0);
+                } else {
+                    QImage side(getCacheSegmentImage(seg));
+                    paintLayer(layer, &side, seg.viewRect, false,
+                               -seg.extent.x());
+                }
+            }
         } else {
-            paintLayer(layer, m_buffer, requestedPaintArea, false);
+            paintLayer(layer, m_buffer, requestedPaintArea, false, 0);
         }
     }
 
     if (shouldRepaintCache) {
         // and now we have
         m_cacheValid = true;
+        m_cacheHasStaleRange = false;
         m_cacheCentreFrame = m_centreFrame;
         m_cacheZoomLevel = m_zoomLevel;
     }
 
     if (shouldUseCache) {
         paint.begin(m_buffer);
-        paint.drawImage(requestedPaintArea, *m_cache, requestedPaintArea);
+        for (const auto &seg: getCacheSegments(requestedPaintArea)) {
+            paint.drawImage(seg.viewRect, *m_cache,
+                            seg.viewRect.translated(seg.offset, 0));
+        }
         paint.end();
     }
 
@@ -2568,7 +2799,7 @@ View::paintEvent(QPaintEvent *e)
     }
 
     for (auto layer : nonScrollables) {
-        paintLayer(layer, m_buffer, requestedPaintArea, true);
+        paintLayer(layer, m_buffer, requestedPaintArea, true, 0);
     }
         
     // Now paint to widget from buffer: target rects from here on,
@@ -2579,7 +2810,11 @@ View::paintEvent(QPaintEvent *e)
     if (e) paint.setClipRect(e->rect());
 
     QRect finalPaintRect = e ? e->rect() : rect();
-    paint.setRenderHint(QPainter::SmoothPixmapTransform);
+    if (dpratio != 1) {
+        // Only when the buffer is at a different resolution from the
+        // widget; otherwise this is a straight copy
+        paint.setRenderHint(QPainter::SmoothPixmapTransform);
+    }
     paint.drawImage(finalPaintRect, *m_buffer, 
                     scaledRect(finalPaintRect, dpratio));
 
@@ -2587,6 +2822,46 @@ View::paintEvent(QPaintEvent *e)
     drawPlayPointer(paint);
 
     paint.end();
+
+    if (m_manager) {
+        m_manager->getRenderScheduler()->reportPaintTime
+            (this, double(paintTimer.nsecsElapsed()) / 1.0e9);
+    }
+}
+
+std::vector<View::CacheSegment>
+View::getCacheSegments(QRect viewRect) const
+{
+    std::vector<CacheSegment> segments;
+    if (!m_cache) return segments;
+
+    int w = m_cache->width();
+    int h = m_cache->height();
+
+    // View x at which the cache wraps back round to column 0
+    int wrap = w - m_cacheOrigin;
+
+    QRect left(0, 0, wrap, h);
+    QRect right(wrap, 0, w - wrap, h);
+    
+    if (viewRect.intersects(left)) {
+        segments.push_back({ viewRect & left, left, m_cacheOrigin });
+    }
+    if (viewRect.intersects(right)) {
+        segments.push_back({ viewRect & right, right, m_cacheOrigin - w });
+    }
+
+    return segments;
+}
+
+QImage
+View::getCacheSegmentImage(const CacheSegment &seg)
+{
+    // Shares the cache's pixels: painting on it paints on the cache
+    int cacheX = seg.extent.x() + seg.offset;
+    uchar *data = m_cache->scanLine(0) + cacheX * sizeof(QRgb);
+    return QImage(data, seg.extent.width(), seg.extent.height(),
+                  m_cache->bytesPerLine(), m_cache->format());
 }
 
 void
@@ -3019,69 +3294,147 @@ View::drawMeasurementRect(QPainter &paint, const Layer *topLayer, QRect r,
     paint.restore();
 }
 
-bool
-View::waitForLayersToBeReady()
+int
+View::getLayerCompletion()
 {
-    bool someLayersIncomplete = false;
+    int completion = 100;
 
+    for (Layer *layer: m_layerStack) {
+        int c = layer->getCompletion(this);
 #ifdef DEBUG_VIEW
-    SVDEBUG << "View::waitForLayersToBeReady: checking completion" << endl;
+        SVDEBUG << "layer " << layer->getLayerPresentationName() << " says "
+                << c << endl;
 #endif
-    
-    for (LayerList::iterator i = m_layerStack.begin();
-         i != m_layerStack.end(); ++i) {
+        if (c < completion) {
+            completion = c;
+        }
+    }
 
-        int c = (*i)->getCompletion(this);
+    return completion;
+}
+
+int
+View::whenLayersReady(LayersReadyCallback callback)
+{
+    int id = m_nextLayersReadyId++;
+    m_layersReadyCallbacks[id] = callback;
+
+    if (!m_layersReadyFallbackTimer) {
+        m_layersReadyFallbackTimer = new QTimer(this);
+        connect(m_layersReadyFallbackTimer, SIGNAL(timeout()),
+                this, SLOT(checkLayersReady()));
+    }
+    if (!m_layersReadyFallbackTimer->isActive()) {
+        m_lastLayerCompletion = getLayerCompletion();
+        m_layersReadyFallbackTimer->start(layersReadyFallbackInterval);
+    }
+
+    // Always from the event loop, even if we are ready already, so
+    // that the caller sees the same order of events either way
+    QMetaObject::invokeMethod(this, "checkLayersReady", Qt::QueuedConnection);
+
+    return id;
+}
+
+void
+View::cancelWaitingForLayers(int id)
+{
+    auto itr = m_layersReadyCallbacks.find(id);
+    if (itr == m_layersReadyCallbacks.end()) return;
+
+    LayersReadyCallback callback = itr->second;
+    m_layersReadyCallbacks.erase(itr);
+
+    if (m_layersReadyCallbacks.empty() && m_layersReadyFallbackTimer) {
+        m_layersReadyFallbackTimer->stop();
+    }
+
+    callback(false);
+}
+
+void
+View::checkLayersReady()
+{
+    if (m_layersReadyCallbacks.empty()) return;
+
+    int completion = getLayerCompletion();
 
 #ifdef DEBUG_VIEW
-        SVDEBUG << "layer " << (*i)->getLayerPresentationName() << " says "
-                << c << endl;
+    SVDEBUG << "View::checkLayersReady: completion = " << completion << endl;
 #endif
-        
-        if (c < 100) {
-            someLayersIncomplete = true;
-            break;
+
+    if (completion < 100) {
+        if (completion != m_lastLayerCompletion) {
+            m_lastLayerCompletion = completion;
+            emit layerCompletionChanged(completion);
         }
+        return;
     }
 
-    if (someLayersIncomplete) {
+    m_lastLayerCompletion = 100;
+    m_layersReadyFallbackTimer->stop();
 
-        QProgressDialog progress(tr("Waiting for layers to be ready..."),
-                                 tr("Cancel"), 0, 100, this);
-        
-        int layerCompletion = 0;
+    // A callback may add a new wait, or cancel another, so take the
+    // whole set out before calling any of them
+    std::map<int, LayersReadyCallback> callbacks;
+    callbacks.swap(m_layersReadyCallbacks);
+
+    for (auto &c: callbacks) {
+        c.second(true);
+    }
+}
 
-        while (layerCompletion < 100) {
+bool
+View::waitForLayersToBeReady()
+{
+    // The synchronous form, for the export functions. Rather than
+    // polling, we run a local event loop until whenLayersReady tells
+    // us the layers are complete or the user cancels
 
+    if (getLayerCompletion() >= 100) {
 #ifdef DEBUG_VIEW
-            SVDEBUG << "View::render: checking completion (again)" << endl;
+        SVDEBUG << "View::waitForLayersToBeReady: ok, we're ready" << endl;
 #endif
-    
-            for (LayerList::iterator i = m_layerStack.begin();
-                 i != m_layerStack.end(); ++i) {
+        return true;
+    }
 
-                int c = (*i)->getCompletion(this);
-                if (i == m_layerStack.begin() || c < layerCompletion) {
-                    layerCompletion = c;
-                }
+    // The dialog is a child of ours, so it goes on the heap in case
+    // we are deleted while the loop runs, and we must not touch
+    // ourselves afterwards if we were
+    QPointer<View> self(this);
+    QPointer<QProgressDialog> progress =
+        new QProgressDialog(tr("Waiting for layers to be ready..."),
+                            tr("Cancel"), 0, 100, this);
+    progress->setValue(getLayerCompletion());
 
-#ifdef DEBUG_VIEW
-                SVDEBUG << "layer " << (*i)->getLayerPresentationName() << " says "
-                        << c << ", layerCompletion now " << layerCompletion << endl;
-#endif
-            }
+    QEventLoop loop;
+    bool ready = false;
 
-            if (layerCompletion >= 100) break;
+    connect(this, SIGNAL(layerCompletionChanged(int)),
+            progress, SLOT(setValue(int)));
+    connect(progress, SIGNAL(canceled()), &loop, SLOT(quit()));
+    connect(this, SIGNAL(destroyed()), &loop, SLOT(quit()));
 
-            progress.setValue(layerCompletion);
-            qApp->processEvents();
-            if (progress.wasCanceled()) {
-                update();
-                return false;
-            }
+    int id = whenLayersReady([&](bool r) {
+                                 ready = r;
+                                 loop.quit();
+                             });
 
-            usleep(50000);
-        }
+    loop.exec();
+
+    if (!self) {
+        return false;
+    }
+
+    delete progress;
+
+    // No effect if the callback has already been called, but if we
+    // were cancelled, it must not be called once we have returned
+    cancelWaitingForLayers(id);
+
+    if (!ready) {
+        update();
+        return false;
     }
 
 #ifdef DEBUG_VIEW
@@ -3091,6 +3444,47 @@ View::waitForLayersToBeReady()
     return true;
 }
 
+int
+View::renderToNewImageWhenReady(ImageRenderedCallback callback)
+{
+    // The model extents are taken when the layers are ready, as they
+    // may still be growing now
+    return whenLayersReady([this, callback](bool ready) {
+                               callback(ready ? renderToNewImage() : nullptr);
+                           });
+}
+
+int
+View::renderPartToNewImageWhenReady(sv_frame_t f0, sv_frame_t f1,
+                                    ImageRenderedCallback callback)
+{
+    return whenLayersReady([this, f0, f1, callback](bool ready) {
+                               callback(ready ?
+                                        renderPartToNewImage(f0, f1) :
+                                        nullptr);
+                           });
+}
+
+int
+View::renderToSvgFileWhenReady(QString filename,
+                               SvgRenderedCallback callback)
+{
+    return whenLayersReady([this, filename, callback](bool ready) {
+                               callback(ready && renderToSvgFile(filename));
+                           });
+}
+
+int
+View::renderPartToSvgFileWhenReady(QString filename,
+                                   sv_frame_t f0, sv_frame_t f1,
+                                   SvgRenderedCallback callback)
+{
+    return whenLayersReady([this, filename, f0, f1, callback](bool ready) {
+                               callback(ready &&
+                                        renderPartToSvgFile(filename, f0, f1));
+                           });
+}
+
 bool
 View::render(QPainter &paint, int xorigin, sv_frame_t f0, sv_frame_t f1)
 {
@@ -35,6 +35,8 @@ class QPushButton;
 
 #include <map>
 #include <set>
+#include <vector>
+#include <functional>
 
 namespace sv {
 
@@ -319,6 +321,35 @@ public:
     virtual const PropertyContainer *getPropertyContainer(int i) const;
     virtual PropertyContainer *getPropertyContainer(int i);
 
+    /**
+     * Return the lowest completion percentage reported by any layer
+     * in this view, or 100 if all are complete or there are no layers.
+     */
+    int getLayerCompletion();
+
+    typedef std::function<void(bool ready)> LayersReadyCallback;
+
+    /**
+     * Arrange for the given callback to be called, without blocking,
+     * once every layer in the view reports itself complete. The check
+     * is made whenever a layer's model reports a change in completion
+     * or a layer is removed, so the callback runs as soon as the
+     * layers are ready. If they are ready already, the callback is
+     * called from the event loop rather than before this returns.
+     *
+     * The callback receives true if the layers are ready, or false
+     * if the wait was cancelled through cancelWaitingForLayers(). It
+     * is not called at all if the view is deleted first. The returned
+     * id identifies the wait for cancelWaitingForLayers().
+     */
+    int whenLayersReady(LayersReadyCallback callback);
+
+    /**
+     * Cancel a wait set up by whenLayersReady(), calling its callback
+     * with false. Does nothing if the callback has already been called.
+     */
+    void cancelWaitingForLayers(int id);
+
     /** 
      * Render the view contents to a new QImage (which may be wider
      * than the visible View).
@@ -355,6 +386,34 @@ public:
     virtual bool renderPartToSvgFile(QString filename,
                                      sv_frame_t f0, sv_frame_t f1);
 
+    typedef std::function<void(QImage *)> ImageRenderedCallback;
+    typedef std::function<void(bool ok)> SvgRenderedCallback;
+
+    /**
+     * As renderToNewImage() and renderPartToNewImage(), but without
+     * waiting for incomplete layers: these return at once, and render
+     * once the layers are ready (see whenLayersReady()), passing the
+     * new image to the callback. The callback takes ownership of the
+     * image, which is nullptr if the wait was cancelled or rendering
+     * failed. The return value identifies the wait for
+     * cancelWaitingForLayers().
+     */
+    int renderToNewImageWhenReady(ImageRenderedCallback callback);
+    int renderPartToNewImageWhenReady(sv_frame_t f0, sv_frame_t f1,
+                                      ImageRenderedCallback callback);
+
+    /**
+     * As renderToSvgFile() and renderPartToSvgFile(), but without
+     * waiting for incomplete layers, as for renderToNewImageWhenReady().
+     * The callback receives the result of the render, or false if the
+     * wait was cancelled.
+     */
+    int renderToSvgFileWhenReady(QString filename,
+                                 SvgRenderedCallback callback);
+    int renderPartToSvgFileWhenReady(QString filename,
+                                     sv_frame_t f0, sv_frame_t f1,
+                                     SvgRenderedCallback callback);
+
     /**
      * Return the visible vertical extents for the given unit, if any.
      * Overridden from LayerGeometryProvider (see docs there).
@@ -416,7 +475,13 @@ public:
     sv_frame_t alignToReference(sv_frame_t) const;
     sv_frame_t getAlignedPlaybackFrame() const;
 
-    void updatePaintRect(QRect r) override { update(r); }
+    /**
+     * Schedule a repaint of the given rect through the view manager's
+     * RenderScheduler, if there is one, or else update it directly.
+     */
+    void updatePaintRect(QRect r) override;
+
+    double getRenderTimeScale() const override;
 
     int getScaleFactor() const override { return 1; } // See ViewProxy
     
@@ -444,6 +509,12 @@ signals:
 
     void contextHelpChanged(const QString &);
 
+    /**
+     * Emitted, while any whenLayersReady() wait is outstanding, when
+     * the lowest layer completion (see getLayerCompletion()) changes.
+     */
+    void layerCompletionChanged(int completion);
+
 public slots:
     virtual void modelChanged(ModelId);
     virtual void modelChangedWithin(ModelId, sv_frame_t startFrame, sv_frame_t endFrame);
@@ -453,6 +524,7 @@ public slots:
     virtual void layerParametersChanged();
     virtual void layerParameterRangesChanged();
     virtual void layerMeasurementRectsChanged();
+    virtual void layerFeatureDescriptionChanged();
     virtual void layerNameChanged();
 
     virtual void globalCentreFrameChanged(sv_frame_t);
@@ -481,6 +553,10 @@ public slots:
 
     virtual void progressCheckStalledTimerElapsed();
 
+    virtual void flushModelChanges();
+
+    virtual void checkLayersReady();
+
 protected:
     View(QWidget *, bool showProgress);
 
@@ -538,6 +614,18 @@ protected:
     void checkAlignmentProgress(ModelId);
 
     bool waitForLayersToBeReady(); // returns false if user cancelled waiting
+
+    // Outstanding whenLayersReady() waits, by id. These are checked
+    // whenever a layer reports a change of model completion. Every
+    // layer in this library takes its completion from a model that
+    // signals it (SpectrogramLayer passes on its FFT model's), so
+    // the fallback timer is only a slow safety net for a layer that
+    // doesn't, and runs only while there are waits outstanding
+    std::map<int, LayersReadyCallback> m_layersReadyCallbacks;
+    int                 m_nextLayersReadyId;
+    int                 m_lastLayerCompletion;
+    QTimer             *m_layersReadyFallbackTimer;
+    static const int    layersReadyFallbackInterval = 2000; // ms
     
     int getProgressBarWidth() const; // if visible
 
@@ -558,10 +646,57 @@ protected:
     QImage             *m_buffer;
     
     bool                m_cacheValid;
+    bool                m_cacheHasStaleRange; // within an otherwise valid cache
+    sv_frame_t          m_cacheStaleStart;
+    sv_frame_t          m_cacheStaleEnd;
     sv_frame_t          m_cacheCentreFrame;
     ZoomLevel           m_cacheZoomLevel;
     bool                m_selectionCached;
 
+    // The cache wraps around horizontally: view column x (at scaled
+    // resolution) is held in cache column (x + m_cacheOrigin) modulo
+    // the cache width, so that scrolling moves only the origin and
+    // leaves just the newly exposed columns to be painted
+    int                 m_cacheOrigin;
+
+    struct CacheSegment {
+        QRect viewRect; // in scaled view coordinates
+        QRect extent;   // all of the view on this side of the wrap
+        int offset;     // add to a view x to get the cache x
+    };
+
+    // Split a rect in scaled view coordinates at the point where the
+    // cache wraps, returning the non-empty parts on either side
+    std::vector<CacheSegment> getCacheSegments(QRect viewRect) const;
+
+    // An image sharing the cache's pixels for the columns on one side
+    // of the wrap point, so that painting can't stray past it
+    QImage getCacheSegmentImage(const CacheSegment &seg);
+
+    // Model change notifications are gathered here and acted on
+    // together, at most once per modelChangeInterval ms, so that a
+    // model being written rapidly costs no more than one repaint per
+    // display frame
+    struct PendingModelChange {
+        PendingModelChange() :
+            whole(false), haveRange(false), startFrame(0), endFrame(0) { }
+        bool whole;
+        bool haveRange;
+        sv_frame_t startFrame;
+        sv_frame_t endFrame;
+    };
+    typedef std::map<ModelId, PendingModelChange> PendingModelChangeMap;
+    PendingModelChangeMap m_pendingModelChanges;
+    QTimer             *m_modelChangeTimer;
+    static const int    modelChangeInterval = 16;
+
+    void scheduleModelChanges();
+    void scheduleUpdate(QRect r); // null rect for whole view
+    void applyModelChanged(ModelId, bool &updateAll);
+    void applyModelChangedWithin(ModelId, sv_frame_t startFrame,
+                                 sv_frame_t endFrame,
+                                 bool &updateAll, QRect &updateRect);
+
     bool                m_deleting;
 
     LayerList           m_layerStack; // I don't own these, but see dtor note above
@@ -0,0 +1,408 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+    Sonic Visualiser
+    An audio file viewer and annotation editor.
+    Centre for Digital Music, Queen Mary, University of London.
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation; either version 2 of the
+    License, or (at your option) any later version.  See the file
+    COPYING included with this distribution for more information.
+*/
+
+#include "ViewGeometrySnapshot.h"
+
+#include "View.h"
+#include "layer/Layer.h"
+#include "data/model/AlignmentModel.h"
+
+#include "base/Debug.h"
+
+#include <QThread>
+#include <QMetaObject>
+
+#include <cmath>
+#include <climits>
+
+namespace sv {
+
+ViewGeometrySnapshot::ViewGeometrySnapshot(View *view, int scaleFactor,
+                                           ModelId alignment) :
+    m_view(view),
+    m_manager(view->getViewManager()),
+    m_id(view->getId()),
+    m_scaleFactor(scaleFactor),
+    m_alignmentId(alignment),
+    m_centreFrame(view->getCentreFrame()),
+    m_zoomLevel(view->getZoomLevel()),
+    m_width(view->width()),
+    m_height(view->height()),
+    m_paintRect(view->getPaintRect()),
+    m_modelsStartFrame(view->getModelsStartFrame()),
+    m_modelsEndFrame(view->getModelsEndFrame()),
+    m_lightBackground(view->hasLightBackground()),
+    m_foreground(view->getForeground()),
+    m_background(view->getBackground()),
+    m_showFeatureLabels(view->shouldShowFeatureLabels()),
+    m_illuminatedLayer(nullptr),
+    m_sizeRatio(view->scaleSize(1.0)),
+    m_labelBaseY(view->scalePixelSize(15)),
+    m_renderTimeScale(view->getRenderTimeScale())
+{
+    auto tables = std::make_shared<Tables>();
+
+    tables->alignment = ModelById::getAs<AlignmentModel>(alignment);
+
+    std::map<int, const Layer *> sortedLabelledLayers;
+
+    for (int i = 0; i < view->getLayerCount(); ++i) {
+
+        const Layer *layer = view->getLayer(i);
+        if (!layer) continue;
+
+        double min, max;
+        bool log;
+        QString unit;
+        if (layer->getValueExtents(min, max, log, unit)) {
+            QString key = unit.toLower();
+            if (tables->extents.find(key) == tables->extents.end()) {
+                Extents e;
+                if (view->getVisibleExtentsForUnit(unit, e.min, e.max, e.log)) {
+                    tables->extents[key] = e;
+                }
+            }
+        }
+
+        if (layer->needsTextLabelHeight()) {
+            sortedLabelledLayers[layer->getExportId()] = layer;
+        }
+
+        QPoint point;
+        if (!m_illuminatedLayer &&
+            view->shouldIlluminateLocalFeatures(layer, point)) {
+            m_illuminatedLayer = layer;
+            m_illuminationPoint = point;
+        }
+    }
+
+    for (const auto &p: sortedLabelledLayers) {
+        tables->labelledLayers.push_back(p.second);
+    }
+
+    m_tables = tables;
+}
+
+sv_frame_t
+ViewGeometrySnapshot::alignToReference(sv_frame_t frame) const
+{
+    if (m_tables->alignment) {
+        return m_tables->alignment->toReference(frame);
+    } else {
+        return frame;
+    }
+}
+
+sv_frame_t
+ViewGeometrySnapshot::alignFromReference(sv_frame_t frame) const
+{
+    if (m_tables->alignment) {
+        return m_tables->alignment->fromReference(frame);
+    } else {
+        return frame;
+    }
+}
+
+int
+ViewGeometrySnapshot::getViewXForFrame(sv_frame_t frame) const
+{
+    // The same arithmetic as View::getXForFrame, which see
+
+    sv_frame_t level = m_zoomLevel.level;
+    sv_frame_t fdiff = frame - m_centreFrame;
+
+    bool inRange = false;
+    if (m_zoomLevel.zone == ZoomLevel::FramesPerPixel) {
+        inRange = ((fdiff / level) < sv_frame_t(INT_MAX) &&
+                   (fdiff / level) > sv_frame_t(INT_MIN));
+    } else {
+        inRange = (fdiff < sv_frame_t(INT_MAX) / level &&
+                   fdiff > sv_frame_t(INT_MIN) / level);
+    }
+
+    if (!inRange) {
+        SVCERR << "ERROR: Frame " << frame
+               << " is out of range in ViewGeometrySnapshot::getXForFrame"
+               << endl;
+        return 0;
+    }
+
+    sv_frame_t adjusted;
+
+    if (m_zoomLevel.zone == ZoomLevel::FramesPerPixel) {
+        sv_frame_t roundedCentreFrame = (m_centreFrame / level) * level;
+        fdiff = frame - roundedCentreFrame;
+        adjusted = fdiff / level;
+        if ((fdiff < 0) && ((fdiff % level) != 0)) {
+            --adjusted; // round to the left
+        }
+    } else {
+        adjusted = fdiff * level;
+    }
+
+    adjusted = adjusted + (m_width/2);
+
+    if (adjusted > INT_MAX || adjusted < INT_MIN) {
+        SVCERR << "ERROR: Frame " << frame
+               << " is out of range in ViewGeometrySnapshot::getXForFrame"
+               << endl;
+        return 0;
+    }
+
+    return int(adjusted);
+}
+
+sv_frame_t
+ViewGeometrySnapshot::getFrameForViewX(int x) const
+{
+    // The same arithmetic as View::getFrameForX, which see
+
+    int diff = x - (m_width/2);
+    sv_frame_t level = m_zoomLevel.level;
+    sv_frame_t fdiff;
+
+    if (m_zoomLevel.zone == ZoomLevel::FramesPerPixel) {
+        sv_frame_t roundedCentreFrame = (m_centreFrame / level) * level;
+        fdiff = diff * level;
+        return fdiff + roundedCentreFrame;
+    } else {
+        fdiff = diff / level;
+        if ((diff < 0) && ((diff % level) != 0)) {
+            --fdiff; // round to the left
+        }
+        return fdiff + m_centreFrame;
+    }
+}
+
+sv_frame_t
+ViewGeometrySnapshot::getStartFrame() const
+{
+    return alignToReference(getFrameForViewX(0));
+}
+
+sv_frame_t
+ViewGeometrySnapshot::getCentreFrame() const
+{
+    return alignToReference(m_centreFrame);
+}
+
+sv_frame_t
+ViewGeometrySnapshot::getEndFrame() const
+{
+    return alignToReference(getFrameForViewX(m_width) - 1);
+}
+
+int
+ViewGeometrySnapshot::getXForFrame(sv_frame_t frame) const
+{
+    return m_scaleFactor * getViewXForFrame(alignFromReference(frame));
+}
+
+sv_frame_t
+ViewGeometrySnapshot::getFrameForX(int x) const
+{
+    sv_frame_t f0 = getFrameForViewX(x / m_scaleFactor);
+    if (m_scaleFactor == 1) return alignToReference(f0);
+    sv_frame_t f1 = getFrameForViewX((x / m_scaleFactor) + 1);
+    sv_frame_t f = f0 + ((f1 - f0) * (x % m_scaleFactor)) / m_scaleFactor;
+    return alignToReference(f);
+}
+
+sv_frame_t
+ViewGeometrySnapshot::getModelsStartFrame() const
+{
+    return alignToReference(m_modelsStartFrame);
+}
+
+sv_frame_t
+ViewGeometrySnapshot::getModelsEndFrame() const
+{
+    return alignToReference(m_modelsEndFrame);
+}
+
+double
+ViewGeometrySnapshot::getYForFrequency(double frequency,
+                                       double minf, double maxf,
+                                       bool logarithmic) const
+{
+    double h = m_height;
+
+    if (logarithmic) {
+        if (minf == 0.0) minf = 1.0;
+        if (maxf < minf) maxf = minf;
+        double logminf = log10(minf), logmaxf = log10(maxf);
+        if (logminf == logmaxf) return 0;
+        return m_scaleFactor *
+            (h - (h * (log10(frequency) - logminf)) / (logmaxf - logminf));
+    } else {
+        if (minf == maxf) return 0;
+        return m_scaleFactor * (h - (h * (frequency - minf)) / (maxf - minf));
+    }
+}
+
+double
+ViewGeometrySnapshot::getFrequencyForY(double y,
+                                       double minf, double maxf,
+                                       bool logarithmic) const
+{
+    double h = m_height;
+    y /= m_scaleFactor;
+
+    if (logarithmic) {
+        if (minf == 0.0) minf = 1.0;
+        if (maxf < minf) maxf = minf;
+        double logminf = log10(minf), logmaxf = log10(maxf);
+        if (logminf == logmaxf) return 0;
+        return pow(10.0, logminf + ((logmaxf - logminf) * (h - y)) / h);
+    } else {
+        if (minf == maxf) return 0;
+        return minf + ((h - y) * (maxf - minf)) / h;
+    }
+}
+
+int
+ViewGeometrySnapshot::getTextLabelYCoord(const Layer *layer,
+                                         QPainter &paint) const
+{
+    int y = m_labelBaseY + paint.fontMetrics().ascent();
+
+    for (const Layer *l: m_tables->labelledLayers) {
+        if (l == layer) break;
+        y += paint.fontMetrics().height();
+    }
+
+    return m_scaleFactor * y;
+}
+
+bool
+ViewGeometrySnapshot::getVisibleExtentsForUnit(QString unit,
+                                               double &min, double &max,
+                                               bool &log) const
+{
+    auto itr = m_tables->extents.find(unit.toLower());
+    if (itr == m_tables->extents.end()) return false;
+    min = itr->second.min;
+    max = itr->second.max;
+    log = itr->second.log;
+    return true;
+}
+
+ZoomLevel
+ViewGeometrySnapshot::getZoomLevel() const
+{
+    ZoomLevel z = m_zoomLevel;
+    if (z.zone == ZoomLevel::FramesPerPixel) {
+        z.level /= m_scaleFactor;
+        if (z.level < 1) {
+            z.level = 1;
+        }
+    } else {
+        z.level *= m_scaleFactor;
+    }
+    return z;
+}
+
+QRect
+ViewGeometrySnapshot::getPaintRect() const
+{
+    return QRect(m_paintRect.x() * m_scaleFactor,
+                 m_paintRect.y() * m_scaleFactor,
+                 m_paintRect.width() * m_scaleFactor,
+                 m_paintRect.height() * m_scaleFactor);
+}
+
+bool
+ViewGeometrySnapshot::shouldIlluminateLocalFeatures(const Layer *layer,
+                                                    QPoint &point) const
+{
+    if (!m_illuminatedLayer || layer != m_illuminatedLayer) return false;
+    point = QPoint(m_illuminationPoint.x() * m_scaleFactor,
+                   m_illuminationPoint.y() * m_scaleFactor);
+    return true;
+}
+
+void
+ViewGeometrySnapshot::drawMeasurementRect(QPainter &p, const Layer *layer,
+                                          QRect rect, bool focus) const
+{
+    View *view = m_view;
+    if (!view || QThread::currentThread() != view->thread()) return;
+    view->drawMeasurementRect(p, layer, rect, focus);
+}
+
+void
+ViewGeometrySnapshot::updatePaintRect(QRect r)
+{
+    View *view = m_view;
+    if (!view) return;
+
+    QRect vr(r.x() / m_scaleFactor,
+             r.y() / m_scaleFactor,
+             r.width() / m_scaleFactor,
+             r.height() / m_scaleFactor);
+
+    if (QThread::currentThread() == view->thread()) {
+        view->updatePaintRect(vr);
+    } else {
+        QPointer<View> target(view);
+        QMetaObject::invokeMethod(view, [target, vr]() {
+            if (target) target->updatePaintRect(vr);
+        }, Qt::QueuedConnection);
+    }
+}
+
+View *
+ViewGeometrySnapshot::getView()
+{
+    return m_view;
+}
+
+const View *
+ViewGeometrySnapshot::getView() const
+{
+    return m_view;
+}
+
+double
+ViewGeometrySnapshot::scaleSize(double size) const
+{
+    return size * m_scaleFactor * m_sizeRatio;
+}
+
+int
+ViewGeometrySnapshot::scalePixelSize(int size) const
+{
+    double d = scaleSize(size);
+    int i = int(d + 0.5);
+    if (size != 0 && i == 0) i = 1;
+    return i;
+}
+
+double
+ViewGeometrySnapshot::scalePenWidth(double width) const
+{
+    if (width <= 0) { // zero-width pen, produce a scaled one-pixel pen
+        width = 1;
+    }
+    width *= sqrt(double(m_scaleFactor));
+    return width * sqrt(m_sizeRatio);
+}
+
+QPen
+ViewGeometrySnapshot::scalePen(QPen pen) const
+{
+    return QPen(pen.color(), scalePenWidth(pen.width()));
+}
+
+} // end namespace sv
@@ -0,0 +1,180 @@
+/* -*- c-basic-offset: 4 indent-tabs-mode: nil -*-  vi:set ts=8 sts=4 sw=4: */
+
+/*
+    Sonic Visualiser
+    An audio file viewer and annotation editor.
+    Centre for Digital Music, Queen Mary, University of London.
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License as
+    published by the Free Software Foundation; either version 2 of the
+    License, or (at your option) any later version.  See the file
+    COPYING included with this distribution for more information.
+*/
+
+#ifndef SV_VIEW_GEOMETRY_SNAPSHOT_H
+#define SV_VIEW_GEOMETRY_SNAPSHOT_H
+
+#include "layer/LayerGeometryProvider.h"
+
+#include "data/model/Model.h"
+
+#include <QPointer>
+#include <QColor>
+
+#include <map>
+#include <memory>
+#include <vector>
+
+namespace sv {
+
+class AlignmentModel;
+
+/**
+ * A LayerGeometryProvider that answers from a copy of a view's
+ * geometry taken when it was constructed, rather than by asking the
+ * view as ViewProxy does. The snapshot records the view's centre
+ * frame, zoom level, size, scale factor, colours, the vertical
+ * extents the view would report for each unit used by its layers,
+ * and (like ViewProxy) an optional alignment through which frames
+ * are mapped. It does not change if the view changes afterwards.
+ *
+ * A snapshot must be constructed on the GUI thread, but may then be
+ * copied and used on any thread, so that a layer can be painted into
+ * an image off the GUI thread. Copies share the captured tables, so
+ * copying is cheap.
+ *
+ * Some parts of the interface cannot be answered from a snapshot.
+ * getView() and getViewManager() return the live objects, which may
+ * be used only on the GUI thread. drawMeasurementRect does nothing
+ * when called from another thread, and updatePaintRect queues an
+ * update of the view to be performed on the GUI thread.
+ */
+class ViewGeometrySnapshot : public LayerGeometryProvider
+{
+public:
+    /**
+     * Capture the geometry of the given view, mapping using the given
+     * scale factor as ViewProxy does. If an alignment model is given,
+     * frames are mapped through it as for the re-aligning form of
+     * ViewProxy.
+     */
+    ViewGeometrySnapshot(View *view, int scaleFactor,
+                         ModelId alignment = {});
+
+    ViewGeometrySnapshot(const ViewGeometrySnapshot &) =default;
+    ViewGeometrySnapshot &operator=(const ViewGeometrySnapshot &) =default;
+
+    int getId() const override { return m_id; }
+    int getScaleFactor() const override { return m_scaleFactor; }
+
+    sv_frame_t getStartFrame() const override;
+    sv_frame_t getCentreFrame() const override;
+    sv_frame_t getEndFrame() const override;
+    int getXForFrame(sv_frame_t frame) const override;
+    sv_frame_t getFrameForX(int x) const override;
+    int getXForViewX(int viewx) const override { return viewx * m_scaleFactor; }
+    int getViewXForX(int x) const override { return x / m_scaleFactor; }
+    sv_frame_t getModelsStartFrame() const override;
+    sv_frame_t getModelsEndFrame() const override;
+
+    /**
+     * As View::getYForFrequency, but thread-safe in logarithmic mode
+     * as well.
+     */
+    double getYForFrequency(double frequency, double minFreq, double maxFreq,
+                            bool logarithmic) const override;
+
+    /**
+     * As View::getFrequencyForY, but thread-safe in logarithmic mode
+     * as well.
+     */
+    double getFrequencyForY(double y, double minFreq, double maxFreq,
+                            bool logarithmic) const override;
+
+    int getTextLabelYCoord(const Layer *layer, QPainter &) const override;
+
+    bool getVisibleExtentsForUnit(QString unit, double &min, double &max,
+                                  bool &log) const override;
+
+    ZoomLevel getZoomLevel() const override;
+    QRect getPaintRect() const override;
+
+    bool hasLightBackground() const override { return m_lightBackground; }
+    QColor getForeground() const override { return m_foreground; }
+    QColor getBackground() const override { return m_background; }
+
+    ViewManager *getViewManager() const override { return m_manager; }
+
+    bool shouldIlluminateLocalFeatures(const Layer *, QPoint &) const override;
+    bool shouldShowFeatureLabels() const override { return m_showFeatureLabels; }
+
+    void drawMeasurementRect(QPainter &p, const Layer *,
+                             QRect rect, bool focus) const override;
+
+    void updatePaintRect(QRect r) override;
+
+    double getRenderTimeScale() const override { return m_renderTimeScale; }
+
+    ModelId getAlignmentModel() const override { return m_alignmentId; }
+
+    double scaleSize(double size) const override;
+    int scalePixelSize(int size) const override;
+    double scalePenWidth(double width) const override;
+    QPen scalePen(QPen pen) const override;
+
+    View *getView() override;
+    const View *getView() const override;
+
+private:
+    struct Extents {
+        double min;
+        double max;
+        bool log;
+    };
+
+    // The parts that are not trivially copyable, shared between
+    // copies of a snapshot and never modified after construction
+    struct Tables {
+        std::shared_ptr<AlignmentModel> alignment;
+        std::map<QString, Extents> extents; // key is lower-case unit
+        std::vector<const Layer *> labelledLayers; // in label order
+    };
+
+    QPointer<View> m_view;
+    ViewManager *m_manager;
+    int m_id;
+    int m_scaleFactor;
+    ModelId m_alignmentId;
+
+    sv_frame_t m_centreFrame; // view's own, not aligned
+    ZoomLevel m_zoomLevel;    // view's own, not scaled
+    int m_width;              // view's own, not scaled
+    int m_height;
+    QRect m_paintRect;        // view's own, not scaled
+    sv_frame_t m_modelsStartFrame;
+    sv_frame_t m_modelsEndFrame;
+
+    bool m_lightBackground;
+    QColor m_foreground;
+    QColor m_background;
+
+    bool m_showFeatureLabels;
+    const Layer *m_illuminatedLayer;
+    QPoint m_illuminationPoint;
+
+    double m_sizeRatio;
+    int m_labelBaseY;
+    double m_renderTimeScale;
+
+    std::shared_ptr<const Tables> m_tables;
+
+    int getViewXForFrame(sv_frame_t frame) const;
+    sv_frame_t getFrameForViewX(int x) const;
+    sv_frame_t alignToReference(sv_frame_t frame) const;
+    sv_frame_t alignFromReference(sv_frame_t frame) const;
+};
+
+} // end namespace sv
+
+#endif
@@ -21,14 +21,17 @@
 #include "widgets/CommandHistory.h"
 #include "View.h"
 #include "Overview.h"
+#include "RenderScheduler.h"
 
 #include "system/System.h"
 
 #include <QSettings>
 #include <QApplication>
 #include <QStyleFactory>
+#include <QScreen>
 
 #include <iostream>
+#include <cmath>
 
 //#define DEBUG_VIEW_MANAGER 1
 
@@ -43,6 +46,8 @@ ViewManager::ViewManager() :
     m_mainModelSampleRate(0),
     m_lastLeft(0), 
     m_lastRight(0),
+    m_playbackTimer(nullptr),
+    m_renderScheduler(nullptr),
     m_inProgressExclusive(true),
     m_toolMode(NavigateMode),
     m_playLoopMode(false),
@@ -134,6 +139,13 @@ ViewManager::ViewManager() :
         m_darkPalette.setColor(QPalette::Disabled, QPalette::Shadow,
                                QColor("#000000"));
     }
+
+    m_playbackTimer = new QTimer(this);
+    m_playbackTimer->setTimerType(Qt::PreciseTimer);
+    connect(m_playbackTimer, SIGNAL(timeout()), this, SLOT(checkPlayStatus()));
+    m_playbackClock.start();
+
+    m_renderScheduler = new RenderScheduler(this);
 }
 
 ViewManager::~ViewManager()
@@ -177,7 +189,12 @@ ViewManager::getPlaybackFrame() const
         cout << "ViewManager::getPlaybackFrame(recording) -> " << m_playbackFrame << endl;
 #endif
     } else if (isPlaying()) {
-        m_playbackFrame = m_playSource->getCurrentPlayingFrame();
+        // While the playback timer is running, return the position
+        // it last published, so that every view and every call
+        // between two ticks sees the same frame
+        if (!m_playbackTimer->isActive() || !m_playbackEstimate.anchored) {
+            m_playbackFrame = m_playSource->getCurrentPlayingFrame();
+        }
 #ifdef DEBUG_VIEW_MANAGER
         cout << "ViewManager::getPlaybackFrame(playing) -> " << m_playbackFrame << endl;
 #endif
@@ -198,6 +215,7 @@ ViewManager::setPlaybackFrame(sv_frame_t f)
     if (f < 0) f = 0;
     if (m_playbackFrame != f) {
         m_playbackFrame = f;
+        m_playbackEstimate.reset();
         emit playbackFrameChanged(f);
         if (isPlaying()) {
             m_playSource->play(f);
@@ -592,6 +610,8 @@ ViewManager::checkPlayStatus()
 
         emit playbackFrameChanged(m_playbackFrame);
 
+        m_playbackTimer->stop();
+        m_playbackEstimate.reset();
         QTimer::singleShot(500, this, SLOT(checkPlayStatus()));
 
     } else if (isPlaying()) {
@@ -605,7 +625,10 @@ ViewManager::checkPlayStatus()
             }
         }
 
-        m_playbackFrame = m_playSource->getCurrentPlayingFrame();
+        m_playbackFrame = m_playbackEstimate.update
+            (m_playSource->getCurrentPlayingFrame(),
+             m_playbackClock.nsecsElapsed(),
+             m_playSource->getSourceSampleRate());
 
 #ifdef DEBUG_VIEW_MANAGER
         cerr << "ViewManager::checkPlayStatus: Playing, frame " << m_playbackFrame << ", levels " << m_lastLeft << "," << m_lastRight << endl;
@@ -613,10 +636,17 @@ ViewManager::checkPlayStatus()
 
         emit playbackFrameChanged(m_playbackFrame);
 
-        QTimer::singleShot(20, this, SLOT(checkPlayStatus()));
+        int interval = getPlaybackTimerInterval();
+        if (!m_playbackTimer->isActive() ||
+            m_playbackTimer->interval() != interval) {
+            m_playbackTimer->start(interval);
+        }
 
     } else {
 
+        m_playbackTimer->stop();
+        m_playbackEstimate.reset();
+
         if (m_lastLeft != 0.0 || m_lastRight != 0.0) {
             emit monitoringLevelsChanged(0.0, 0.0);
             m_lastLeft = 0.0;
@@ -629,6 +659,73 @@ ViewManager::checkPlayStatus()
     }
 }
 
+int
+ViewManager::getPlaybackTimerInterval() const
+{
+    double refreshRate = 60.0;
+    if (QScreen *screen = QGuiApplication::primaryScreen()) {
+        if (screen->refreshRate() > 1.0) {
+            refreshRate = screen->refreshRate();
+        }
+    }
+
+    // Pace at the display rate, but no faster than 120Hz (there's
+    // nothing to gain from painting more often than that) and no
+    // slower than 25Hz
+    int interval = int(floor(1000.0 / refreshRate));
+    if (interval < 8) interval = 8;
+    if (interval > 40) interval = 40;
+    return interval;
+}
+
+sv_frame_t
+ViewManager::PlaybackEstimate::update(sv_frame_t reported, qint64 nsec,
+                                      sv_samplerate_t nominalRate)
+{
+    if (!anchored) {
+        anchored = true;
+        frame = double(reported);
+        anchorTime = nsec;
+        rate = nominalRate;
+        lastReported = reported;
+        lastEstimated = reported;
+        measureFrame = reported;
+        measureTime = nsec;
+        return reported;
+    }
+
+    double estimate = frame + rate * double(nsec - anchorTime) / 1.0e9;
+
+    if (reported != lastReported) {
+
+        lastReported = reported;
+        double error = double(reported) - estimate;
+
+        if (fabs(error) > nominalRate / 4.0) {
+            // Not a report we can smooth towards: start again from it
+            reset();
+            return update(reported, nsec, nominalRate);
+        }
+
+        // Measure the rate over the whole time since the estimate was
+        // last reset, so that the block quantisation of the reports
+        // becomes insignificant as playback goes on
+        qint64 span = nsec - measureTime;
+        if (span > 1000000000 && reported > measureFrame) {
+            rate = double(reported - measureFrame) * 1.0e9 / double(span);
+        }
+
+        frame = estimate + error / 8.0;
+        anchorTime = nsec;
+        estimate = frame;
+    }
+
+    sv_frame_t result = sv_frame_t(llround(estimate));
+    if (result < lastEstimated) result = lastEstimated;
+    lastEstimated = result;
+    return result;
+}
+
 bool
 ViewManager::isPlaying() const
 {
@@ -692,6 +789,7 @@ ViewManager::seek(sv_frame_t f)
         sv_frame_t diff = std::max(f, playFrame) - std::min(f, playFrame);
         if (diff > 20000) {
             m_playbackFrame = f;
+            m_playbackEstimate.reset();
             m_playSource->play(f);
 #ifdef DEBUG_VIEW_MANAGER 
             cerr << "ViewManager::seek: reseeking from " << playFrame << " to " << f << endl;
@@ -19,6 +19,7 @@
 #include <QObject>
 #include <QTimer>
 #include <QPalette>
+#include <QElapsedTimer>
 
 #include <map>
 
@@ -67,6 +68,7 @@ enum PlaybackFollowMode {
 };
 
 class View;
+class RenderScheduler;
 
 /**
  * The ViewManager manages properties that may need to be synchronised
@@ -96,6 +98,12 @@ public:
 
     sv_frame_t getPlaybackFrame() const; // the set method is a slot
 
+    /**
+     * Return the scheduler that orders repaints among the views
+     * sharing this manager. Owned by the ViewManager.
+     */
+    RenderScheduler *getRenderScheduler() const { return m_renderScheduler; }
+
     // Only meaningful in solo mode, and used for optional alignment feature
     ModelId getPlaybackModel() const;
     void setPlaybackModel(ModelId);
@@ -356,6 +364,43 @@ protected:
     float m_lastLeft;
     float m_lastRight;
 
+    /**
+     * Smoothed estimate of the playback position. The play source
+     * reports its position only as often as the audio driver
+     * processes a block, so consecutive reports taken at display rate
+     * can be equal or can jump by a whole block. Between reports the
+     * position is extrapolated at the playback rate, which is
+     * measured from the reports themselves so as to follow any time
+     * stretching, and the extrapolation is steered gently towards
+     * each new report rather than snapped to it. A report too far
+     * from the estimate (a seek, a loop, or a stall) resets it.
+     */
+    struct PlaybackEstimate {
+        PlaybackEstimate() { reset(); }
+        void reset() { anchored = false; }
+        sv_frame_t update(sv_frame_t reported, qint64 nsec,
+                          sv_samplerate_t nominalRate);
+        bool anchored;
+        double frame;           // estimated position at anchorTime
+        qint64 anchorTime;      // ns
+        double rate;            // frames per second
+        sv_frame_t lastReported;
+        sv_frame_t lastEstimated;
+        sv_frame_t measureFrame; // reported position at measureTime
+        qint64 measureTime;      // ns
+    };
+
+    // While playing, the position is polled and published on a
+    // steady timer at about the display refresh rate, rather than at
+    // whatever rate the play source happens to update it
+    QTimer *m_playbackTimer;
+    QElapsedTimer m_playbackClock;
+    PlaybackEstimate m_playbackEstimate;
+
+    int getPlaybackTimerInterval() const;
+
+    RenderScheduler *m_renderScheduler;
+
     MultiSelection m_selections;
     Selection m_inProgressSelection;
     bool m_inProgressExclusive;
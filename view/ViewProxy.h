@@ -166,10 +166,18 @@ public:
     }
 
     void updatePaintRect(QRect r) override {
-        m_view->update(r.x() / m_scaleFactor,
-                       r.y() / m_scaleFactor,
-                       r.width() / m_scaleFactor,
-                       r.height() / m_scaleFactor);
+        m_view->updatePaintRect(QRect(r.x() / m_scaleFactor,
+                                      r.y() / m_scaleFactor,
+                                      r.width() / m_scaleFactor,
+                                      r.height() / m_scaleFactor));
+    }
+
+    double getRenderTimeScale() const override {
+        return m_view->getRenderTimeScale();
+    }
+
+    ModelId getAlignmentModel() const override {
+        return m_alignment;
     }
 
     /**
@@ -210,6 +218,17 @@ public:
         return QPen(pen.color(), scalePenWidth(pen.width()));
     }
     
+    /**
+     * A proxy is created for a single paint, so the table is built
+     * on first request and shared by every layer painted through it.
+     */
+    std::shared_ptr<const PixelFrameTable> getPixelFrameTable() const override {
+        if (!m_pixelFrameTable) {
+            m_pixelFrameTable = std::make_shared<PixelFrameTable>(this);
+        }
+        return m_pixelFrameTable;
+    }
+    
     View *getView() override { return m_view; }
     const View *getView() const override { return m_view; }
 
@@ -217,6 +236,7 @@ private:
     View *m_view;
     int m_scaleFactor;
     ModelId m_alignment;
+    mutable std::shared_ptr<const PixelFrameTable> m_pixelFrameTable;
 
     sv_frame_t alignToReference(sv_frame_t frame) const {
         if (auto am = ModelById::getAs<AlignmentModel>(m_alignment)) {